@@ -0,0 +1,146 @@
+/**
+ * Decoder of the binary LoRa frames sent by the ESP sender.
+ * Layout: Software_sender/components/frame/include/frame.h
+ */
+
+const FRAME_VERSION = 1;
+const FRAME_HEADER_LEN = 4;
+const FRAME_TYPE_MEASURE = 1;
+const FRAME_TYPE_BATCH = 2;
+const FRAME_MEASURE_LEN = 12;
+const FRAME_BATCH_HEADER_LEN = 7;
+const FRAME_CHANNELS = 4;
+
+// Quantization steps per channel (temp, press, hum, sound)
+const SCALE = [100, 10, 2, 100];
+const FIELDS = ['temp', 'press', 'hum', 'sound'];
+
+/**
+ * Parse the common frame header.
+ * @param {Buffer} buf - Frame bytes.
+ * @returns {{type: number, device_id: number, seq: number}}
+ */
+function parseHeader(buf) {
+  if (buf.length < FRAME_HEADER_LEN || (buf[0] >> 4) !== FRAME_VERSION) {
+    throw new Error(`Unsupported frame (version ${buf.length ? buf[0] >> 4 : '-'})`);
+  }
+  return {
+    type: buf[0] & 0x0f,
+    device_id: buf.readUInt16LE(1),
+    seq: buf[3],
+  };
+}
+
+/**
+ * Decode a measurement frame into the same fields as the JSON payload.
+ * @param {Buffer} buf - Frame bytes.
+ * @returns {Object} { device_id, seq, valid, temp, press, hum, sound }
+ */
+function decodeMeasure(buf) {
+  if (buf.length < FRAME_MEASURE_LEN) {
+    throw new Error(`Measurement frame too short (${buf.length} bytes)`);
+  }
+  const { device_id, seq } = parseHeader(buf);
+  return {
+    device_id,
+    seq,
+    valid: buf[4] & 0x0f,
+    temp: buf.readInt16LE(5) / 100,
+    press: buf.readUInt16LE(7) / 10,
+    hum: buf[9] / 2,
+    sound: buf.readUInt16LE(10) / 100,
+  };
+}
+
+/**
+ * Read an unsigned LEB128 varint.
+ * @param {Buffer} buf - Source bytes.
+ * @param {{pos: number}} cursor - Read position, advanced past the varint.
+ * @returns {number}
+ */
+function readVarint(buf, cursor) {
+  let result = 0;
+  for (let shift = 0; shift < 35; shift += 7) {
+    if (cursor.pos >= buf.length) {
+      throw new Error('Truncated varint');
+    }
+    const b = buf[cursor.pos++];
+    result += (b & 0x7f) * 2 ** shift;
+    if (!(b & 0x80)) {
+      return result;
+    }
+  }
+  throw new Error('Varint too long');
+}
+
+/**
+ * Decode a batch frame (delta-of-delta + zig-zag varint per channel, see tscomp.h).
+ * @param {Buffer} buf - Frame bytes.
+ * @returns {Object} { device_id, seq, interval, samples: [{ valid, temp, press, hum, sound }] }
+ */
+function decodeBatch(buf) {
+  if (buf.length < FRAME_BATCH_HEADER_LEN) {
+    throw new Error(`Batch frame too short (${buf.length} bytes)`);
+  }
+  const { device_id, seq } = parseHeader(buf);
+  const count = buf[4];
+  const interval = buf.readUInt16LE(5);
+  const validLen = Math.ceil(count / 2);
+  const cursor = { pos: FRAME_BATCH_HEADER_LEN + validLen };
+  const prev = new Array(FRAME_CHANNELS).fill(0);
+  const delta = new Array(FRAME_CHANNELS).fill(0);
+  const samples = [];
+
+  for (let i = 0; i < count; i++) {
+    const valid = (buf[FRAME_BATCH_HEADER_LEN + (i >> 1)] >> ((i & 1) * 4)) & 0x0f;
+    const sample = { valid };
+    for (let c = 0; c < FRAME_CHANNELS; c++) {
+      const u = readVarint(buf, cursor);
+      delta[c] += (u % 2) ? -(u + 1) / 2 : u / 2;   // zig-zag
+      prev[c] += delta[c];
+      sample[FIELDS[c]] = (valid & (1 << c)) ? prev[c] / SCALE[c] : 0;
+    }
+    samples.push(sample);
+  }
+  return { device_id, seq, interval, samples };
+}
+
+/**
+ * Decode a hex-encoded frame forwarded by the receiver.
+ * @param {string} hex - Frame bytes as a hex string.
+ * @returns {Object} Decoded frame content.
+ */
+function decodeFrame(hex) {
+  const buf = Buffer.from(hex, 'hex');
+  const { type } = parseHeader(buf);
+  switch (type) {
+    case FRAME_TYPE_MEASURE:
+      return decodeMeasure(buf);
+    case FRAME_TYPE_BATCH:
+      return decodeBatch(buf);
+    default:
+      throw new Error(`Unknown frame type ${type}`);
+  }
+}
+
+/**
+ * Expand a decoded frame into one measurement per wake cycle, with the time
+ * it was taken (batches are sent after their last sample).
+ * @param {Object} frame - Result of decodeFrame().
+ * @param {Date} receivedAt - Reception time.
+ * @returns {Object[]} Measurements with a measured_at Date.
+ */
+function frameMeasurements(frame, receivedAt) {
+  if (!frame.samples) {
+    return [{ ...frame, measured_at: receivedAt }];
+  }
+  const last = frame.samples.length - 1;
+  return frame.samples.map((s, i) => ({
+    device_id: frame.device_id,
+    seq: frame.seq,
+    ...s,
+    measured_at: new Date(receivedAt.getTime() - (last - i) * frame.interval * 1000),
+  }));
+}
+
+module.exports = { decodeFrame, parseHeader, decodeMeasure, decodeBatch, frameMeasurements };
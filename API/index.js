@@ -5,6 +5,7 @@ let fetch;
   fetch = (await import('node-fetch')).default;
 })();
 const pool = require('./db'); // PostgreSQL connection
+const { decodeFrame, frameMeasurements } = require('./frame'); // Binary LoRa frames
 
 const app = express();
 const port = 3000;
@@ -84,6 +85,18 @@ app.post('/espdata', async (req, res) => {
     return res.status(400).send('Body must be a non-empty JSON array or object');
   }
 
+  // Binary frames forwarded as hex by the receiver, a batch expands to one entry per cycle.
+  // "age" is how old the last sample already was, frames of a bulk backlog dump are late
+  const receivedAt = new Date();
+  try {
+    dataList = dataList.flatMap((data) => data.frame === undefined ? [data] :
+      frameMeasurements(decodeFrame(data.frame), new Date(receivedAt.getTime() - (data.age || 0) * 1000))
+        .map((m) => ({ ...m, rssi: data.rssi, snr: data.snr })));
+  } catch (err) {
+    console.error(err);
+    return res.status(400).send(`Bad frame: ${err.message}`);
+  }
+
   // Fixed sensor IDs for each type
   const ENV_SENSOR_ID = "022222"; // temp, hum, pressure, sound
 
@@ -96,16 +109,24 @@ app.post('/espdata', async (req, res) => {
         data.press !== undefined ||
         data.sound !== undefined
       ) {
-        const tempVal = data.temp !== undefined ? data.temp : null;
-        const presVal = data.press !== undefined ? data.press : null;
-        const humVal = data.hum !== undefined ? data.hum : null;
-        const soundVal = data.sound;
+        // Validity bitmap (bit 0 temp, 1 press, 2 hum, 3 sound): channels that
+        // missed their deadline are sent as 0 and stored as NULL
+        const valid = data.valid !== undefined ? data.valid : 0x0f;
+        const channel = (value, bit) =>
+          value !== undefined && (valid & (1 << bit)) ? value : null;
+        const tempVal = channel(data.temp, 0);
+        const presVal = channel(data.press, 1);
+        const humVal = channel(data.hum, 2);
+        const soundVal = channel(data.sound, 3);
 
         // Insert environmental data into the database
         await pool.query(
-          `INSERT INTO sensors (sensor_id, temperature, pressure, humidity, sound) 
-           VALUES ($1, $2, $3, $4, $5)`,
-          [ENV_SENSOR_ID, tempVal, presVal, humVal, soundVal]
+          `INSERT INTO sensors (sensor_id, temperature, pressure, humidity, sound, valid, device_id, seq, created_at) 
+           VALUES ($1, $2, $3, $4, $5, $6, $7, $8, COALESCE($9::timestamptz, CURRENT_TIMESTAMP))`,
+          [ENV_SENSOR_ID, tempVal, presVal, humVal, soundVal, valid,
+           data.device_id !== undefined ? data.device_id : null,
+           data.seq !== undefined ? data.seq : null,
+           data.measured_at || null]
         );
       }
 
@@ -122,6 +143,102 @@ app.post('/espdata', async (req, res) => {
   }
 });
 
+// Route to receive diagnostics packets (sender via LoRa, or the receiver itself)
+app.post('/espdiag', async (req, res) => {
+  const diag = req.body;
+  console.log('Diagnostics received from ESP:', diag);
+
+  if (!diag || diag.diag === undefined) {
+    return res.status(400).send('Body must be a diagnostics JSON object');
+  }
+
+  try {
+    await pool.query(
+      `INSERT INTO diagnostics (heap_free, heap_min, alloc, free, stack)
+       VALUES ($1, $2, $3, $4, $5)`,
+      [diag.heap, diag.heap_min, diag.alloc || [], diag.free || [], diag.stack || {}]
+    );
+    res.status(201).send('ESP diagnostics saved');
+  } catch (err) {
+    console.error(err);
+    res.status(500).send('Server error');
+  }
+});
+
+// Remote configuration of the senders, range of each setting (Software_sender/components/frame/include/downlink.h)
+const DOWNLINK_FIELDS = {
+  sleep_s: [1, 65535],
+  sample_count: [1, 30],
+  sample_period_ms: [100, 60000],
+  sf: [7, 12],
+  tx_power: [2, 17],
+};
+// Senders the receiver can queue commands for (LINK_MAX_PEERS)
+const DOWNLINK_BATCH = 8;
+
+// Queue settings for a sender: {"device_id":4660,"sleep_s":600,"sf":9}
+app.post('/espdownlink', async (req, res) => {
+  const body = req.body || {};
+  const deviceId = body.device_id;
+  if (!Number.isInteger(deviceId) || deviceId < 0 || deviceId > 0xffff) {
+    return res.status(400).send('device_id must be a 16-bit integer');
+  }
+  const values = {};
+  for (const [name, [min, max]] of Object.entries(DOWNLINK_FIELDS)) {
+    if (body[name] === undefined) {
+      continue;
+    }
+    if (!Number.isInteger(body[name]) || body[name] < min || body[name] > max) {
+      return res.status(400).send(`${name} must be an integer from ${min} to ${max}`);
+    }
+    values[name] = body[name];
+  }
+  if (Object.keys(values).length === 0) {
+    return res.status(400).send(`At least one of ${Object.keys(DOWNLINK_FIELDS).join(', ')} is required`);
+  }
+
+  try {
+    await pool.query(
+      `INSERT INTO downlinks (device_id, sleep_s, sample_count, sample_period_ms, sf, tx_power)
+       VALUES ($1, $2, $3, $4, $5, $6)`,
+      [deviceId, values.sleep_s, values.sample_count, values.sample_period_ms, values.sf, values.tx_power]
+    );
+    res.status(201).send('Downlink queued');
+  } catch (err) {
+    console.error(err);
+    res.status(500).send('Server error');
+  }
+});
+
+// Polled by the receiver: pending settings, merged per sender, each handed out once
+app.get('/espdownlink', async (req, res) => {
+  try {
+    const result = await pool.query(
+      `UPDATE downlinks SET fetched_at = CURRENT_TIMESTAMP
+       WHERE device_id IN (
+         SELECT DISTINCT device_id FROM downlinks WHERE fetched_at IS NULL LIMIT $1)
+       AND fetched_at IS NULL
+       RETURNING id, device_id, sleep_s, sample_count, sample_period_ms, sf, tx_power`,
+      [DOWNLINK_BATCH]
+    );
+    // Later rows win, as on the receiver
+    const merged = new Map();
+    for (const row of result.rows.sort((a, b) => a.id - b.id)) {
+      const entry = merged.get(row.device_id) || { device_id: row.device_id };
+      for (const name of Object.keys(DOWNLINK_FIELDS)) {
+        if (row[name] !== null) {
+          entry[name] = row[name];
+        }
+      }
+      merged.set(row.device_id, entry);
+    }
+    res.json([...merged.values()]);
+  } catch (err) {
+    console.error(err);
+    res.status(500).send('Server error');
+  }
+});
+
 // Start the Express API server
 app.listen(port, () => {
   console.log(`API running at http://localhost:${port}`);
@@ -5,5 +5,36 @@ CREATE TABLE IF NOT EXISTS sensors (
     pressure REAL,
     humidity REAL,
     sound REAL,
+    valid SMALLINT,
+    device_id INTEGER,
+    seq SMALLINT,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-);
\ No newline at end of file
+);
+
+-- Validity bitmap of each measurement (bit 0 temp, 1 press, 2 hum, 3 sound)
+ALTER TABLE sensors ADD COLUMN IF NOT EXISTS valid SMALLINT;
+-- Sender ID and sequence number of binary frames
+ALTER TABLE sensors ADD COLUMN IF NOT EXISTS device_id INTEGER;
+ALTER TABLE sensors ADD COLUMN IF NOT EXISTS seq SMALLINT;
+
+CREATE TABLE IF NOT EXISTS diagnostics (
+    id SERIAL PRIMARY KEY,
+    heap_free INTEGER,
+    heap_min INTEGER,
+    alloc INTEGER[],
+    free INTEGER[],
+    stack JSONB,
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+);
+-- Settings queued for the senders (POST /espdownlink), fetched once by the receiver
+CREATE TABLE IF NOT EXISTS downlinks (
+    id SERIAL PRIMARY KEY,
+    device_id INTEGER NOT NULL,
+    sleep_s INTEGER,
+    sample_count SMALLINT,
+    sample_period_ms INTEGER,
+    sf SMALLINT,
+    tx_power SMALLINT,
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    fetched_at TIMESTAMP
+);
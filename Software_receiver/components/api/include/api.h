@@ -1,6 +1,8 @@
 #ifndef API_H
 #define API_H
 
+#include <stddef.h>
+
 /**
  * @brief Send JSON data to the remote API via HTTP POST.
  *
@@ -8,4 +10,22 @@
  */
 void send_data_to_api(const char *json_data);
 
+/**
+ * @brief Send a JSON diagnostics packet to the remote API via HTTP POST.
+ *
+ * @param json_data The diagnostics JSON string (see diag_format_json()).
+ */
+void send_diag_to_api(const char *json_data);
+
+/**
+ * @brief Fetch the configuration commands waiting for the senders (HTTP GET).
+ *
+ * The API hands out each command set once, as a JSON array.
+ *
+ * @param buf Output buffer, NUL-terminated.
+ * @param len Size of @p buf.
+ * @return Body length, or -1 on error.
+ */
+int fetch_downlinks_from_api(char *buf, size_t len);
+
 #endif // API_H
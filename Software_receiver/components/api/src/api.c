@@ -3,11 +3,18 @@
 #include "esp_http_client.h"
 #include "esp_log.h"
 
+#define API_BASE_URL "http://172.20.10.9:3000" // TODO: make configurable
 
-void send_data_to_api(const char *json_data)
+/**
+ * @brief POST a JSON body to an API route.
+ *
+ * @param url Full URL of the route.
+ * @param json_data The JSON string to send.
+ */
+static void api_post(const char *url, const char *json_data)
 {
     esp_http_client_config_t config = {
-        .url = "http://172.20.10.9:3000/espdata", // TODO: make configurable
+        .url = url,
         .method = HTTP_METHOD_POST,
         .timeout_ms = 3000,
     };
@@ -27,3 +34,44 @@ void send_data_to_api(const char *json_data)
     }
     esp_http_client_cleanup(client);
 }
+
+void send_data_to_api(const char *json_data)
+{
+    api_post(API_BASE_URL "/espdata", json_data);
+}
+
+void send_diag_to_api(const char *json_data)
+{
+    api_post(API_BASE_URL "/espdiag", json_data);
+}
+
+int fetch_downlinks_from_api(char *buf, size_t len)
+{
+    esp_http_client_config_t config = {
+        .url = API_BASE_URL "/espdownlink",
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 3000,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+
+    int n = -1;
+    if (esp_http_client_open(client, 0) == ESP_OK)
+    {
+        esp_http_client_fetch_headers(client);
+        if (esp_http_client_get_status_code(client) == 200)
+        {
+            n = esp_http_client_read_response(client, buf, len - 1);
+        }
+    }
+    if (n >= 0)
+    {
+        buf[n] = '\0';
+    }
+    else
+    {
+        ESP_LOGE("API", "Failed to fetch downlinks from API");
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return n;
+}
@@ -0,0 +1,89 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "binlog_fmt.h"
+
+/**
+ * @file binlog.h
+ * @brief Deferred binary logging.
+ *
+ * BINLOG() stores a format ID, a timestamp and up to four raw 32-bit
+ * arguments into a lock-free ring. No formatting and no UART access happen
+ * on the caller's path, so it is safe in hot loops and ISRs. Records are
+ * formatted later by a low-priority task or by binlog_flush(), either as text
+ * on the device or as hex lines for tools/binlog_decode.py.
+ *
+ * Format strings live in binlog_fmt.h. Supported conversions are integers
+ * (%d %u %x %c) and floats (%f %e %g, stored as 32-bit float).
+ */
+
+#define BINLOG_MAX_ARGS 4
+
+/**
+ * @enum BinlogId
+ * @brief Format identifiers, generated from BINLOG_FORMATS.
+ */
+typedef enum {
+#define BINLOG_ENUM(id, fmt) id,
+    BINLOG_FORMATS(BINLOG_ENUM)
+#undef BINLOG_ENUM
+    BINLOG_ID_COUNT
+} BinlogId;
+
+/**
+ * @brief Append one record to the ring. Never blocks, drops when full.
+ * @param id Format identifier.
+ * @param nargs Number of 32-bit arguments (max BINLOG_MAX_ARGS).
+ * @param args Raw arguments.
+ */
+void binlog_write(BinlogId id, int nargs, const uint32_t *args);
+
+/**
+ * @brief Format and print every pending record.
+ */
+void binlog_flush(void);
+
+/**
+ * @brief Start the low-priority task that flushes the ring periodically.
+ * @param priority FreeRTOS priority of the flush task.
+ */
+void binlog_start_task(int priority);
+
+/**
+ * @brief Number of records dropped because the ring was full.
+ * @return Drop count since boot.
+ */
+uint32_t binlog_dropped(void);
+
+static inline uint32_t binlog_arg_u32(uint32_t v)
+{
+    return v;
+}
+
+static inline uint32_t binlog_arg_float(double v)
+{
+    float f = (float)v;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+#define BINLOG_ARG(x) _Generic((x), float: binlog_arg_float, double: binlog_arg_float, default: binlog_arg_u32)(x)
+
+#define BINLOG_0(id) binlog_write(id, 0, NULL)
+#define BINLOG_1(id, a) binlog_write(id, 1, (const uint32_t[]){ BINLOG_ARG(a) })
+#define BINLOG_2(id, a, b) binlog_write(id, 2, (const uint32_t[]){ BINLOG_ARG(a), BINLOG_ARG(b) })
+#define BINLOG_3(id, a, b, c) binlog_write(id, 3, (const uint32_t[]){ BINLOG_ARG(a), BINLOG_ARG(b), BINLOG_ARG(c) })
+#define BINLOG_4(id, a, b, c, d) binlog_write(id, 4, (const uint32_t[]){ BINLOG_ARG(a), BINLOG_ARG(b), BINLOG_ARG(c), BINLOG_ARG(d) })
+#define BINLOG_SELECT(_0, _1, _2, _3, _4, name, ...) name
+
+/**
+ * @brief Log a record: BINLOG(BL_ID, arg1, ...) with 0 to 4 arguments.
+ */
+#define BINLOG(id, ...) \
+    BINLOG_SELECT(_, ##__VA_ARGS__, BINLOG_4, BINLOG_3, BINLOG_2, BINLOG_1, BINLOG_0)(id, ##__VA_ARGS__)
+
+#endif // BINLOG_H
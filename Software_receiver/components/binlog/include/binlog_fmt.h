@@ -0,0 +1,25 @@
+#ifndef BINLOG_FMT_H
+#define BINLOG_FMT_H
+
+/**
+ * @file binlog_fmt.h
+ * @brief Format table of the deferred binary logger (receiver).
+ *
+ * One X(id, "format") entry per line; the entry index is the record's
+ * format ID. tools/binlog_decode.py parses this file, so only append new
+ * entries at the end and keep each on a single line.
+ */
+#define BINLOG_FORMATS(X) \
+    X(BL_RX_PACKET, "Packet received (%d bytes), RSSI %d dBm, SNR %.2f dB") \
+    X(BL_RX_FRAME, "Frame type %d from device %04x, seq %u") \
+    X(BL_RX_DUPLICATE, "Retransmission from device %04x, seq %u, not forwarded") \
+    X(BL_FEC_RECOVERED, "Frame from device %04x, seq %u rebuilt by FEC (%u rebuilt, %u lost so far)") \
+    X(BL_RX_FRAGMENT, "Fragment %d/%d of message %u from device %04x") \
+    X(BL_REASM_DONE, "Message of %d bytes reassembled, %u evicted, %u rejected so far") \
+    X(BL_DOWNLINK_QUEUED, "Configuration commands 0x%x queued for device %04x") \
+    X(BL_ADR_QUEUED, "ADR: device %04x to SF%d, %u dBm (best SNR %.2f dB)") \
+    X(BL_SNIFF_STATS, "Sniff: radio %d uA, %u packets, %u false wakes, %.1f%% of frames caught") \
+    X(BL_BULK_START, "Bulk: device %04x asks %d frames, %d granted") \
+    X(BL_BULK_DONE, "Bulk: %d frames from device %04x in %d ms, end received %d") \
+
+#endif // BINLOG_FMT_H
@@ -0,0 +1,52 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file diag.h
+ * @brief Stack, heap and allocation instrumentation.
+ *
+ * Collects the stack high-water mark of every FreeRTOS task, the current and
+ * minimum free heap, and heap allocation/free counts attributed to the state
+ * the application is in. The result is formatted as a compact JSON
+ * diagnostics packet.
+ *
+ * Per-task enumeration needs CONFIG_FREERTOS_USE_TRACE_FACILITY and the
+ * allocation counters need CONFIG_HEAP_USE_HOOKS (see sdkconfig.defaults).
+ */
+
+#define DIAG_MAX_STATES 8   ///< Number of application states tracked
+
+/**
+ * @brief Attribute the following heap allocations to a state.
+ * @param state Application state index (0 to DIAG_MAX_STATES - 1).
+ */
+void diag_set_state(int state);
+
+/**
+ * @brief Number of heap allocations made while in a state.
+ * @param state Application state index.
+ * @return Allocation count since boot.
+ */
+uint32_t diag_alloc_count(int state);
+
+/**
+ * @brief Log the memory budget (per-task stack headroom, heap) with ESP_LOGI.
+ */
+void diag_log(void);
+
+/**
+ * @brief Format the diagnostics packet as JSON.
+ *
+ * Tasks are added while they fit, so the output always stays valid JSON
+ * within @p len bytes.
+ *
+ * @param buf Output buffer.
+ * @param len Size of @p buf in bytes.
+ * @return Length of the JSON string, or 0 if @p buf is too small.
+ */
+int diag_format_json(char *buf, size_t len);
+
+#endif // DIAG_H
@@ -0,0 +1,130 @@
+#ifndef FRAG_H
+#define FRAG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "frame.h"
+
+/**
+ * @file frag.h
+ * @brief Fragmentation of messages longer than one LoRa packet, and reassembly.
+ *
+ * A message (any frame or JSON packet) longer than CONFIG_FRAME_FRAG_LEN is
+ * sent as FRAME_TYPE_FRAG frames. After the common header, each fragment has:
+ *
+ *   byte 4      message ID, wraps at 256
+ *   byte 5      fragment index (0 .. count - 1)
+ *   byte 6      fragment count
+ *   bytes 7-8   message length, uint16
+ *   then        the message bytes [index * chunk, (index + 1) * chunk)
+ *
+ * where chunk = ceil(length / count), so a fragment can be placed in the
+ * message as soon as it arrives, in any order.
+ *
+ * The receiver keeps partial messages in a fixed pool of
+ * CONFIG_FRAME_REASM_SLOTS buffers. A slot with no new fragment for
+ * CONFIG_FRAME_REASM_TIMEOUT_MS is evicted, and the least recently updated
+ * slot is evicted when a new message finds the pool full. Nothing is
+ * allocated on the receive path.
+ */
+
+#define FRAG_HEADER_LEN  (FRAME_HEADER_LEN + 5)
+#define FRAG_MAX_COUNT   64   ///< Fragments per message (reassembly bitmap)
+
+/**
+ * @brief One received fragment, pointing into the packet buffer.
+ */
+typedef struct {
+    FrameHeader hdr;
+    uint8_t msg_id;        ///< Message ID
+    uint8_t index;         ///< Fragment index
+    uint8_t count;         ///< Number of fragments of the message
+    uint16_t msg_len;      ///< Length of the whole message
+    const uint8_t *data;   ///< Fragment payload
+    size_t data_len;       ///< Fragment payload length
+} FrameFragment;
+
+/**
+ * @brief Partial message in the reassembly pool.
+ */
+typedef struct {
+    uint8_t used;
+    uint16_t device_id;
+    uint8_t msg_id;
+    uint8_t count;
+    uint8_t received;      ///< Distinct fragments received
+    uint16_t msg_len;
+    uint64_t have;         ///< Bit i set when fragment i was received
+    uint32_t last_ms;      ///< Time of the last fragment
+    uint8_t data[CONFIG_FRAME_REASM_MAX_LEN];
+} FragSlot;
+
+/**
+ * @brief Reassembly pool and its counters.
+ */
+typedef struct {
+    FragSlot slots[CONFIG_FRAME_REASM_SLOTS];
+    uint32_t completed;    ///< Messages delivered
+    uint32_t evicted;      ///< Partial messages dropped (timeout or pool full)
+    uint32_t rejected;     ///< Fragments inconsistent with their message
+} FragReasm;
+
+/**
+ * @brief Number of fragments needed for a message.
+ * @param msg_len Message length.
+ * @param frag_len Largest fragment on air, headers included.
+ * @return Fragment count, or -1 if the message cannot be fragmented.
+ */
+int frag_count(size_t msg_len, size_t frag_len);
+
+/**
+ * @brief Encode one fragment of a message.
+ * @param hdr Header (type is set by the encoder, seq is the fragment's own).
+ * @param msg_id Message ID, the same for all fragments of the message.
+ * @param msg Message.
+ * @param msg_len Message length.
+ * @param frag_len Largest fragment on air, the same for all fragments.
+ * @param index Fragment index, 0 .. frag_count() - 1.
+ * @param buf Output buffer.
+ * @param len Size of @p buf.
+ * @return Fragment length, or -1 on invalid arguments.
+ */
+int frag_encode(const FrameHeader *hdr, uint8_t msg_id, const uint8_t *msg, size_t msg_len,
+                size_t frag_len, int index, uint8_t *buf, size_t len);
+
+/**
+ * @brief Parse a received fragment.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param f Output fragment, its data points into @p buf.
+ * @return 0 on success, -1 if @p buf is not a consistent fragment.
+ */
+int frag_parse(const uint8_t *buf, size_t len, FrameFragment *f);
+
+/**
+ * @brief Empty the reassembly pool and reset its counters.
+ * @param r Pool.
+ */
+void frag_reasm_init(FragReasm *r);
+
+/**
+ * @brief Add a fragment to its message.
+ * @param r Pool.
+ * @param f Fragment from frag_parse().
+ * @param now_ms Current time in milliseconds (wraps).
+ * @param msg Output complete message, valid until the next call.
+ * @return Message length when @p f completes it, 0 while incomplete
+ *         (duplicates included), -1 if the fragment is rejected.
+ */
+int frag_reasm_push(FragReasm *r, const FrameFragment *f, uint32_t now_ms, const uint8_t **msg);
+
+/**
+ * @brief Evict the partial messages older than CONFIG_FRAME_REASM_TIMEOUT_MS.
+ * @param r Pool.
+ * @param now_ms Current time in milliseconds (wraps).
+ * @return Number of evicted messages.
+ */
+int frag_reasm_expire(FragReasm *r, uint32_t now_ms);
+
+#endif // FRAG_H
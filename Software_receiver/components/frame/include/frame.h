@@ -0,0 +1,191 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file frame.h
+ * @brief Binary LoRa frame format shared by the sender, the receiver and API/index.js.
+ *
+ * Every frame starts with a 4-byte header, little-endian:
+ *
+ *   byte 0     version (high nibble) | frame type (low nibble)
+ *   bytes 1-2  device ID
+ *   byte 3     sequence number
+ *
+ * A measurement frame (FRAME_TYPE_MEASURE, 12 bytes) follows with:
+ *
+ *   byte 4      validity bitmap (bit 0 temp, 1 press, 2 hum, 3 sound)
+ *   bytes 5-6   temperature, int16, 0.01 °C
+ *   bytes 7-8   pressure, uint16, 0.1 hPa
+ *   byte 9      humidity, uint8, 0.5 %RH
+ *   bytes 10-11 sound level, uint16, 0.01 dB SPL
+ *
+ * A batch frame (FRAME_TYPE_BATCH) carries several cycles, oldest first:
+ *
+ *   byte 4      number of samples N
+ *   bytes 5-6   interval between samples, uint16, seconds
+ *   then        ceil(N / 2) bytes of validity bitmaps, one nibble per sample
+ *               (low nibble first)
+ *   then        per sample, per channel (temp, press, hum, sound): the
+ *               quantized value in tscomp.h delta-of-delta varint coding
+ *
+ * Missing channels are coded as their predicted value, which costs one byte.
+ *
+ * Messages longer than one packet are split into FRAME_TYPE_FRAG frames,
+ * see frag.h.
+ *
+ * An acknowledgement (FRAME_TYPE_ACK, 4 bytes) is sent by the receiver with
+ * the device ID and sequence number of the frame it acknowledges.
+ *
+ * Repair frames (FRAME_TYPE_FEC) rebuild lost frames of a group, see fec.h.
+ *
+ * A configuration frame (FRAME_TYPE_CONFIG) is an acknowledgement followed
+ * by commands for the sender, see downlink.h.
+ *
+ * A beacon (FRAME_TYPE_BEACON) is sent by the receiver at the start of each
+ * TDMA period with the slot layout, see beacon.h.
+ *
+ * A sender's backlog goes in a bulk transfer (FRAME_TYPE_BULK) over FSK,
+ * see bulk.h.
+ *
+ * JSON packets start with '{', which is never a valid first frame byte, so
+ * both formats can share the link. Decoding never allocates.
+ */
+
+#define FRAME_VERSION      1
+#define FRAME_HEADER_LEN   4
+#define FRAME_MEASURE_LEN  12
+#define FRAME_ACK_LEN      4
+#define FRAME_BATCH_HEADER_LEN 7
+#define FRAME_MAX_LEN      255   ///< SX1276 FIFO
+#define FRAME_BATCH_MAX    64    ///< Samples in one batch frame
+#define FRAME_CHANNELS     4     ///< temp, press, hum, sound
+
+/**
+ * @enum FrameType
+ * @brief Frame types (low nibble of byte 0).
+ */
+typedef enum {
+    FRAME_TYPE_MEASURE = 1,   ///< One averaged measurement per sensor
+    FRAME_TYPE_BATCH = 2,     ///< Compressed measurements of several cycles
+    FRAME_TYPE_FRAG = 3,      ///< Fragment of a longer message (frag.h)
+    FRAME_TYPE_ACK = 4,       ///< Receiver acknowledgement (header only)
+    FRAME_TYPE_FEC = 5,       ///< Repair frame of a group of frames (fec.h)
+    FRAME_TYPE_CONFIG = 6,    ///< Acknowledgement with configuration commands (downlink.h)
+    FRAME_TYPE_BEACON = 7,    ///< Receiver time beacon and slot layout (beacon.h)
+    FRAME_TYPE_BULK = 8,      ///< Bulk transfer of a backlog over FSK (bulk.h)
+} FrameType;
+
+/**
+ * @brief Common frame header.
+ */
+typedef struct {
+    uint8_t type;         ///< FrameType
+    uint16_t device_id;   ///< Sender ID (low bytes of its MAC address)
+    uint8_t seq;          ///< Sequence number, wraps at 256
+} FrameHeader;
+
+/**
+ * @brief Content of a measurement frame, in physical units.
+ */
+typedef struct {
+    FrameHeader hdr;
+    uint8_t valid;        ///< Validity bitmap (bit 0 temp, 1 press, 2 hum, 3 sound)
+    float temp;           ///< °C
+    float press;          ///< hPa
+    float hum;            ///< %RH
+    float sound;          ///< dB SPL
+} FrameMeasure;
+
+/**
+ * @brief One measurement in frame units (0.01 °C, 0.1 hPa, 0.5 %RH, 0.01 dB).
+ */
+typedef struct {
+    uint8_t valid;                   ///< Validity bitmap
+    int32_t q[FRAME_CHANNELS];       ///< Quantized values, 0 when invalid
+} FrameSample;
+
+/**
+ * @brief Convert a measurement to frame units, rounded and clamped.
+ * @param m Measurement (header ignored).
+ * @param s Output sample.
+ */
+void frame_quantize(const FrameMeasure *m, FrameSample *s);
+
+/**
+ * @brief Convert a sample back to physical units.
+ * @param s Sample.
+ * @param m Output measurement (header left unchanged).
+ */
+void frame_dequantize(const FrameSample *s, FrameMeasure *m);
+
+/**
+ * @brief Parse the header of a received frame.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param hdr Output header.
+ * @return 0 on success, -1 if @p buf is not a frame of this version.
+ */
+int frame_parse_header(const uint8_t *buf, size_t len, FrameHeader *hdr);
+
+/**
+ * @brief Encode an acknowledgement.
+ * @param hdr Device ID and sequence number of the acknowledged frame.
+ * @param buf Output buffer.
+ * @param len Size of @p buf.
+ * @return Frame length (FRAME_ACK_LEN), or -1 if @p buf is too small.
+ */
+int frame_encode_ack(const FrameHeader *hdr, uint8_t *buf, size_t len);
+
+/**
+ * @brief Encode a measurement frame.
+ *
+ * Values are rounded and clamped to their field range; invalid channels are
+ * encoded as 0.
+ *
+ * @param m Measurement to encode.
+ * @param buf Output buffer.
+ * @param len Size of @p buf.
+ * @return Frame length (FRAME_MEASURE_LEN), or -1 if @p buf is too small.
+ */
+int frame_encode_measure(const FrameMeasure *m, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode a measurement frame.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param m Output measurement.
+ * @return 0 on success, -1 if @p buf is not a valid measurement frame.
+ */
+int frame_decode_measure(const uint8_t *buf, size_t len, FrameMeasure *m);
+
+/**
+ * @brief Encode as many samples as fit into one batch frame.
+ * @param hdr Header (type is set by the encoder).
+ * @param interval_s Interval between samples in seconds.
+ * @param samples Samples, oldest first.
+ * @param count Number of samples (at most FRAME_BATCH_MAX are used).
+ * @param buf Output buffer.
+ * @param len Size of @p buf (at most FRAME_MAX_LEN is used).
+ * @param encoded Output number of samples written, the rest go in a later frame.
+ * @return Frame length, or -1 if not even one sample fits.
+ */
+int frame_encode_batch(const FrameHeader *hdr, uint16_t interval_s, const FrameSample *samples,
+                       int count, uint8_t *buf, size_t len, int *encoded);
+
+/**
+ * @brief Decode a batch frame.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param hdr Output header.
+ * @param interval_s Output interval between samples in seconds.
+ * @param samples Output samples, oldest first.
+ * @param max Capacity of @p samples.
+ * @return Number of samples, or -1 if @p buf is not a valid batch frame.
+ */
+int frame_decode_batch(const uint8_t *buf, size_t len, FrameHeader *hdr, uint16_t *interval_s,
+                       FrameSample *samples, int max);
+
+#endif // FRAME_H
@@ -0,0 +1,85 @@
+#ifndef TSCOMP_H
+#define TSCOMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file tscomp.h
+ * @brief Streaming delta-of-delta / zig-zag varint codec for quantized time series.
+ *
+ * Each value is predicted as previous + previous delta; the difference to
+ * the prediction (delta-of-delta) is zig-zag mapped to an unsigned integer
+ * and written as a little-endian base-128 varint. Slowly varying sensor
+ * readings mostly cost one byte per value.
+ */
+
+/**
+ * @brief Output byte stream.
+ */
+typedef struct {
+    uint8_t *buf;   ///< Destination buffer
+    size_t cap;     ///< Size of buf
+    size_t len;     ///< Bytes written
+} TsWriter;
+
+/**
+ * @brief Input byte stream.
+ */
+typedef struct {
+    const uint8_t *buf;   ///< Source buffer
+    size_t len;           ///< Size of buf
+    size_t pos;           ///< Next byte to read
+} TsReader;
+
+/**
+ * @brief Predictor state of one channel, zero-initialize before the first value.
+ */
+typedef struct {
+    int32_t prev;    ///< Last value
+    int32_t delta;   ///< Last delta
+} TsChannel;
+
+static inline uint32_t ts_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t ts_unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+/**
+ * @brief Value the channel expects next (used to fill missing samples cheaply).
+ */
+static inline int32_t ts_predict(const TsChannel *c)
+{
+    return c->prev + c->delta;
+}
+
+/**
+ * @brief Write an unsigned varint.
+ * @return 0 on success, -1 if the writer is full (nothing written).
+ */
+int ts_put_varint(TsWriter *w, uint32_t v);
+
+/**
+ * @brief Read an unsigned varint.
+ * @return 0 on success, -1 on truncated or oversized input.
+ */
+int ts_get_varint(TsReader *r, uint32_t *v);
+
+/**
+ * @brief Encode the next value of a channel.
+ * @return 0 on success, -1 if the writer is full (channel state unchanged).
+ */
+int ts_encode(TsChannel *c, TsWriter *w, int32_t value);
+
+/**
+ * @brief Decode the next value of a channel.
+ * @return 0 on success, -1 on malformed input.
+ */
+int ts_decode(TsChannel *c, TsReader *r, int32_t *value);
+
+#endif // TSCOMP_H
@@ -0,0 +1,46 @@
+/**
+ * @file beacon.c
+ * @brief Beacon encoder and decoder.
+ */
+
+#include "beacon.h"
+
+int beacon_validate(const BeaconSchedule *s)
+{
+    if (s->period_s == 0 || s->slot_ms == 0 || s->slot_count == 0) {
+        return -1;
+    }
+    // Beacon slot and sender slots within the period
+    if ((s->slot_count + 1UL) * s->slot_ms > s->period_s * 1000UL) {
+        return -1;
+    }
+    return 0;
+}
+
+int beacon_encode(const FrameHeader *hdr, const BeaconSchedule *s, uint8_t *buf, size_t len)
+{
+    if (beacon_validate(s) != 0 || len < BEACON_LEN) {
+        return -1;
+    }
+    buf[0] = (FRAME_VERSION << 4) | FRAME_TYPE_BEACON;
+    buf[1] = hdr->device_id & 0xff;
+    buf[2] = hdr->device_id >> 8;
+    buf[3] = hdr->seq;
+    buf[4] = s->period_s & 0xff;
+    buf[5] = s->period_s >> 8;
+    buf[6] = s->slot_ms & 0xff;
+    buf[7] = s->slot_ms >> 8;
+    buf[8] = s->slot_count;
+    return BEACON_LEN;
+}
+
+int beacon_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, BeaconSchedule *s)
+{
+    if (len != BEACON_LEN || frame_parse_header(buf, len, hdr) != 0 || hdr->type != FRAME_TYPE_BEACON) {
+        return -1;
+    }
+    s->period_s = buf[4] | (buf[5] << 8);
+    s->slot_ms = buf[6] | (buf[7] << 8);
+    s->slot_count = buf[8];
+    return beacon_validate(s);
+}
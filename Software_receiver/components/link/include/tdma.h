@@ -0,0 +1,119 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <stdint.h>
+#include "beacon.h"
+
+/**
+ * @file tdma.h
+ * @brief Sender side of the beacon-synchronized TDMA schedule.
+ *
+ * The receiver sends a beacon every period (beacon.h). A sender transmits
+ * in the slot given by its device ID, so senders with different slots
+ * never overlap. Between beacons the sender sleeps on its own clock, which
+ * drifts: each wake-up opens a short receive window around the predicted
+ * beacon, and the beacon heard measures the drift that corrects the next
+ * prediction. The window widens with the time since the last beacon heard,
+ * by the drift allowed.
+ *
+ * After a number of beacons missed in a row the sender is no
+ * longer synchronized: it sends at once (ALOHA) and searches for a beacon
+ * after sending, less and less often while none comes.
+ *
+ * Times are on the sender's clock that runs through deep sleep, in
+ * microseconds.
+ */
+
+/**
+ * @brief Tuning of the sender's synchronization.
+ */
+typedef struct {
+    uint16_t guard_ms;    ///< Receive window on each side of a beacon just after the last one
+    uint16_t drift_ppm;   ///< Clock error left after the drift correction
+    uint8_t max_missed;   ///< Beacons missed in a row before synchronization is lost
+} TdmaParams;
+
+/**
+ * @brief Synchronization state, kept across deep sleep.
+ */
+typedef struct {
+    BeaconSchedule sched;   ///< Layout of the last beacon heard
+    int64_t heard_us;       ///< Start of the last beacon heard
+    int64_t anchor_us;      ///< Start of the current period, heard or predicted
+    int32_t drift_ppm;      ///< Sender clock rate minus the receiver's
+    uint8_t synced;
+    uint8_t missed;         ///< Beacons missed in a row
+    uint8_t search_skip;    ///< Cycles before the next search, unsynchronized
+    uint8_t search_backoff; ///< Cycles skipped after the last failed search
+} TdmaSync;
+
+/**
+ * @brief Slot of a sender.
+ * @param s Layout.
+ * @param device_id Sender ID.
+ * @return Slot index, 0 for the first one after the beacon.
+ */
+static inline int tdma_slot_of(const BeaconSchedule *s, uint16_t device_id)
+{
+    return device_id % s->slot_count;
+}
+
+/**
+ * @brief Account for a beacon heard, update the drift estimate.
+ * @param t State.
+ * @param s Layout carried by the beacon.
+ * @param beacon_us Start of the beacon (RxDone less its time on air).
+ * @param p Tuning.
+ * @return Error of the prediction in microseconds, 0 if there was none.
+ */
+int64_t tdma_heard(TdmaSync *t, const BeaconSchedule *s, int64_t beacon_us, const TdmaParams *p);
+
+/**
+ * @brief Account for a beacon missed, carry on with the prediction.
+ * @param t State.
+ * @param predicted_us Predicted start of the missed beacon.
+ * @param p Tuning.
+ * @return 1 while still synchronized, 0 once more than @c max_missed were missed.
+ */
+int tdma_missed(TdmaSync *t, int64_t predicted_us, const TdmaParams *p);
+
+/**
+ * @brief Predicted start of the first beacon at or after a time.
+ * @param t State, synchronized.
+ * @param after_us Time.
+ * @return Predicted beacon start.
+ */
+int64_t tdma_beacon_after(const TdmaSync *t, int64_t after_us);
+
+/**
+ * @brief Half-width of the receive window around a predicted beacon.
+ * @param t State, synchronized.
+ * @param beacon_us Predicted beacon start.
+ * @param p Tuning.
+ * @return The guard time plus the drift possible since the last beacon heard.
+ */
+int64_t tdma_guard_us(const TdmaSync *t, int64_t beacon_us, const TdmaParams *p);
+
+/**
+ * @brief Start of a sender's slot in the current period.
+ * @param t State, synchronized.
+ * @param device_id Sender ID.
+ * @return Slot start.
+ */
+int64_t tdma_slot_us(const TdmaSync *t, uint16_t device_id);
+
+/**
+ * @brief Whether to search for a beacon this cycle, unsynchronized.
+ * @param t State.
+ * @return 1 to search, 0 while backing off.
+ */
+int tdma_search_due(TdmaSync *t);
+
+/**
+ * @brief Account for a search that heard no beacon: the next one waits
+ * twice as many cycles, up to TDMA_SEARCH_BACKOFF_MAX.
+ * @param t State.
+ */
+void tdma_search_failed(TdmaSync *t);
+
+#endif // TDMA_H
@@ -0,0 +1,140 @@
+/**
+ * @file adr.c
+ * @brief Adaptive data rate decisions on the receiver.
+ */
+
+#include <math.h>
+#include "adr.h"
+
+#define ADR_STEP_DB   3.0f
+#define ADR_SNR_NONE  -100.0f   ///< Best SNR before any frame
+
+float adr_required_snr(int sf)
+{
+    // -5 dB at SF6, 2.5 dB lower per step up to -20 dB at SF12
+    return -5.0f - 2.5f * (sf - 6);
+}
+
+int adr_decide(float snr_max, const AdrParams *p, uint8_t *sf, uint8_t *tx_power)
+{
+    int s = *sf < p->sf_min ? p->sf_min : *sf > p->sf_max ? p->sf_max : *sf;
+    int pw = *tx_power;
+    int steps = (int)floorf((snr_max - adr_required_snr(s) - p->margin_db) / ADR_STEP_DB);
+
+    // Airtime first: a lower spreading factor saves more than a lower power
+    while (steps > 0 && s > p->sf_min) {
+        s--;
+        steps--;
+    }
+    while (steps > 0 && pw > DOWNLINK_TX_POWER_MIN) {
+        pw = pw - 3 < DOWNLINK_TX_POWER_MIN ? DOWNLINK_TX_POWER_MIN : pw - 3;
+        steps--;
+    }
+    // Short of margin: power first, it costs no airtime
+    while (steps < 0 && pw < DOWNLINK_TX_POWER_MAX) {
+        pw = pw + 3 > DOWNLINK_TX_POWER_MAX ? DOWNLINK_TX_POWER_MAX : pw + 3;
+        steps++;
+    }
+    while (steps < 0 && s < p->sf_max) {
+        s++;
+        steps++;
+    }
+
+    if (s == *sf && pw == *tx_power) {
+        return 0;
+    }
+    *sf = s;
+    *tx_power = pw;
+    return 1;
+}
+
+/**
+ * @brief Entry of a sender, NULL if not tracked.
+ */
+static AdrPeer *adr_find(AdrPeers *t, uint16_t device_id)
+{
+    for (int i = 0; i < LINK_MAX_PEERS; i++) {
+        if (t->peers[i].used && t->peers[i].device_id == device_id) {
+            return &t->peers[i];
+        }
+    }
+    return NULL;
+}
+
+int adr_update(AdrPeers *t, uint16_t device_id, uint8_t seq, float snr, uint8_t sf_heard,
+               const AdrParams *p, DownlinkConfig *out)
+{
+    AdrPeer *e = adr_find(t, device_id);
+    if (!e) {
+        // New sender, in a free entry or in place of the one with the shortest history
+        e = &t->peers[0];
+        for (int i = 0; i < LINK_MAX_PEERS; i++) {
+            if (!t->peers[i].used) {
+                e = &t->peers[i];
+                break;
+            }
+            if (t->peers[i].count < e->count) {
+                e = &t->peers[i];
+            }
+        }
+        *e = (AdrPeer){ .used = 1, .device_id = device_id, .sf = sf_heard,
+                        .tx_power = DOWNLINK_TX_POWER_MAX, .seq = seq, .snr_max = ADR_SNR_NONE };
+    }
+    if ((uint8_t)(seq - e->seq) > 1) {
+        // Frames lost: the sender may have raised its power by itself
+        e->tx_power = DOWNLINK_TX_POWER_MAX;
+        e->count = 0;
+        e->snr_max = ADR_SNR_NONE;
+    }
+    e->seq = seq;
+    if (e->sf != sf_heard) {
+        // The sender went back to other settings by itself
+        e->sf = sf_heard;
+        e->count = 0;
+        e->snr_max = ADR_SNR_NONE;
+    }
+
+    if (snr > e->snr_max) {
+        e->snr_max = snr;
+    }
+    if (++e->count < p->history) {
+        return 0;
+    }
+    float snr_max = e->snr_max;
+    e->count = 0;
+    e->snr_max = ADR_SNR_NONE;
+
+    uint8_t sf = e->sf;
+    uint8_t tx_power = e->tx_power;
+    if (!adr_decide(snr_max, p, &sf, &tx_power)) {
+        return 0;
+    }
+    *out = (DownlinkConfig){ 0 };
+    if (sf != e->sf) {
+        out->set |= 1 << DOWNLINK_SF;
+        out->sf = sf;
+    }
+    if (tx_power != e->tx_power) {
+        out->set |= 1 << DOWNLINK_TX_POWER;
+        out->tx_power = tx_power;
+    }
+    e->sf = sf;
+    e->tx_power = tx_power;
+    return 1;
+}
+
+void adr_note_downlink(AdrPeers *t, uint16_t device_id, const DownlinkConfig *c)
+{
+    AdrPeer *e = adr_find(t, device_id);
+    if (!e || !(c->set & ((1 << DOWNLINK_SF) | (1 << DOWNLINK_TX_POWER)))) {
+        return;
+    }
+    if (c->set & (1 << DOWNLINK_SF)) {
+        e->sf = c->sf;
+    }
+    if (c->set & (1 << DOWNLINK_TX_POWER)) {
+        e->tx_power = c->tx_power;
+    }
+    e->count = 0;
+    e->snr_max = ADR_SNR_NONE;
+}
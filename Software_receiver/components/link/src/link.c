@@ -0,0 +1,371 @@
+/**
+ * @file link.c
+ * @brief ACK receive window, retransmissions, configuration downlinks, FEC
+ * repair frames and bulk transfers.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "link.h"
+#include "fec.h"
+#include "lora.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define TAG "LINK"
+
+static RTC_DATA_ATTR LinkTxStats s_tx;
+
+/**
+ * @brief Commands queued by the receiver for one sender.
+ */
+typedef struct {
+    uint16_t device_id;
+    uint8_t remaining;   ///< ACKs still to be replaced by the commands, 0 when free
+    DownlinkConfig cfg;
+} LinkDownlink;
+
+static LinkDownlink s_queue[LINK_MAX_PEERS];
+
+// Commands received by the sender with an ACK
+static DownlinkConfig s_downlink;
+static int s_downlink_pending;
+
+// Frames granted by the receiver's answer to a bulk request
+static int s_bulk_granted;
+
+#define LINK_BULK_SWITCH_MS 20   // Receiver switching to FSK after its answer
+
+#if CONFIG_FEC_ENABLE
+static RTC_DATA_ATTR FecEncoder s_fec;
+
+/**
+ * @brief Send the repair frames of the current group and start the next one.
+ */
+static void link_fec_flush(uint16_t device_id)
+{
+    uint8_t buf[FRAME_MAX_LEN];
+    for (int j = 0; j < s_fec.m; j++) {
+        int n = fec_encode_repair(&s_fec, device_id, j, buf, sizeof(buf));
+        if (n > 0) {
+            lora_channel_hop(device_id);
+            if (lora_send_packet(buf, n) != 0) {
+                break;   // Out of budget, the next repairs would be refused too
+            }
+            s_tx.repairs++;
+        }
+    }
+    fec_encoder_init(&s_fec, CONFIG_FEC_K, CONFIG_FEC_M);
+}
+
+/**
+ * @brief Add a sent frame to the current group, send the repairs when it is full.
+ */
+static void link_fec_add(const uint8_t *pkt, int len, uint16_t device_id)
+{
+    if (s_fec.k == 0) {
+        fec_encoder_init(&s_fec, CONFIG_FEC_K, CONFIG_FEC_M);   // First boot
+    }
+    int n = fec_encoder_add(&s_fec, pkt, len);
+    if (n < 0 && s_fec.count > 0) {
+        // Too long for a repair frame, or not the next sequence number: close the group early
+        link_fec_flush(device_id);
+        n = fec_encoder_add(&s_fec, pkt, len);
+    }
+    if (n == s_fec.k) {
+        link_fec_flush(device_id);
+    }
+}
+#endif
+
+#if CONFIG_LINK_ACK_ENABLE
+/**
+ * @brief Listen for the ACK of a frame until the window closes.
+ * @return 1 if the ACK came.
+ */
+static int link_wait_ack(const FrameHeader *sent)
+{
+    const int64_t end = esp_timer_get_time() + CONFIG_LINK_ACK_TIMEOUT_MS * 1000LL;
+    uint8_t buf[FRAME_MAX_LEN];
+    FrameHeader hdr;
+
+    lora_receive();
+    while (esp_timer_get_time() < end) {
+        // Sleeps until RxDone with the DIO0 interrupt
+        if (!lora_wait_received((end - esp_timer_get_time() + 999) / 1000)) {
+            continue;
+        }
+        int len = lora_receive_packet(buf, sizeof(buf));
+        if (len > 0 && frame_parse_header(buf, len, &hdr) == 0
+            && hdr.device_id == sent->device_id && hdr.seq == sent->seq) {
+            DownlinkConfig cfg;
+            BulkMsg bulk;
+            if (hdr.type == FRAME_TYPE_CONFIG && downlink_decode(buf, len, &hdr, &cfg) == 0) {
+                s_downlink = cfg;
+                s_downlink_pending = 1;
+            }
+            if (hdr.type == FRAME_TYPE_BULK && bulk_decode(buf, len, &hdr, &bulk) == 0
+                && bulk.op == BULK_ACCEPT) {
+                s_bulk_granted = bulk.count;
+                lora_idle();
+                return 1;
+            }
+            if (hdr.type == FRAME_TYPE_ACK || hdr.type == FRAME_TYPE_CONFIG) {
+                // A CONFIG frame rejected by downlink_decode() still acknowledges the frame
+                lora_idle();
+                return 1;
+            }
+        }
+        // Another node's traffic, keep listening
+        lora_receive();
+    }
+    lora_idle();
+    return 0;
+}
+
+/**
+ * @brief Send a frame until it is acknowledged or the retries run out.
+ * @return 1 if acknowledged, LINK_REFUSED if a transmission was refused.
+ */
+static int link_deliver(uint8_t *pkt, int len, const FrameHeader *hdr)
+{
+    int acked = 0;
+    for (int attempt = 0; attempt <= CONFIG_LINK_ACK_RETRIES && !acked; attempt++) {
+        lora_channel_hop(hdr->device_id);   // The ACK comes back on the same channel
+        if (lora_send_packet(pkt, len) != 0) {
+            // The budget does not refill within a retry, nothing to wait for
+            s_tx.refused++;
+            ESP_LOGW(TAG, "Frame seq %u refused by the duty-cycle budget", hdr->seq);
+            return LINK_REFUSED;
+        }
+        if (attempt == 0) {
+            s_tx.sent++;
+        }
+        s_tx.attempts++;
+        acked = link_wait_ack(hdr);
+        if (!acked) {
+            ESP_LOGD(TAG, "No ACK for seq %u (attempt %d)", hdr->seq, attempt + 1);
+        }
+    }
+    if (acked) {
+        s_tx.acked++;
+    } else {
+        ESP_LOGW(TAG, "Frame seq %u not acknowledged after %d attempts", hdr->seq, CONFIG_LINK_ACK_RETRIES + 1);
+    }
+    return acked;
+}
+#endif
+
+int link_send(uint8_t *pkt, int len)
+{
+    FrameHeader hdr;
+    int acked = 0;
+    if (frame_parse_header(pkt, len, &hdr) != 0) {
+        lora_channel_hop(0);   // No header: channel 0 when assigned by device
+        if (lora_send_packet(pkt, len) != 0) {
+            s_tx.refused++;
+            return LINK_REFUSED;
+        }
+        return 0;
+    }
+
+#if CONFIG_LINK_ACK_ENABLE
+    acked = link_deliver(pkt, len, &hdr);
+#else
+    // Nothing to listen for: return while the frame is on air, the next radio call waits for it
+    lora_channel_hop(hdr.device_id);
+    if (lora_send_packet_async(pkt, len, NULL, NULL) != 0) {
+        s_tx.refused++;
+        acked = LINK_REFUSED;
+    } else {
+        s_tx.attempts++;
+    }
+#endif
+#if CONFIG_FEC_ENABLE
+    link_fec_add(pkt, len, hdr.device_id);
+#endif
+    return acked;
+}
+
+void link_send_ack(const FrameHeader *hdr)
+{
+    for (int i = 0; i < LINK_MAX_PEERS; i++) {
+        LinkDownlink *q = &s_queue[i];
+        if (q->remaining && q->device_id == hdr->device_id) {
+            uint8_t buf[DOWNLINK_MAX_LEN];
+            int n = downlink_encode(hdr, &q->cfg, buf, sizeof(buf));
+            if (n > 0) {
+                lora_send_packet(buf, n);
+                q->remaining--;
+                return;
+            }
+        }
+    }
+    uint8_t ack[FRAME_ACK_LEN];
+    frame_encode_ack(hdr, ack, sizeof(ack));
+    lora_send_packet(ack, sizeof(ack));
+}
+
+void link_send_beacon(uint16_t device_id, uint8_t seq, const BeaconSchedule *s)
+{
+    FrameHeader hdr = { .device_id = device_id, .seq = seq };
+    uint8_t buf[BEACON_LEN];
+    if (beacon_encode(&hdr, s, buf, sizeof(buf)) < 0) {
+        ESP_LOGE(TAG, "Invalid beacon layout");
+        return;
+    }
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+    lora_set_channel(0);
+#endif
+    lora_send_packet(buf, sizeof(buf));
+}
+
+int link_wait_beacon(int timeout_ms, BeaconSchedule *s, int64_t *start_us)
+{
+    const int64_t end = esp_timer_get_time() + timeout_ms * 1000LL;
+    uint8_t buf[FRAME_MAX_LEN];
+    FrameHeader hdr;
+
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+    lora_set_channel(0);
+#endif
+    lora_receive();
+    while (esp_timer_get_time() < end) {
+        if (!lora_wait_received((end - esp_timer_get_time() + 999) / 1000)) {
+            continue;
+        }
+        // Timestamp first, the task wakes on RxDone with the DIO0 interrupt
+        int64_t rx_us = esp_timer_get_time();
+        int len = lora_receive_packet(buf, sizeof(buf));
+        if (len > 0 && beacon_decode(buf, len, &hdr, s) == 0) {
+            *start_us = rx_us - lora_time_on_air_us(len);
+            lora_idle();
+            return 1;
+        }
+        // A sender's frame, keep listening
+        lora_receive();
+    }
+    lora_idle();
+    return 0;
+}
+
+#if CONFIG_LINK_ACK_ENABLE
+int link_bulk_begin(uint16_t device_id, uint8_t *seq, int frames)
+{
+    FrameHeader hdr = { .device_id = device_id, .seq = (*seq)++ };
+    BulkMsg m = { .op = BULK_REQUEST, .count = frames > UINT8_MAX ? UINT8_MAX : frames };
+    uint8_t buf[BULK_CONTROL_LEN];
+    if (frames <= 0 || bulk_encode(&hdr, &m, buf, sizeof(buf)) < 0) {
+        return 0;
+    }
+    // A receiver without bulk transfers answers with a plain ACK: nothing granted
+    s_bulk_granted = 0;
+    if (link_deliver(buf, sizeof(buf), &hdr) != 1 || s_bulk_granted == 0) {
+        return 0;
+    }
+    lora_set_modem(LORA_MODEM_FSK);
+    vTaskDelay(pdMS_TO_TICKS(LINK_BULK_SWITCH_MS));
+    return s_bulk_granted;
+}
+
+int link_bulk_send(const uint8_t *frame, int len, uint32_t age_s)
+{
+    FrameHeader hdr;
+    BulkMsg m = { .op = BULK_DATA, .age_s = age_s, .frame = frame, .frame_len = len };
+    uint8_t buf[FRAME_MAX_LEN];
+    if (frame_parse_header(frame, len, &hdr) != 0) {
+        return 0;
+    }
+    int n = bulk_encode(&hdr, &m, buf, sizeof(buf));
+    // Not added to the FEC group: every frame of the burst is acknowledged
+    return n > 0 && link_deliver(buf, n, &hdr) == 1;
+}
+
+void link_bulk_end(uint16_t device_id, uint8_t *seq)
+{
+    FrameHeader hdr = { .device_id = device_id, .seq = (*seq)++ };
+    BulkMsg m = { .op = BULK_END };
+    uint8_t buf[BULK_END_LEN];
+    bulk_encode(&hdr, &m, buf, sizeof(buf));
+    // Acknowledged and retried like the data, a receiver that misses it goes back to LoRa
+    // after its idle timeout
+    link_deliver(buf, sizeof(buf), &hdr);
+    lora_set_modem(LORA_MODEM_LORA);
+}
+#endif
+
+void link_send_bulk_accept(const FrameHeader *hdr, uint8_t granted)
+{
+    BulkMsg m = { .op = BULK_ACCEPT, .count = granted };
+    uint8_t buf[BULK_CONTROL_LEN];
+    bulk_encode(hdr, &m, buf, sizeof(buf));
+    lora_send_packet(buf, sizeof(buf));
+}
+
+int link_queue_downlink(uint16_t device_id, const DownlinkConfig *c)
+{
+#if CONFIG_LINK_ACK_ENABLE
+    if (downlink_validate(c) != 0) {
+        return -1;
+    }
+    LinkDownlink *slot = NULL;
+    for (int i = 0; i < LINK_MAX_PEERS; i++) {
+        LinkDownlink *q = &s_queue[i];
+        if (q->remaining && q->device_id == device_id) {
+            slot = q;
+            break;
+        }
+        if (!q->remaining && !slot) {
+            slot = q;
+        }
+    }
+    if (!slot) {
+        return -1;
+    }
+    if (!slot->remaining || slot->device_id != device_id) {
+        slot->cfg = (DownlinkConfig){ 0 };
+    }
+    // Merge: the new values replace the queued ones, other commands stay
+    DownlinkConfig *q = &slot->cfg;
+    if (c->set & (1 << DOWNLINK_SLEEP_S)) {
+        q->sleep_s = c->sleep_s;
+    }
+    if (c->set & (1 << DOWNLINK_SAMPLE_COUNT)) {
+        q->sample_count = c->sample_count;
+    }
+    if (c->set & (1 << DOWNLINK_SAMPLE_PERIOD_MS)) {
+        q->sample_period_ms = c->sample_period_ms;
+    }
+    if (c->set & (1 << DOWNLINK_SF)) {
+        q->sf = c->sf;
+    }
+    if (c->set & (1 << DOWNLINK_TX_POWER)) {
+        q->tx_power = c->tx_power;
+    }
+    q->set |= c->set;
+    slot->device_id = device_id;
+    slot->remaining = CONFIG_LINK_DOWNLINK_REPEAT;
+    return 0;
+#else
+    // No ACK, so no receive window on the sender
+    (void)device_id;
+    (void)c;
+    return -1;
+#endif
+}
+
+int link_take_downlink(DownlinkConfig *c)
+{
+    if (!s_downlink_pending) {
+        return 0;
+    }
+    *c = s_downlink;
+    s_downlink_pending = 0;
+    return 1;
+}
+
+const LinkTxStats *link_tx_stats(void)
+{
+    return &s_tx;
+}
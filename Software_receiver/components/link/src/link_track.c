@@ -0,0 +1,50 @@
+/**
+ * @file link_track.c
+ * @brief Per-sender sequence tracking on the receiver.
+ */
+
+#include "link.h"
+
+int link_track(LinkPeers *t, uint16_t device_id, uint8_t seq)
+{
+    LinkPeer *p = NULL;
+    for (int i = 0; i < LINK_MAX_PEERS && !p; i++) {
+        if (t->peers[i].used && t->peers[i].device_id == device_id) {
+            p = &t->peers[i];
+        }
+    }
+    if (!p) {
+        // New sender, in a free entry or in place of the one with the fewest frames
+        p = &t->peers[0];
+        for (int i = 0; i < LINK_MAX_PEERS; i++) {
+            if (!t->peers[i].used) {
+                p = &t->peers[i];
+                break;
+            }
+            if (t->peers[i].received < p->received) {
+                p = &t->peers[i];
+            }
+        }
+        *p = (LinkPeer){ .used = 1, .device_id = device_id, .last_seq = seq, .received = 1 };
+        return 1;
+    }
+
+    uint8_t delta = seq - p->last_seq;
+    if (delta == 0) {
+        p->duplicates++;
+        return 0;
+    }
+    if (delta < 128) {
+        p->missed += delta - 1;
+    } else if ((uint8_t)(p->last_seq - seq) <= LINK_LATE_WINDOW) {
+        // Frame counted as missed, delivered late
+        if (p->missed) {
+            p->missed--;
+        }
+        p->received++;
+        return 1;
+    }
+    p->last_seq = seq;
+    p->received++;
+    return 1;
+}
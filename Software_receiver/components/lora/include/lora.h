@@ -1,6 +1,8 @@
 #ifndef __LORA_H__
 #define __LORA_H__
 
+#include <stdint.h>
+
 /**
  * @brief Initializes the LoRa module.
  * 
@@ -22,6 +24,13 @@ void lora_set_frequency(long frequency);
  */
 void lora_set_spreading_factor(int sf);
 
+/**
+ * @brief Gets the spreading factor from the register shadow (no SPI access).
+ * 
+ * @return int Spreading factor (6 to 12).
+ */
+int lora_get_spreading_factor(void);
+
 /**
  * @brief Sets the bandwidth for LoRa communication.
  * 
@@ -29,6 +38,13 @@ void lora_set_spreading_factor(int sf);
  */
 void lora_set_bandwidth(int sbw);
 
+/**
+ * @brief Gets the bandwidth setting from the register shadow (no SPI access).
+ * 
+ * @return int Bandwidth setting (0 to 9).
+ */
+int lora_get_bandwidth(void);
+
 /**
  * @brief Sets the coding rate for LoRa communication.
  * 
@@ -36,6 +52,86 @@ void lora_set_bandwidth(int sbw);
  */
 void lora_set_coding_rate(int cr);
 
+/**
+ * @brief Gets the coding rate from the register shadow (no SPI access).
+ * 
+ * @return int Coding rate (1 to 4, representing 4/5 to 4/8).
+ */
+int lora_get_coding_rate(void);
+
+/**
+ * @brief Switches to implicit header mode (no PHY header on air).
+ * 
+ * Every packet is then read with the fixed length, the sender must use the
+ * same payload length and coding rate.
+ * 
+ * @param size Fixed payload length in bytes.
+ * @param cr Coding rate (valid values: 1 to 4, representing 4/5 to 4/8).
+ */
+void lora_implicit_header_mode(int size, int cr);
+
+/**
+ * @brief Switches back to explicit header mode (default).
+ */
+void lora_explicit_header_mode(void);
+
+/**
+ * @brief Set the preamble length.
+ * @param length Preamble length in symbols (6-65535).
+ */
+void lora_set_preamble_length(long length);
+
+/**
+ * @brief Get the preamble length (from the register shadow, no SPI access).
+ * @return Preamble length in symbols.
+ */
+long lora_get_preamble_length(void);
+
+#define LORA_CHANNEL_MAX 8   ///< Channels of the plan (EU868: 868.1, 868.3, 868.5, then 867.1 to 867.9 MHz)
+
+/**
+ * @brief Tune to a channel of the plan, after the end of a pending send.
+ * @param ch Channel index (0 to CONFIG_LORA_CHANNEL_COUNT - 1).
+ */
+void lora_set_channel(int ch);
+
+/**
+ * @brief Get the channel set by lora_set_channel() (no SPI access).
+ * @return Channel index.
+ */
+int lora_get_channel(void);
+
+/**
+ * @brief Pick the channel of the next packet, a random one or the one
+ * assigned to @p device_id (CONFIG_LORA_CHANNEL_SELECT). Does nothing with a
+ * single channel.
+ * @param device_id Sender ID.
+ */
+void lora_channel_hop(uint16_t device_id);
+
+#define LORA_MODEM_LORA  0   ///< LoRa modem (default)
+#define LORA_MODEM_FSK   1   ///< FSK packet engine, for bulk transfers
+
+/**
+ * @brief Switch between the LoRa modem and the FSK packet engine.
+ *
+ * FSK packets go at CONFIG_LORA_FSK_BITRATE on CONFIG_LORA_FSK_FREQUENCY,
+ * up to 255 bytes, and count against the same duty-cycle budget. Send,
+ * receive, RSSI and time on air follow the modem; CAD, listen-before-talk
+ * and CAD receive are LoRa only. FSK send and receive poll the radio while
+ * a packet is on air, the FIFO has no interrupt, and sleep or yield between
+ * polls (CONFIG_LORA_FSK_BITRATE).
+ * LoRa settings changed in FSK apply on the way back.
+ * @param modem LORA_MODEM_LORA or LORA_MODEM_FSK.
+ */
+void lora_set_modem(int modem);
+
+/**
+ * @brief Get the modem in use.
+ * @return LORA_MODEM_LORA or LORA_MODEM_FSK.
+ */
+int lora_get_modem(void);
+
 /**
  * @brief Puts the LoRa module into receive mode.
  */
@@ -57,6 +153,164 @@ int lora_receive_packet(uint8_t *buf, int size);
  */
 int lora_received(void);
 
+/**
+ * @brief Waits in receive mode until a packet is received.
+ * 
+ * With CONFIG_LORA_DIO0_IRQ the calling task sleeps until the RxDone
+ * interrupt on DIO0, otherwise the IRQ flags are polled.
+ * 
+ * @param timeout_ms Timeout in milliseconds.
+ * @return int Returns 1 if a packet is received, 0 on timeout.
+ */
+int lora_wait_received(int timeout_ms);
+
+/**
+ * @brief Sends a packet and waits for the end of the transmission.
+ * 
+ * @param buf Data to send.
+ * @param size Size of data in bytes.
+ * @return int 0 once sent, -1 if refused: over the duty-cycle budget, or not
+ * the fixed length in implicit header mode. Nothing is sent then.
+ */
+int lora_send_packet(uint8_t *buf, int size);
+
+#define LORA_TX_OK       0   ///< TxDone received
+#define LORA_TX_TIMEOUT  -1  ///< No TxDone before the timeout, counted in lora_packet_lost()
+
+/**
+ * @brief End of an asynchronous send.
+ */
+typedef struct {
+    int status;            ///< LORA_TX_OK or LORA_TX_TIMEOUT
+    int64_t start_us;      ///< Start of the transmission (esp_timer)
+    int64_t done_us;       ///< TxDone, or the timeout (esp_timer)
+    uint32_t airtime_us;   ///< Computed time on air, taken from the duty-cycle budget
+} LoraTxResult;
+
+/**
+ * @brief Called from the LoRa TX task when an asynchronous send ends.
+ * The radio is free again, the callback may start the next send.
+ */
+typedef void (*LoraTxCallback)(const LoraTxResult *res, void *arg);
+
+/**
+ * @brief Start sending a packet and return without waiting for the end.
+ *
+ * The packet is copied to the radio FIFO and the transmission started, the
+ * LoRa TX task then waits for TxDone and calls @p cb. A packet that does not
+ * fit in the duty-cycle budget now is refused, without waiting. A send still
+ * on air is waited for first. lora_send_packet(), lora_receive(), lora_idle()
+ * and lora_sleep() also wait; no other register access or setting change is
+ * allowed until lora_send_wait() returns 1.
+ *
+ * @param buf Data buffer to send, free again on return.
+ * @param size Size of data.
+ * @param cb Completion callback, or NULL.
+ * @param arg Passed to @p cb.
+ * @return 0 if the transmission started, -1 if the packet was refused.
+ */
+int lora_send_packet_async(uint8_t *buf, int size, LoraTxCallback cb, void *arg);
+
+/**
+ * @brief Wait for the end of an asynchronous send.
+ * @param timeout_ms Longest wait in milliseconds, -1 for no limit.
+ * @param res Result of the last asynchronous send, or NULL.
+ * @return 1 if no packet is on air, 0 on timeout.
+ */
+int lora_send_wait(int timeout_ms, LoraTxResult *res);
+
+/**
+ * @brief Listen-before-talk counters, kept across deep sleep.
+ */
+typedef struct {
+    uint32_t cad;           ///< Channel Activity Detections run
+    uint32_t busy;          ///< CADs that found the channel busy, each one deferred a packet
+    uint32_t forced;        ///< Packets sent on a channel still busy after every try
+    uint32_t deferred_ms;   ///< Total backoff time
+} LoraLbtStats;
+
+/**
+ * @brief Run one Channel Activity Detection (about two symbols).
+ *
+ * With CONFIG_LORA_LBT_ENABLE, lora_send_packet() and
+ * lora_send_packet_async() run it before each packet and back off for a
+ * random time while the channel is busy.
+ *
+ * @return 1 if a LoRa preamble was detected, 0 if the channel is free,
+ *         -1 if the radio never signalled CadDone.
+ */
+int lora_cad(void);
+
+/**
+ * @brief Get the listen-before-talk counters.
+ * @return Counters.
+ */
+const LoraLbtStats *lora_lbt_stats(void);
+
+/**
+ * @brief Duty-cycled receive counters, since boot.
+ */
+typedef struct {
+    uint32_t cad;           ///< CADs run
+    uint32_t detected;      ///< CADs that found a preamble
+    uint32_t received;      ///< Packets received after a detection
+    uint32_t false_wakes;   ///< Detections without a packet
+    uint32_t channel_received[LORA_CHANNEL_MAX];   ///< Packets received per channel
+    int64_t active_us;      ///< Time in CAD and RX
+    int64_t sleep_us;       ///< Time in sleep
+} LoraSniffStats;
+
+/**
+ * @brief Configure CAD receive: duty-cycled (preamble sniffing) and/or
+ * scanning the channels of the plan.
+ *
+ * The receiver sleeps @p period_ms between rounds of short CADs, one per
+ * channel, so the preamble must last longer than the sleep and the round.
+ * Both ends call this with the same period (CONFIG_LORA_SNIFF_PERIOD_MS, or
+ * 0 to only scan) after setting the spreading factor and bandwidth: it sets
+ * the preamble length from them, which also makes every packet longer on air.
+ *
+ * @param period_ms Sleep between the receiver's CAD rounds, 0 for none.
+ */
+void lora_sniff_config(int period_ms);
+
+/**
+ * @brief Wait for a packet in CAD receive, in place of lora_receive() and
+ * lora_wait_received().
+ *
+ * Each round runs a CAD on every channel, then the radio sleeps for the
+ * period. On a detection it switches to single receive on that channel
+ * until RxDone, or RxTimeout when the detection was false. The channel is
+ * kept for the ACK.
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ * @return 1 if a packet is received (read it with lora_receive_packet()), 0 on timeout.
+ */
+int lora_sniff_wait(int timeout_ms);
+
+/**
+ * @brief Get the duty-cycled receive counters.
+ * @return Counters.
+ */
+const LoraSniffStats *lora_sniff_stats(void);
+
+/**
+ * @brief Average radio current in duty-cycled receive, estimated from the
+ * time in CAD/RX and in sleep with the SX1276 datasheet currents.
+ * @return Current in microamperes (10800 in continuous receive).
+ */
+int lora_sniff_current_ua(void);
+
+/**
+ * @brief Puts the LoRa module into standby mode.
+ */
+void lora_idle(void);
+
+/**
+ * @brief Puts the LoRa module into sleep mode (lowest current, FIFO lost).
+ */
+void lora_sleep(void);
+
 /**
  * @brief Gets the RSSI (Received Signal Strength Indicator) of the last received packet.
  * 
@@ -86,4 +340,82 @@ void lora_enable_crc(void);
  */
 void lora_disable_crc(void);
 
+/**
+ * @brief Gets the number of packets refused by the duty-cycle budget.
+ * 
+ * @return int Number of refused packets.
+ */
+int lora_packet_refused(void);
+
+/**
+ * @brief Computes the time on air of a packet with the current radio settings.
+ * 
+ * @param size Payload length in bytes.
+ * @return uint32_t Time on air in microseconds.
+ */
+uint32_t lora_time_on_air_us(int size);
+
+/**
+ * @brief Gets the airtime left in the duty-cycle budget.
+ * 
+ * @return int64_t Airtime in microseconds.
+ */
+int64_t lora_airtime_left_us(void);
+
+/**
+ * @brief Gets the time until a packet fits in the duty-cycle budget.
+ * 
+ * @param size Payload length in bytes.
+ * @return int 0 if it can be sent now, the wait in ms, or -1 if it never fits.
+ */
+int lora_airtime_wait_ms(int size);
+
+/**
+ * @brief Defers the configuration setters' register writes.
+ * 
+ * Setters keep a shadow of the configuration registers and only write a
+ * register whose value changes. Between this call and lora_config_commit()
+ * they just mark it dirty. Calls may nest.
+ */
+void lora_config_begin(void);
+
+/**
+ * @brief Writes the dirty configuration registers in one queued sequence.
+ */
+void lora_config_commit(void);
+
+/**
+ * @brief One register write of a lora_write_reg_seq() sequence.
+ */
+typedef struct {
+    uint8_t reg;   ///< Register index
+    uint8_t val;   ///< Value to write
+} LoraRegWrite;
+
+/**
+ * @brief Writes a register with one polling SPI transaction.
+ * 
+ * @param reg Register index.
+ * @param val Value to write.
+ */
+void lora_write_reg(int reg, int val);
+
+/**
+ * @brief Reads a register with one polling SPI transaction.
+ * 
+ * @param reg Register index.
+ * @return int Value of the register.
+ */
+int lora_read_reg(int reg);
+
+/**
+ * @brief Writes several registers with pipelined (queued) SPI transactions.
+ * 
+ * Returns when all writes are done.
+ * 
+ * @param seq Registers and values, written in order.
+ * @param n Number of entries.
+ */
+void lora_write_reg_seq(const LoraRegWrite *seq, int n);
+
 #endif
@@ -0,0 +1,98 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file lora_airtime.h
+ * @brief Time on air of a LoRa or FSK packet and duty-cycle airtime budget.
+ *
+ * The time on air follows the SX1276 datasheet (section 4.1.1.7):
+ *
+ *   Tsym     = 2^SF / BW
+ *   Tpreamble = (Npreamble + 4.25) * Tsym
+ *   Npayload = 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * (CR + 4), 0)
+ *
+ * The budget is a token bucket: it fills at the duty-cycle rate (1% on most
+ * EU868 sub-bands) up to the airtime of a whole window, and every packet
+ * takes its time on air from it. The caller keeps it in RTC memory and feeds
+ * it a clock that runs through deep sleep.
+ */
+
+/**
+ * @brief Modem settings that set the time on air.
+ */
+typedef struct {
+    uint8_t sf;          ///< Spreading factor (6-12)
+    uint32_t bw_hz;      ///< Bandwidth in Hz
+    uint8_t cr;          ///< Coding rate 4/(4+cr), 1 to 4
+    uint16_t preamble;   ///< Programmed preamble length in symbols
+    bool implicit;       ///< Implicit header mode (no PHY header)
+    bool crc;            ///< Payload CRC on
+    bool ldro;           ///< Low data rate optimization on
+} LoraModem;
+
+/**
+ * @brief Airtime budget, all zero until lora_budget_reset().
+ */
+typedef struct {
+    int64_t updated_us;    ///< Clock at the last refill
+    int64_t credit_ns;     ///< Airtime available, ns (no rounding on small refills)
+    int64_t capacity_ns;   ///< Airtime of a whole window at the duty cycle
+    uint16_t permille;     ///< Duty cycle, per mille
+} LoraAirtimeBudget;
+
+/**
+ * @brief Time on air of a packet.
+ * @param m Modem settings.
+ * @param size Payload length in bytes.
+ * @return Time on air in microseconds.
+ */
+uint32_t lora_airtime_us(const LoraModem *m, int size);
+
+/**
+ * @brief Time on air of an FSK packet: preamble, sync word, length byte,
+ * payload and CRC-16.
+ * @param bitrate Bit rate in bit/s.
+ * @param preamble Preamble length in bytes.
+ * @param sync Sync word length in bytes.
+ * @param size Payload length in bytes.
+ * @return Time on air in microseconds.
+ */
+uint32_t lora_fsk_airtime_us(uint32_t bitrate, int preamble, int sync, int size);
+
+/**
+ * @brief Start with a full budget.
+ * @param b Budget.
+ * @param permille Duty cycle, per mille (10 for 1%).
+ * @param window_s Window over which the duty cycle is measured.
+ * @param now_us Current time.
+ */
+void lora_budget_reset(LoraAirtimeBudget *b, int permille, uint32_t window_s, int64_t now_us);
+
+/**
+ * @brief Airtime available now.
+ * @param b Budget, refilled up to @p now_us.
+ * @param now_us Current time.
+ * @return Available airtime in microseconds.
+ */
+int64_t lora_budget_left_us(LoraAirtimeBudget *b, int64_t now_us);
+
+/**
+ * @brief Time until a packet fits in the budget.
+ * @param b Budget, refilled up to @p now_us.
+ * @param airtime_us Time on air of the packet.
+ * @param now_us Current time.
+ * @return 0 if it fits now, the wait in microseconds otherwise, -1 if it never fits.
+ */
+int64_t lora_budget_wait_us(LoraAirtimeBudget *b, uint32_t airtime_us, int64_t now_us);
+
+/**
+ * @brief Take the airtime of a sent packet from the budget.
+ * @param b Budget.
+ * @param airtime_us Time on air of the packet.
+ */
+void lora_budget_consume(LoraAirtimeBudget *b, uint32_t airtime_us);
+
+#endif // LORA_AIRTIME_H
@@ -19,6 +19,530 @@
 #include "esp_log.h"
 #include "lora.h"
 #include "api.h" 
+#include "diag.h"
+#include "binlog.h"
+#include "frame.h"
+#include "frag.h"
+#include "fec.h"
+#include "link.h"
+#include "bulk.h"
+#include "adr.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "cJSON.h"
+
+// Packets are waited for by CAD: duty-cycled, or scanning several channels
+#define CAD_RECEIVE (CONFIG_LORA_SNIFF_ENABLE || CONFIG_LORA_CHANNEL_COUNT > 1)
+
+/**
+ * @brief Delivery counters per sender.
+ */
+static LinkPeers s_peers;
+
+#if CONFIG_LINK_ADR_ENABLE
+/**
+ * @brief Adaptive data rate state per sender.
+ */
+static AdrPeers s_adr;
+
+/**
+ * @brief Feed the SNR of the packet just received to ADR and queue new
+ * settings for its sender, sent with the ACK of this frame.
+ * @param device_id Sender of the packet.
+ * @param seq Sequence number of the packet.
+ */
+static void adr_observe(uint16_t device_id, uint8_t seq)
+{
+    // One spreading factor is heard, only the TX power can move
+    int sf = lora_get_spreading_factor();
+    const AdrParams params = {
+        .history = CONFIG_LINK_ADR_HISTORY,
+        .margin_db = CONFIG_LINK_ADR_MARGIN_DB,
+        .sf_min = sf,
+        .sf_max = sf,
+    };
+    float snr = lora_packet_snr();
+    DownlinkConfig cfg;
+    if (adr_update(&s_adr, device_id, seq, snr, sf, &params, &cfg)
+        && link_queue_downlink(device_id, &cfg) == 0)
+    {
+        BINLOG(BL_ADR_QUEUED, device_id, sf, cfg.tx_power, snr);
+    }
+}
+#endif
+
+/**
+ * @brief Wait for a packet, in continuous receive or by CAD.
+ * @param timeout_ms Timeout in milliseconds.
+ * @return 1 if a packet is received.
+ */
+static int wait_packet(int timeout_ms)
+{
+#if CAD_RECEIVE
+    return lora_sniff_wait(timeout_ms);
+#else
+    return lora_wait_received(timeout_ms);
+#endif
+}
+
+#if CONFIG_TDMA_ENABLE
+/**
+ * @brief Slot layout sent in every beacon (beacon.h).
+ */
+static const BeaconSchedule s_beacon = {
+    .period_s = CONFIG_TDMA_PERIOD_S,
+    .slot_ms = CONFIG_TDMA_SLOT_MS,
+    .slot_count = CONFIG_TDMA_SLOTS,
+};
+_Static_assert((CONFIG_TDMA_SLOTS + 1) * CONFIG_TDMA_SLOT_MS <= CONFIG_TDMA_PERIOD_S * 1000,
+               "TDMA_SLOTS + 1 slots of TDMA_SLOT_MS must fit in TDMA_PERIOD_S");
+
+/**
+ * @brief Send the beacon once its period starts.
+ *
+ * Periods follow each other from the first beacon, so a beacon sent late
+ * does not move the next ones.
+ *
+ * @return Time until the next beacon, ms.
+ */
+static int beacon_tick(void)
+{
+    static int64_t next_us;
+    static uint8_t seq;
+    int64_t now = esp_timer_get_time();
+    if (now >= next_us)
+    {
+        uint8_t mac[6];
+        esp_read_mac(mac, ESP_MAC_WIFI_STA);
+        link_send_beacon((mac[4] << 8) | mac[5], seq++, &s_beacon);
+        next_us += CONFIG_TDMA_PERIOD_S * 1000000LL;
+        if (next_us <= now)
+        {
+            next_us = now + CONFIG_TDMA_PERIOD_S * 1000000LL;   // First beacon, or a long stall
+        }
+#if !CAD_RECEIVE
+        lora_receive();
+#endif
+        now = esp_timer_get_time();
+    }
+    return (next_us - now + 999) / 1000;
+}
+#endif
+
+/**
+ * @brief Post the receiver's own diagnostics packet to the API.
+ */
+static void post_receiver_diag(void)
+{
+    for (int i = 0; i < LINK_MAX_PEERS; i++)
+    {
+        const LinkPeer *p = &s_peers.peers[i];
+        if (p->used)
+        {
+            ESP_LOGI("MAIN", "Device %04x: %lu received, %lu missed, %lu duplicates, delivery %.1f%%",
+                     p->device_id, (unsigned long)p->received, (unsigned long)p->missed,
+                     (unsigned long)p->duplicates, link_peer_ratio(p) * 100.0f);
+        }
+    }
+
+#if CAD_RECEIVE
+    // Radio current and share of the senders' frames caught between sleeps
+    const LoraSniffStats *sn = lora_sniff_stats();
+    uint32_t received = 0, missed = 0;
+    for (int i = 0; i < LINK_MAX_PEERS; i++)
+    {
+        received += s_peers.peers[i].received;
+        missed += s_peers.peers[i].missed;
+    }
+    BINLOG(BL_SNIFF_STATS, lora_sniff_current_ua(), sn->received, sn->false_wakes,
+           received + missed ? 100.0f * received / (received + missed) : 100.0f);
+    for (int ch = 0; ch < CONFIG_LORA_CHANNEL_COUNT; ch++)
+    {
+        ESP_LOGI("MAIN", "Channel %d: %lu packets", ch, (unsigned long)sn->channel_received[ch]);
+    }
+#endif
+
+    char diag_json[512];
+    diag_log();
+    if (diag_format_json(diag_json, sizeof(diag_json)) > 0)
+    {
+        send_diag_to_api(diag_json);
+    }
+}
+
+#if CONFIG_LINK_ACK_ENABLE && CONFIG_API_DOWNLINK_POLL_SEC > 0
+/**
+ * @brief Queue the configuration commands waiting in the API for their sender.
+ *
+ * The API answers [{"device_id":4660,"sleep_s":60,"sf":9}, ...] with only
+ * the settings to change. Runs while no packet is pending, the JSON parser
+ * allocates.
+ */
+static void poll_downlinks(void)
+{
+    static const struct
+    {
+        const char *name;
+        DownlinkCmd cmd;
+    } fields[] = {
+        { "sleep_s", DOWNLINK_SLEEP_S },
+        { "sample_count", DOWNLINK_SAMPLE_COUNT },
+        { "sample_period_ms", DOWNLINK_SAMPLE_PERIOD_MS },
+        { "sf", DOWNLINK_SF },
+        { "tx_power", DOWNLINK_TX_POWER },
+    };
+    char body[1024];
+    if (fetch_downlinks_from_api(body, sizeof(body)) <= 0)
+    {
+        return;
+    }
+    cJSON *list = cJSON_Parse(body);
+    const cJSON *item;
+    cJSON_ArrayForEach(item, list)
+    {
+        const cJSON *device = cJSON_GetObjectItem(item, "device_id");
+        if (!cJSON_IsNumber(device))
+        {
+            continue;
+        }
+        DownlinkConfig cfg = { 0 };
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+        {
+            const cJSON *v = cJSON_GetObjectItem(item, fields[i].name);
+            if (!cJSON_IsNumber(v) || v->valueint < 0 || v->valueint > UINT16_MAX)
+            {
+                continue;
+            }
+            cfg.set |= 1 << fields[i].cmd;
+            switch (fields[i].cmd)
+            {
+            case DOWNLINK_SLEEP_S:          cfg.sleep_s = v->valueint; break;
+            case DOWNLINK_SAMPLE_COUNT:     cfg.sample_count = v->valueint; break;
+            case DOWNLINK_SAMPLE_PERIOD_MS: cfg.sample_period_ms = v->valueint; break;
+            case DOWNLINK_SF:               cfg.sf = v->valueint; break;
+            case DOWNLINK_TX_POWER:         cfg.tx_power = v->valueint; break;
+            }
+        }
+        uint16_t device_id = device->valueint;
+        if (link_queue_downlink(device_id, &cfg) == 0)
+        {
+            BINLOG(BL_DOWNLINK_QUEUED, cfg.set, device_id);
+#if CONFIG_LINK_ADR_ENABLE
+            adr_note_downlink(&s_adr, device_id, &cfg);
+#endif
+        }
+        else
+        {
+            ESP_LOGW("MAIN", "Configuration for device %04x rejected", device_id);
+        }
+    }
+    cJSON_Delete(list);
+}
+#endif
+
+/**
+ * @brief Wrap a binary frame as {"frame":"<hex>","rssi":..,"snr":..,"age":..} for the API.
+ *
+ * The frame is decoded by API/index.js; this only validates the header, so
+ * no heap is used on the receive path.
+ *
+ * @param frame Received frame.
+ * @param len Frame length in bytes.
+ * @param rssi RSSI of the packet that carried it.
+ * @param snr SNR of the packet that carried it.
+ * @param age_s Age of its last sample when forwarded, 0 for a frame just received.
+ * @param json Output buffer, at least 2 * len + 64 bytes.
+ * @param json_len Size of @p json.
+ * @return Length of the JSON string, or 0 if it does not fit.
+ */
+static int format_frame_json(const uint8_t *frame, int len, int rssi, float snr, uint32_t age_s,
+                             char *json, size_t json_len)
+{
+    static const char hex[] = "0123456789abcdef";
+    int pos = snprintf(json, json_len, "{\"frame\":\"");
+    if ((size_t)(pos + 2 * len) >= json_len)
+    {
+        return 0;
+    }
+    for (int i = 0; i < len; i++)
+    {
+        json[pos++] = hex[frame[i] >> 4];
+        json[pos++] = hex[frame[i] & 0x0f];
+    }
+    pos += snprintf(json + pos, json_len - pos, "\",\"rssi\":%d,\"snr\":%.1f,\"age\":%lu}",
+                    rssi, snr, (unsigned long)age_s);
+    return (size_t)pos < json_len ? pos : 0;
+}
+
+/**
+ * @brief Partial messages, bounded pool shared by all senders.
+ */
+static FragReasm s_reasm;
+
+/**
+ * @brief Forward a received packet or reassembled message to the API.
+ * @param buf JSON packet, frame or fragment.
+ * @param len Length in bytes.
+ */
+static void forward_packet(const uint8_t *buf, int len)
+{
+    // Large enough for the hex of the longest reassembled message
+    static char json_data[2 * CONFIG_FRAME_REASM_MAX_LEN + 64];
+    FrameHeader hdr;
+    FrameFragment frag;
+
+    if (buf[0] == '{')
+    {
+        // JSON packet, forwarded as is
+        snprintf(json_data, sizeof(json_data), "%.*s", len, buf);
+        if (strncmp(json_data, "{\"diag\"", 7) == 0)
+        {
+            // Sender diagnostics packet
+            send_diag_to_api(json_data);
+        }
+        else
+        {
+            send_data_to_api(json_data);
+        }
+    }
+    else if (frag_parse(buf, len, &frag) == 0)
+    {
+        // Fragment: forward the message once all its fragments are in
+        BINLOG(BL_RX_FRAGMENT, frag.index, frag.count, frag.msg_id, frag.hdr.device_id);
+        const uint8_t *msg;
+        int msg_len = frag_reasm_push(&s_reasm, &frag, esp_timer_get_time() / 1000, &msg);
+        // Fragments are never nested, a message made of fragments is dropped
+        if (msg_len > 0 && frag_parse(msg, msg_len, &frag) != 0)
+        {
+            BINLOG(BL_REASM_DONE, msg_len, s_reasm.evicted, s_reasm.rejected);
+            forward_packet(msg, msg_len);
+        }
+    }
+    else if (frame_parse_header(buf, len, &hdr) == 0 && hdr.type != FRAME_TYPE_FRAG
+             && hdr.type != FRAME_TYPE_ACK && hdr.type != FRAME_TYPE_FEC && hdr.type != FRAME_TYPE_CONFIG
+             && hdr.type != FRAME_TYPE_BEACON && hdr.type != FRAME_TYPE_BULK)
+    {
+        // Binary frame, decoded by the API
+        BINLOG(BL_RX_FRAME, hdr.type, hdr.device_id, hdr.seq);
+        if (format_frame_json(buf, len, lora_packet_rssi(), lora_packet_snr(), 0,
+                              json_data, sizeof(json_data)) > 0)
+        {
+            send_data_to_api(json_data);
+        }
+    }
+    else
+    {
+        ESP_LOGW("MAIN", "Unknown packet format (first byte 0x%02x), dropped", buf[0]);
+    }
+}
+
+#if CONFIG_FEC_ENABLE
+/**
+ * @brief FEC state of the senders heard last.
+ */
+static FecDecoder s_fec[CONFIG_FEC_RX_SLOTS];
+
+/**
+ * @brief FEC state of a sender, taken from the sender heard least recently if needed.
+ */
+static FecDecoder *fec_decoder_of(uint16_t device_id)
+{
+    static uint32_t last_use[CONFIG_FEC_RX_SLOTS];
+    static uint32_t uses;
+    int slot = 0;
+    for (int i = 0; i < CONFIG_FEC_RX_SLOTS; i++)
+    {
+        if (s_fec[i].used && s_fec[i].device_id == device_id)
+        {
+            slot = i;
+            break;
+        }
+        if (last_use[i] < last_use[slot])
+        {
+            slot = i;
+        }
+    }
+    if (!s_fec[slot].used || s_fec[slot].device_id != device_id)
+    {
+        fec_decoder_init(&s_fec[slot], device_id);
+    }
+    last_use[slot] = ++uses;
+    return &s_fec[slot];
+}
+#endif
+
+#if CONFIG_LINK_BULK_ENABLE
+/**
+ * @brief A frame of a bulk transfer, forwarded once the radio is back in LoRa.
+ */
+typedef struct
+{
+    uint8_t frame[BULK_DATA_MAX];
+    uint8_t len;
+    int rssi;
+    uint32_t age_s;      ///< Age of its last sample when received
+    int64_t rx_us;       ///< Reception time
+} BulkFrame;
+
+static BulkFrame s_bulk[CONFIG_LINK_BULK_MAX_FRAMES];
+static int s_bulk_count;
+static int s_bulk_ended;   // END received
+
+/**
+ * @brief Handle a bulk transfer message received in FSK.
+ * @param buf Message.
+ * @param len Message length.
+ * @param hdr Parsed header of @p buf.
+ */
+static void bulk_receive(const uint8_t *buf, int len, const FrameHeader *hdr)
+{
+    FrameHeader h;
+    BulkMsg m;
+    if (bulk_decode(buf, len, &h, &m) != 0 || (m.op != BULK_DATA && m.op != BULK_END))
+    {
+        return;
+    }
+    link_send_ack(hdr);
+    if (!link_track(&s_peers, hdr->device_id, hdr->seq))
+    {
+        BINLOG(BL_RX_DUPLICATE, hdr->device_id, hdr->seq);
+        return;
+    }
+    if (m.op == BULK_END)
+    {
+        s_bulk_ended = 1;
+    }
+    else if (s_bulk_count < CONFIG_LINK_BULK_MAX_FRAMES)
+    {
+        BulkFrame *f = &s_bulk[s_bulk_count++];
+        memcpy(f->frame, m.frame, m.frame_len);
+        f->len = m.frame_len;
+        f->rssi = lora_packet_rssi();
+        f->age_s = m.age_s;
+        f->rx_us = esp_timer_get_time();
+    }
+}
+
+/**
+ * @brief Grant a bulk transfer, receive it in FSK, then forward its frames.
+ *
+ * The burst ends on the sender's END, or when no frame came for
+ * CONFIG_LINK_BULK_IDLE_MS. Other senders are not heard meanwhile.
+ *
+ * @param req Header of the request.
+ * @param frames Frames the sender asks to send.
+ */
+static void bulk_transfer(const FrameHeader *req, int frames)
+{
+    static char json_data[2 * BULK_DATA_MAX + 64];
+    uint8_t buf[FRAME_MAX_LEN];
+    int granted = frames < CONFIG_LINK_BULK_MAX_FRAMES ? frames : CONFIG_LINK_BULK_MAX_FRAMES;
+    int64_t start_us = esp_timer_get_time();
+
+    link_send_bulk_accept(req, granted);
+    link_track(&s_peers, req->device_id, req->seq);
+    BINLOG(BL_BULK_START, req->device_id, frames, granted);
+    s_bulk_count = 0;
+    s_bulk_ended = 0;
+
+    lora_set_modem(LORA_MODEM_FSK);
+    lora_receive();
+    while (!s_bulk_ended && lora_wait_received(CONFIG_LINK_BULK_IDLE_MS))
+    {
+        FrameHeader hdr;
+        int len = lora_receive_packet(buf, sizeof(buf));
+        if (len > 0 && frame_parse_header(buf, len, &hdr) == 0 && hdr.type == FRAME_TYPE_BULK
+            && hdr.device_id == req->device_id)
+        {
+            bulk_receive(buf, len, &hdr);
+        }
+        lora_receive();
+    }
+    lora_set_modem(LORA_MODEM_LORA);
+    BINLOG(BL_BULK_DONE, s_bulk_count, req->device_id,
+           (int)((esp_timer_get_time() - start_us) / 1000), s_bulk_ended);
+
+    // Wi-Fi posts are slow, they wait for the end of the burst
+    for (int i = 0; i < s_bulk_count; i++)
+    {
+        BulkFrame *f = &s_bulk[i];
+        uint32_t age_s = f->age_s + (esp_timer_get_time() - f->rx_us) / 1000000;
+        FrameHeader hdr;
+        frame_parse_header(f->frame, f->len, &hdr);
+        BINLOG(BL_RX_FRAME, hdr.type, hdr.device_id, hdr.seq);
+        if (format_frame_json(f->frame, f->len, f->rssi, 0.0f, age_s, json_data, sizeof(json_data)) > 0)
+        {
+            send_data_to_api(json_data);
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Handle a frame received over LoRa: ACK, duplicates, FEC, then forwarding.
+ * @param buf Frame.
+ * @param len Frame length.
+ * @param hdr Parsed header of @p buf.
+ */
+static void receive_frame(const uint8_t *buf, int len, const FrameHeader *hdr)
+{
+    if (hdr->type == FRAME_TYPE_ACK || hdr->type == FRAME_TYPE_CONFIG || hdr->type == FRAME_TYPE_BEACON)
+    {
+        return;   // Another receiver's acknowledgement or beacon
+    }
+    if (hdr->type == FRAME_TYPE_BULK)
+    {
+#if CONFIG_LINK_BULK_ENABLE
+        // A request over LoRa, the rest of the transfer is received in FSK
+        FrameHeader h;
+        BulkMsg m;
+        if (bulk_decode(buf, len, &h, &m) == 0 && m.op == BULK_REQUEST)
+        {
+            bulk_transfer(hdr, m.count);
+        }
+#elif CONFIG_LINK_ACK_ENABLE
+        // Plain ACK: nothing granted, the sender keeps its backlog
+        link_send_ack(hdr);
+#endif
+        return;
+    }
+    if (hdr->type == FRAME_TYPE_FEC)
+    {
+#if CONFIG_FEC_ENABLE
+        // Repair frame: rebuild the lost frames of its group
+        FecDecoder *d = fec_decoder_of(hdr->device_id);
+        FecRecovered rec[FEC_MAX_M];
+        int n = fec_decoder_add_repair(d, buf, len, rec, FEC_MAX_M);
+        for (int i = 0; i < n; i++)
+        {
+            BINLOG(BL_FEC_RECOVERED, hdr->device_id, rec[i].seq, d->recovered, d->unrecoverable);
+            if (link_track(&s_peers, hdr->device_id, rec[i].seq))
+            {
+                forward_packet(rec[i].frame, rec[i].len);
+            }
+        }
+#endif
+        return;
+    }
+
+#if CONFIG_LINK_ADR_ENABLE
+    adr_observe(hdr->device_id, hdr->seq);
+#endif
+#if CONFIG_LINK_ACK_ENABLE
+    // Acknowledge first, the sender only listens for a short window
+    link_send_ack(hdr);
+#endif
+    if (!link_track(&s_peers, hdr->device_id, hdr->seq))
+    {
+        // Retransmission after a lost ACK, already forwarded
+        BINLOG(BL_RX_DUPLICATE, hdr->device_id, hdr->seq);
+        return;
+    }
+#if CONFIG_FEC_ENABLE
+    fec_decoder_add_data(fec_decoder_of(hdr->device_id), hdr->seq, buf, len);
+#endif
+    forward_packet(buf, len);
+}
 
 /**
  * @brief Main application entry point.
@@ -40,6 +564,14 @@ void app_main(void)
     } LoRaState;
 
     LoRaState state = INIT;
+    int64_t last_diag_us = esp_timer_get_time();
+#if CONFIG_LINK_ACK_ENABLE && CONFIG_API_DOWNLINK_POLL_SEC > 0
+    int64_t last_downlink_poll_us = 0;
+#endif
+
+    // Deferred logging: records are formatted off the receive path
+    binlog_start_task(1);
+    frag_reasm_init(&s_reasm);
 
     // Initialize NVS before using WiFi or any component that needs NVS
     esp_err_t ret = nvs_flash_init();
@@ -52,6 +584,9 @@ void app_main(void)
 
     while (1)
     {
+        // Attribute heap allocations to the current state
+        diag_set_state(state);
+
         switch (state)
         {
         case INIT:
@@ -82,7 +617,28 @@ void app_main(void)
                 break;
             }
 
+            lora_config_begin();
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+            lora_set_channel(0);
+#else
             lora_set_frequency(868e6);
+#endif
+#if CONFIG_ADVANCED
+            // Senders default to the same spreading factor (CONFIG_NODE_SF)
+            lora_set_spreading_factor(CONFIG_SF_RATE);
+#endif
+#if CONFIG_LORA_IMPLICIT_HEADER
+            // Only measure frames are sent, every packet has their length
+            lora_implicit_header_mode(FRAME_MEASURE_LEN, CONFIG_LORA_IMPLICIT_CODING_RATE);
+#endif
+#if CONFIG_LORA_SNIFF_ENABLE
+            // Same preamble as the senders, the receiver sleeps between CADs
+            lora_sniff_config(CONFIG_LORA_SNIFF_PERIOD_MS);
+#elif CONFIG_LORA_CHANNEL_COUNT > 1
+            // Preamble that outlasts the receiver's scan of every channel
+            lora_sniff_config(0);
+#endif
+            lora_config_commit();
 
             state = ACQUISITION;
             break;
@@ -91,12 +647,36 @@ void app_main(void)
             ESP_LOGI("MAIN", "State: ACQUISITION - waiting for LoRa message");
 
             uint8_t buf[256];
+#if !CAD_RECEIVE
             lora_receive(); // Set LoRa module to receive mode
+#endif
 
-            // Wait until a LoRa packet is received
-            while (!lora_received())
+            // Wait until a LoRa packet is received, the task sleeps until RxDone
+            // (DIO0 interrupt) and wakes every 100 ms for housekeeping
+            int wait_ms = 100;
+            while (!wait_packet(wait_ms))
             {
-                vTaskDelay(pdMS_TO_TICKS(100));
+#if CONFIG_TDMA_ENABLE
+                // Woken up in time for the beacon rather than up to 100 ms late
+                int beacon_ms = beacon_tick();
+                wait_ms = beacon_ms < 100 ? beacon_ms : 100;
+#endif
+                // Drop messages whose missing fragments will not come
+                frag_reasm_expire(&s_reasm, esp_timer_get_time() / 1000);
+#if CONFIG_DIAG_PERIOD_SEC > 0
+                if (esp_timer_get_time() - last_diag_us >= CONFIG_DIAG_PERIOD_SEC * 1000000LL)
+                {
+                    post_receiver_diag();
+                    last_diag_us = esp_timer_get_time();
+                }
+#endif
+#if CONFIG_LINK_ACK_ENABLE && CONFIG_API_DOWNLINK_POLL_SEC > 0
+                if (esp_timer_get_time() - last_downlink_poll_us >= CONFIG_API_DOWNLINK_POLL_SEC * 1000000LL)
+                {
+                    poll_downlinks();
+                    last_downlink_poll_us = esp_timer_get_time();
+                }
+#endif
             }
 
             int rxLen = lora_receive_packet(buf, sizeof(buf));
@@ -112,11 +692,16 @@ void app_main(void)
             break;
 
         case WIFITRANSMISSION:
-            ESP_LOGI("MAIN", "Packet received (%d bytes): [%.*s]", rxLen, rxLen, buf);
-            // Send received data to API
-            char json_data[300];
-            snprintf(json_data, sizeof(json_data), "%.*s", rxLen, buf);
-            send_data_to_api(json_data);
+            BINLOG(BL_RX_PACKET, rxLen, lora_packet_rssi(), lora_packet_snr());
+            FrameHeader rx_hdr;
+            if (buf[0] != '{' && frame_parse_header(buf, rxLen, &rx_hdr) == 0)
+            {
+                receive_frame(buf, rxLen, &rx_hdr);
+            }
+            else
+            {
+                forward_packet(buf, rxLen);
+            }
             state = ACQUISITION;
             break;
 
@@ -0,0 +1,40 @@
+#ifndef BINLOG_FMT_H
+#define BINLOG_FMT_H
+
+/**
+ * @file binlog_fmt.h
+ * @brief Format table of the deferred binary logger (sender).
+ *
+ * One X(id, "format") entry per line; the entry index is the record's
+ * format ID. tools/binlog_decode.py parses this file, so only append new
+ * entries at the end and keep each on a single line.
+ */
+#define BINLOG_FORMATS(X) \
+    X(BL_AVERAGES, "Average temperature: %.2f°C | Average pressure: %.2f hPa | Average humidity: %.2f%% | Average SPL: %.2f dB SPL") \
+    X(BL_SAMPLING_LATENCY, "channel %d latency mean/max/p99 %d/%d/%d us") \
+    X(BL_SAMPLING_JITTER, "channel %d jitter mean/max/p99 %d/%d/%d us") \
+    X(BL_MESSAGE_SENT, "Message sent (%d bytes)") \
+    X(BL_LINK_STATS, "Delivery %u/%u acknowledged in %u transmissions (%.1f%%)") \
+    X(BL_MESSAGE_FRAGMENTED, "Message %u sent in %d fragments (%d bytes)") \
+    X(BL_LORA_TX_IRQ, "lora_read_reg=0x%x") \
+    X(BL_SENSOR_SKIPPED, "channel %d backing off, %d cycles left") \
+    X(BL_SENSOR_FAILED, "channel %d failed (%d in a row), retry in %d cycles") \
+    X(BL_CONFIG_APPLIED, "Config: sleep %u s, %u samples every %u ms") \
+    X(BL_CONFIG_RADIO, "Config: SF%u, %u dBm") \
+    X(BL_CONFIG_REJECTED, "Config commands 0x%x rejected") \
+    X(BL_RADIO_FALLBACK, "No ACK after a radio change, back to SF%u, %u dBm") \
+    X(BL_LORA_DUTY_REFUSED, "Duty cycle: %d-byte packet refused, airtime in %d ms") \
+    X(BL_AIRTIME_LEFT, "Airtime left %d ms, %d packets refused") \
+    X(BL_LORA_TX_DONE, "Async TX status %d: %d us to TxDone, %u us computed") \
+    X(BL_LORA_LBT_BUSY, "LBT: channel busy (CAD %d), backoff %d ms") \
+    X(BL_LBT_STATS, "LBT: %u CADs, %u busy, %u sent on a busy channel, %u ms deferred") \
+    X(BL_TDMA_SYNC, "TDMA: beacon %d us from prediction, drift %d ppm, window +/-%d ms") \
+    X(BL_TDMA_MISSED, "TDMA: beacon missed (%u in a row), slot from prediction") \
+    X(BL_TDMA_LOST, "TDMA: %u beacons missed, sending at once") \
+    X(BL_TDMA_SEARCH, "TDMA: no beacon heard, next search in %u cycles") \
+    X(BL_TDMA_LATE, "TDMA: slot in %d ms too close to the awake ceiling, sending at once") \
+    X(BL_BULK_BACKLOG, "Backlog: %d samples kept, %d oldest dropped") \
+    X(BL_BULK_REFUSED, "Bulk: %d frames not granted") \
+    X(BL_BULK_DONE, "Bulk: %d/%d frames, %d samples sent in FSK, %d samples left") \
+
+#endif // BINLOG_FMT_H
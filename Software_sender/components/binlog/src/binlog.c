@@ -0,0 +1,225 @@
+/**
+ * @file binlog.c
+ * @brief Lock-free ring and deferred formatter of the binary logger.
+ *
+ * The ring is a bounded multi-producer / single-consumer queue: each slot
+ * carries a sequence number, producers reserve a slot with a compare-and-swap
+ * on the head index and publish it by advancing the slot sequence. Producers
+ * never wait, so BINLOG() can be used from any task or ISR.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "binlog.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#define BINLOG_MASK (CONFIG_BINLOG_RING_SIZE - 1)
+
+_Static_assert((CONFIG_BINLOG_RING_SIZE & BINLOG_MASK) == 0, "BINLOG_RING_SIZE must be a power of two");
+
+typedef struct {
+    uint32_t seq;                      ///< Slot sequence, publishes the record
+    uint32_t ts_us;                    ///< esp_timer time (µs, low 32 bits)
+    uint16_t id;                       ///< BinlogId
+    uint8_t nargs;                     ///< Number of valid arguments
+    uint32_t args[BINLOG_MAX_ARGS];    ///< Raw arguments
+} BinlogRecord;
+
+static BinlogRecord s_ring[CONFIG_BINLOG_RING_SIZE];
+static uint32_t s_head;       ///< Next slot to reserve (producers)
+static uint32_t s_tail;       ///< Next slot to read (consumer)
+static uint32_t s_dropped;
+static uint32_t s_flushing;   ///< Serializes consumers (flush task / on demand)
+static volatile int s_ready;
+
+static const char *s_formats[BINLOG_ID_COUNT] = {
+#define BINLOG_FMT_STR(id, fmt) fmt,
+    BINLOG_FORMATS(BINLOG_FMT_STR)
+#undef BINLOG_FMT_STR
+};
+
+/**
+ * @brief Initialize slot sequence numbers, done once on first use.
+ */
+static void binlog_init(void)
+{
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    portENTER_CRITICAL_SAFE(&lock);
+    if (!s_ready) {
+        for (uint32_t i = 0; i < CONFIG_BINLOG_RING_SIZE; i++) {
+            s_ring[i].seq = i;
+        }
+        s_ready = 1;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+void IRAM_ATTR binlog_write(BinlogId id, int nargs, const uint32_t *args)
+{
+    if (!s_ready) {
+        binlog_init();
+    }
+    if (nargs > BINLOG_MAX_ARGS) {
+        nargs = BINLOG_MAX_ARGS;
+    }
+
+    uint32_t pos = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+    BinlogRecord *r;
+    while (1) {
+        r = &s_ring[pos & BINLOG_MASK];
+        int32_t dif = (int32_t)(__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&s_head, &pos, pos + 1, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            // Ring full: the consumer has not released this slot yet
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    r->ts_us = (uint32_t)esp_timer_get_time();
+    r->id = (uint16_t)id;
+    r->nargs = (uint8_t)nargs;
+    for (int i = 0; i < nargs; i++) {
+        r->args[i] = args[i];
+    }
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+#if CONFIG_BINLOG_OUTPUT_TEXT
+/**
+ * @brief Print a record's format string, one conversion at a time.
+ *
+ * Each segment holds at most one conversion, so it can be passed to printf
+ * with a single argument of the type the conversion expects.
+ */
+static void binlog_print_text(const BinlogRecord *r)
+{
+    const char *fmt = r->id < BINLOG_ID_COUNT ? s_formats[r->id] : "unknown binlog id";
+    char segment[96];
+    int arg = 0;
+
+    printf("B (%u) ", (unsigned)(r->ts_us / 1000));
+    while (*fmt) {
+        // Copy up to and including the next conversion
+        const char *p = fmt;
+        const char *conv = NULL;
+        while (*p && !conv) {
+            if (*p == '%' && p[1] == '%') {
+                p += 2;
+                continue;
+            }
+            if (*p == '%') {
+                conv = p + 1;
+                while (*conv && !strchr("diuxXcfeEgG", *conv)) {
+                    conv++;
+                }
+                p = *conv ? conv + 1 : conv;
+                break;
+            }
+            p++;
+        }
+        size_t n = p - fmt;
+        if (n >= sizeof(segment)) {
+            n = sizeof(segment) - 1;
+        }
+        memcpy(segment, fmt, n);
+        segment[n] = '\0';
+        fmt = p;
+
+        if (!conv || !*conv) {
+            printf(segment, 0);
+        } else if (strchr("feEgG", *conv)) {
+            float f = 0;
+            if (arg < r->nargs) {
+                memcpy(&f, &r->args[arg], sizeof(f));
+            }
+            printf(segment, (double)f);
+            arg++;
+        } else {
+            printf(segment, arg < r->nargs ? r->args[arg] : 0);
+            arg++;
+        }
+    }
+    printf("\n");
+}
+#else
+/**
+ * @brief Print a raw record for tools/binlog_decode.py.
+ */
+static void binlog_print_raw(const BinlogRecord *r)
+{
+    printf("BL %u %u", (unsigned)r->ts_us, (unsigned)r->id);
+    for (int i = 0; i < r->nargs; i++) {
+        printf(" %08x", (unsigned)r->args[i]);
+    }
+    printf("\n");
+}
+#endif
+
+void binlog_flush(void)
+{
+    static uint32_t reported_drops;
+
+    if (!s_ready) {
+        return;
+    }
+    // Only one consumer at a time, wait for a running flush to finish
+    uint32_t idle = 0;
+    while (!__atomic_compare_exchange_n(&s_flushing, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        idle = 0;
+        vTaskDelay(1);
+    }
+
+    while (1) {
+        BinlogRecord *r = &s_ring[s_tail & BINLOG_MASK];
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != s_tail + 1) {
+            break;
+        }
+#if CONFIG_BINLOG_OUTPUT_TEXT
+        binlog_print_text(r);
+#else
+        binlog_print_raw(r);
+#endif
+        __atomic_store_n(&r->seq, s_tail + CONFIG_BINLOG_RING_SIZE, __ATOMIC_RELEASE);
+        s_tail++;
+    }
+
+    uint32_t dropped = binlog_dropped();
+    if (dropped != reported_drops) {
+        printf("B binlog: %u records dropped\n", (unsigned)(dropped - reported_drops));
+        reported_drops = dropped;
+    }
+    __atomic_store_n(&s_flushing, 0, __ATOMIC_RELEASE);
+}
+
+uint32_t binlog_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Low-priority flush task.
+ */
+static void binlog_task(void *pvParameters)
+{
+    while (1) {
+        binlog_flush();
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+void binlog_start_task(int priority)
+{
+    binlog_init();
+    xTaskCreate(binlog_task, "BinlogTask", 3072, NULL, priority, NULL);
+}
@@ -3,13 +3,36 @@
 
    #include "freertos/FreeRTOS.h"
    #include "freertos/semphr.h"
+   #include <math.h>
+   #include "sampling.h"
 
    typedef struct {
        float *buffer;
+       int64_t *timestamps;        // esp_timer time of each sample (us)
        int sample_count;
-       float average;
+       float average;              // Mean of the valid samples
+       int valid_count;            // Samples read successfully (finite values)
+       const SamplingClock *clock; // Shared schedule driving this channel
+       SamplingStats stats;        // Latency/jitter of the last window
        SemaphoreHandle_t done_semaphore;
        SemaphoreHandle_t start_signal;
    } CapteurContext;
 
+   /**
+    * @brief Average the finite samples of the window, failed reads are NAN.
+    * @param ctx Channel whose buffer is complete.
+    */
+   static inline void capteur_average(CapteurContext *ctx)
+   {
+       float sum = 0;
+       ctx->valid_count = 0;
+       for (int i = 0; i < ctx->sample_count; i++) {
+           if (isfinite(ctx->buffer[i])) {
+               sum += ctx->buffer[i];
+               ctx->valid_count++;
+           }
+       }
+       ctx->average = ctx->valid_count ? sum / ctx->valid_count : NAN;
+   }
+
    #endif
\ No newline at end of file
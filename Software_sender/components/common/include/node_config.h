@@ -0,0 +1,87 @@
+#ifndef NODE_CONFIG_H
+#define NODE_CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "downlink.h"
+
+/**
+ * @file node_config.h
+ * @brief Sender settings changed remotely by downlink commands, kept in NVS.
+ *
+ * The values start from the Kconfig defaults (menu "Node Configuration").
+ * Commands received with an ACK (downlink.h) change them and the result is
+ * written to NVS, so it survives power loss. The caller keeps its copy in
+ * RTC memory and reads NVS only on power-on.
+ *
+ * A change of spreading factor or TX power can cut the node off from the
+ * receiver. The previous radio settings are then kept as a fallback, until
+ * a frame is acknowledged with the new ones. After too many cycles without
+ * any ACK, the node goes back to the fallback. Confirmed settings that stop
+ * getting ACKs later (the receiver's adaptive data rate lowered the power
+ * too far, see adr.h) are raised the same way, 3 dB at a time up to the
+ * highest TX power, then back to the default spreading factor.
+ */
+
+/**
+ * @brief Current settings of the node.
+ */
+typedef struct {
+    uint16_t sleep_s;            ///< Deep sleep between cycles
+    uint8_t sample_count;        ///< Samples per cycle (1 to DOWNLINK_SAMPLES_MAX)
+    uint16_t sample_period_ms;   ///< Time between samples
+    uint8_t sf;                  ///< Spreading factor
+    uint8_t tx_power;            ///< TX power, dBm
+    uint8_t fallback_sf;         ///< Radio settings to go back to, 0 when confirmed
+    uint8_t fallback_tx_power;
+    uint8_t unacked;             ///< Cycles without ACK in a row (not saved)
+} NodeConfig;
+
+/**
+ * @brief Kconfig defaults.
+ * @param c Output settings.
+ */
+void node_config_defaults(NodeConfig *c);
+
+/**
+ * @brief Apply received commands.
+ *
+ * The commands are merged with the current settings and the result is
+ * checked as a whole; nothing changes if it is rejected.
+ *
+ * @param c Settings, updated.
+ * @param dl Commands.
+ * @param max_window_ms Longest sampling window ((count - 1) * period) accepted.
+ * @return 1 if the settings changed, 0 if they were already set, -1 if rejected.
+ */
+int node_config_apply(NodeConfig *c, const DownlinkConfig *dl, uint32_t max_window_ms);
+
+/**
+ * @brief Account for the outcome of a cycle that sent frames.
+ * @param c Settings, updated.
+ * @param acked true if at least one frame was acknowledged.
+ * @param max_unacked Cycles without ACK before going back to the fallback.
+ * @return 1 if the settings changed (radio change confirmed or undone, or
+ *         a more robust setting after @p max_unacked cycles), 0 otherwise.
+ */
+int node_config_link_result(NodeConfig *c, bool acked, uint8_t max_unacked);
+
+/**
+ * @brief Read the settings from NVS, the defaults when none were saved.
+ *
+ * Initializes the NVS partition if needed.
+ *
+ * @param c Output settings.
+ * @return ESP_OK, or the NVS error (@p c then holds the defaults).
+ */
+esp_err_t node_config_load(NodeConfig *c);
+
+/**
+ * @brief Write the settings to NVS.
+ * @param c Settings.
+ * @return ESP_OK, or the NVS error.
+ */
+esp_err_t node_config_save(const NodeConfig *c);
+
+#endif // NODE_CONFIG_H
@@ -0,0 +1,90 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+
+/**
+ * @file sampling.h
+ * @brief Shared esp_timer sampling clock and per-channel jitter statistics.
+ *
+ * A single periodic esp_timer notifies every registered sensor task at the
+ * same instant, so all channels sample on one aligned schedule and the read
+ * time no longer adds to the period.
+ */
+
+#define SAMPLING_MAX_CHANNELS 4   ///< Maximum number of tasks driven by one clock
+#define SAMPLING_MAX_SAMPLES  64  ///< Maximum samples used for statistics
+
+/**
+ * @brief Periodic schedule shared by all sensor channels.
+ */
+typedef struct {
+    esp_timer_handle_t timer;                     ///< Underlying periodic esp_timer
+    int64_t origin_us;                            ///< esp_timer time of slot 0
+    int64_t period_us;                            ///< Sampling period
+    int remaining;                                ///< Slots left to notify
+    TaskHandle_t tasks[SAMPLING_MAX_CHANNELS];    ///< Notified sensor tasks
+    int task_count;                               ///< Number of registered tasks
+} SamplingClock;
+
+/**
+ * @brief Mean, maximum and 99th percentile of a timing series (µs).
+ */
+typedef struct {
+    int64_t mean_us;
+    int64_t max_us;
+    int64_t p99_us;
+} SamplingTiming;
+
+/**
+ * @brief Scheduling quality of one channel for one acquisition window.
+ */
+typedef struct {
+    SamplingTiming latency;   ///< Sample timestamp minus scheduled slot time
+    SamplingTiming jitter;    ///< |interval between samples - period|
+} SamplingStats;
+
+/**
+ * @brief Create the sampling clock and register the tasks it drives.
+ * @param clock Clock to initialize.
+ * @param period_ms Sampling period in milliseconds.
+ * @param tasks Sensor task handles to notify on every slot.
+ * @param task_count Number of entries in @p tasks (max SAMPLING_MAX_CHANNELS).
+ * @return ESP_OK on success, error code otherwise.
+ */
+esp_err_t sampling_clock_init(SamplingClock *clock, uint32_t period_ms,
+                              const TaskHandle_t *tasks, int task_count);
+
+/**
+ * @brief Start a window of @p sample_count slots, slot 0 fires immediately.
+ * @param clock Initialized clock.
+ * @param sample_count Number of slots in the window.
+ * @return ESP_OK on success, error code otherwise.
+ */
+esp_err_t sampling_clock_start(SamplingClock *clock, int sample_count);
+
+/**
+ * @brief Block the calling sensor task until its next slot.
+ *
+ * Slots a read overran are returned at once, late, so a task always takes
+ * every slot of the window.
+ *
+ * @return esp_timer timestamp (µs) taken on wake-up, to store with the sample.
+ */
+int64_t sampling_wait_slot(void);
+
+/**
+ * @brief Compute latency and jitter statistics for one channel.
+ * @param clock Clock that drove the acquisition.
+ * @param timestamps Sample timestamps returned by sampling_wait_slot().
+ * @param count Number of samples.
+ * @param stats Output statistics.
+ */
+void sampling_compute_stats(const SamplingClock *clock, const int64_t *timestamps,
+                            int count, SamplingStats *stats);
+
+#endif // SAMPLING_H
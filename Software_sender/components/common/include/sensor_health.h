@@ -0,0 +1,42 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file sensor_health.h
+ * @brief Per-sensor failure tracking with exponential backoff across wake cycles.
+ *
+ * A sensor that misses its deadline or returns no valid sample is skipped for
+ * 1, 2, 4, ... cycles (capped) before it is tried again. Instances are kept
+ * in RTC memory by the caller so the backoff survives deep sleep.
+ */
+
+/**
+ * @brief Health of one sensor channel.
+ */
+typedef struct {
+    uint8_t failures;   ///< Consecutive failed attempts
+    uint16_t skip;      ///< Cycles left before the next attempt
+} SensorHealth;
+
+/**
+ * @brief Decide whether the sensor is sampled this cycle.
+ *
+ * Consumes one backoff cycle when the sensor is skipped.
+ *
+ * @param health Sensor state.
+ * @return true if the sensor should be sampled.
+ */
+bool sensor_health_should_sample(SensorHealth *health);
+
+/**
+ * @brief Record the outcome of an attempt.
+ * @param health Sensor state.
+ * @param ok true if the sensor delivered valid samples before its deadline.
+ * @param max_backoff Maximum number of cycles skipped after a failure.
+ */
+void sensor_health_report(SensorHealth *health, bool ok, uint16_t max_backoff);
+
+#endif // SENSOR_HEALTH_H
@@ -0,0 +1,30 @@
+#ifndef TASK_PLAN_H
+#define TASK_PLAN_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+/**
+ * @file task_plan.h
+ * @brief Core affinity and priorities of the sender pipeline.
+ *
+ * Acquisition (sensor tasks, I2S consumer) runs on one core, SPL processing
+ * and the radio on the other, so bus reads are not delayed by DSP or SPI
+ * traffic. Configured in make config → Task Placement.
+ */
+
+#if CONFIG_PIPELINE_PIN_TASKS && !CONFIG_FREERTOS_UNICORE
+#define PIPELINE_ACQ_CORE   CONFIG_PIPELINE_ACQ_CORE          ///< Sensor tasks, I2S consumer
+#define PIPELINE_PROC_CORE  (1 - CONFIG_PIPELINE_ACQ_CORE)    ///< SPL processing, main task (radio)
+#else
+#define PIPELINE_ACQ_CORE   tskNO_AFFINITY
+#define PIPELINE_PROC_CORE  tskNO_AFFINITY
+#endif
+
+#define PIPELINE_ACQ_PRIORITY    CONFIG_PIPELINE_ACQ_PRIORITY
+#define PIPELINE_I2S_PRIORITY    CONFIG_PIPELINE_I2S_PRIORITY
+#define PIPELINE_DSP_PRIORITY    CONFIG_PIPELINE_DSP_PRIORITY
+#define PIPELINE_RADIO_PRIORITY  CONFIG_PIPELINE_RADIO_PRIORITY
+
+#endif // TASK_PLAN_H
@@ -0,0 +1,95 @@
+/**
+ * @file node_config.c
+ * @brief Remote settings: merge, checks and radio fallback.
+ */
+
+#include "node_config.h"
+#include "sdkconfig.h"
+
+void node_config_defaults(NodeConfig *c)
+{
+    *c = (NodeConfig){
+        .sleep_s = CONFIG_NODE_SLEEP_S,
+        .sample_count = CONFIG_NODE_SAMPLE_COUNT,
+        .sample_period_ms = CONFIG_NODE_SAMPLE_PERIOD_MS,
+        .sf = CONFIG_NODE_SF,
+        .tx_power = CONFIG_NODE_TX_POWER,
+    };
+}
+
+int node_config_apply(NodeConfig *c, const DownlinkConfig *dl, uint32_t max_window_ms)
+{
+    if (downlink_validate(dl) != 0) {
+        return -1;
+    }
+    NodeConfig n = *c;
+    if (dl->set & (1 << DOWNLINK_SLEEP_S)) {
+        n.sleep_s = dl->sleep_s;
+    }
+    if (dl->set & (1 << DOWNLINK_SAMPLE_COUNT)) {
+        n.sample_count = dl->sample_count;
+    }
+    if (dl->set & (1 << DOWNLINK_SAMPLE_PERIOD_MS)) {
+        n.sample_period_ms = dl->sample_period_ms;
+    }
+    if (dl->set & (1 << DOWNLINK_SF)) {
+        n.sf = dl->sf;
+    }
+    if (dl->set & (1 << DOWNLINK_TX_POWER)) {
+        n.tx_power = dl->tx_power;
+    }
+    if ((uint32_t)(n.sample_count - 1) * n.sample_period_ms > max_window_ms) {
+        return -1;
+    }
+
+    bool radio = n.sf != c->sf || n.tx_power != c->tx_power;
+    if (!radio && n.sleep_s == c->sleep_s && n.sample_count == c->sample_count
+        && n.sample_period_ms == c->sample_period_ms) {
+        return 0;
+    }
+    if (radio) {
+        // Keep the last settings known to reach the receiver
+        if (!n.fallback_sf) {
+            n.fallback_sf = c->sf;
+            n.fallback_tx_power = c->tx_power;
+        }
+        n.unacked = 0;
+    }
+    *c = n;
+    return 1;
+}
+
+int node_config_link_result(NodeConfig *c, bool acked, uint8_t max_unacked)
+{
+    if (acked) {
+        c->unacked = 0;
+        if (!c->fallback_sf) {
+            return 0;
+        }
+        c->fallback_sf = 0;
+        c->fallback_tx_power = 0;
+        return 1;
+    }
+    if (++c->unacked < max_unacked) {
+        return 0;
+    }
+    c->unacked = 0;
+    if (c->fallback_sf) {
+        c->sf = c->fallback_sf;
+        c->tx_power = c->fallback_tx_power;
+        c->fallback_sf = 0;
+        c->fallback_tx_power = 0;
+        return 1;
+    }
+    // Confirmed settings that stopped working (ADR went too far, the link got
+    // worse): step back towards the defaults, power first
+    if (c->tx_power < DOWNLINK_TX_POWER_MAX) {
+        c->tx_power = c->tx_power + 3 > DOWNLINK_TX_POWER_MAX ? DOWNLINK_TX_POWER_MAX : c->tx_power + 3;
+        return 1;
+    }
+    if (c->sf != CONFIG_NODE_SF) {
+        c->sf = CONFIG_NODE_SF;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file node_config_nvs.c
+ * @brief Remote settings storage in NVS.
+ */
+
+#include "node_config.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+#define TAG "NODE_CFG"
+#define NODE_CONFIG_NAMESPACE "node"
+#define NODE_CONFIG_KEY       "config"
+#define NODE_CONFIG_VERSION   1   ///< Stored with the blob, bump when NodeConfig changes
+
+/**
+ * @brief Saved layout: NodeConfig behind a version byte.
+ */
+typedef struct {
+    uint8_t version;
+    NodeConfig cfg;
+} NodeConfigBlob;
+
+static esp_err_t node_config_nvs_init(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    return err;
+}
+
+esp_err_t node_config_load(NodeConfig *c)
+{
+    node_config_defaults(c);
+    esp_err_t err = node_config_nvs_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_handle_t h;
+    err = nvs_open(NODE_CONFIG_NAMESPACE, NVS_READONLY, &h);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;   // Nothing saved yet
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    NodeConfigBlob blob;
+    size_t len = sizeof(blob);
+    err = nvs_get_blob(h, NODE_CONFIG_KEY, &blob, &len);
+    nvs_close(h);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    // The sample count sizes stack buffers, never trust it unchecked
+    if (len != sizeof(blob) || blob.version != NODE_CONFIG_VERSION
+        || blob.cfg.sample_count < 1 || blob.cfg.sample_count > DOWNLINK_SAMPLES_MAX) {
+        ESP_LOGW(TAG, "Saved settings invalid or of another version, using the defaults");
+        return ESP_OK;
+    }
+    *c = blob.cfg;
+    c->unacked = 0;
+    return ESP_OK;
+}
+
+esp_err_t node_config_save(const NodeConfig *c)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NODE_CONFIG_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        return err;
+    }
+    NodeConfigBlob blob = { .version = NODE_CONFIG_VERSION, .cfg = *c };
+    blob.cfg.unacked = 0;
+    err = nvs_set_blob(h, NODE_CONFIG_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_commit(h);
+    }
+    nvs_close(h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Saving settings failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
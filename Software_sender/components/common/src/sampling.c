@@ -0,0 +1,137 @@
+/**
+ * @file sampling.c
+ * @brief Shared esp_timer sampling clock and jitter statistics.
+ *
+ * The clock notifies every registered task from the esp_timer task, so the
+ * sampling period is set by the timer and not by vTaskDelay() plus read time.
+ */
+
+#include <string.h>
+#include "sampling.h"
+#include "esp_log.h"
+
+static const char *TAG = "sampling";
+
+/**
+ * @brief Notify every registered task for one slot.
+ * @param clock Clock being driven.
+ */
+static void sampling_notify_all(SamplingClock *clock)
+{
+    for (int i = 0; i < clock->task_count; i++) {
+        xTaskNotifyGive(clock->tasks[i]);
+    }
+    if (--clock->remaining <= 0) {
+        esp_timer_stop(clock->timer);
+    }
+}
+
+/**
+ * @brief esp_timer callback, fires once per sampling period.
+ * @param arg Pointer to the SamplingClock.
+ */
+static void sampling_timer_cb(void *arg)
+{
+    sampling_notify_all((SamplingClock *)arg);
+}
+
+esp_err_t sampling_clock_init(SamplingClock *clock, uint32_t period_ms,
+                              const TaskHandle_t *tasks, int task_count)
+{
+    if (task_count > SAMPLING_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(clock, 0, sizeof(*clock));
+    clock->period_us = (int64_t)period_ms * 1000;
+    clock->task_count = task_count;
+    memcpy(clock->tasks, tasks, task_count * sizeof(TaskHandle_t));
+
+    const esp_timer_create_args_t args = {
+        .callback = sampling_timer_cb,
+        .arg = clock,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "sampling",
+    };
+    esp_err_t ret = esp_timer_create(&args, &clock->timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Sampling timer creation failed");
+    }
+    return ret;
+}
+
+esp_err_t sampling_clock_start(SamplingClock *clock, int sample_count)
+{
+    if (sample_count <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    clock->remaining = sample_count;
+    clock->origin_us = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+    if (sample_count > 1) {
+        ret = esp_timer_start_periodic(clock->timer, clock->period_us);
+    }
+    // Slot 0 is due now, the periodic timer covers the following ones
+    sampling_notify_all(clock);
+    return ret;
+}
+
+int64_t sampling_wait_slot(void)
+{
+    // One slot per notification: after a read overran a period, the missed
+    // slots are taken at once instead of being merged into one
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Fill a SamplingTiming from an unsorted series of values.
+ * @param values Series to summarize, sorted in place.
+ * @param count Number of values.
+ * @param out Output timing summary.
+ */
+static void sampling_summarize(int64_t *values, int count, SamplingTiming *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (count <= 0) {
+        return;
+    }
+    // Insertion sort, series are at most SAMPLING_MAX_SAMPLES long
+    for (int i = 1; i < count; i++) {
+        int64_t v = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    out->mean_us = sum / count;
+    out->max_us = values[count - 1];
+    // Nearest-rank percentile
+    int rank = (99 * count + 99) / 100;
+    out->p99_us = values[rank - 1];
+}
+
+void sampling_compute_stats(const SamplingClock *clock, const int64_t *timestamps,
+                            int count, SamplingStats *stats)
+{
+    int64_t series[SAMPLING_MAX_SAMPLES];
+    if (count > SAMPLING_MAX_SAMPLES) {
+        count = SAMPLING_MAX_SAMPLES;
+    }
+
+    for (int i = 0; i < count; i++) {
+        series[i] = timestamps[i] - (clock->origin_us + i * clock->period_us);
+    }
+    sampling_summarize(series, count, &stats->latency);
+
+    for (int i = 1; i < count; i++) {
+        int64_t error = (timestamps[i] - timestamps[i - 1]) - clock->period_us;
+        series[i - 1] = error < 0 ? -error : error;
+    }
+    sampling_summarize(series, count - 1, &stats->jitter);
+}
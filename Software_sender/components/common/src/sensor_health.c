@@ -0,0 +1,29 @@
+/**
+ * @file sensor_health.c
+ * @brief Per-sensor failure tracking with exponential backoff.
+ */
+
+#include "sensor_health.h"
+
+bool sensor_health_should_sample(SensorHealth *health)
+{
+    if (health->skip > 0) {
+        health->skip--;
+        return false;
+    }
+    return true;
+}
+
+void sensor_health_report(SensorHealth *health, bool ok, uint16_t max_backoff)
+{
+    if (ok) {
+        health->failures = 0;
+        health->skip = 0;
+        return;
+    }
+    if (health->failures < 15) {
+        health->failures++;
+    }
+    uint32_t backoff = 1u << (health->failures - 1);
+    health->skip = backoff > max_backoff ? max_backoff : (uint16_t)backoff;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file diag.c
+ * @brief Stack, heap and allocation instrumentation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "diag.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#define DIAG_MAX_TASKS 24   ///< Tasks reported in one snapshot
+
+static const char *TAG = "diag";
+
+static volatile int s_state;
+static uint32_t s_allocs[DIAG_MAX_STATES];
+static uint32_t s_frees[DIAG_MAX_STATES];
+static int s_state_count = 1;
+
+#if CONFIG_HEAP_USE_HOOKS
+/**
+ * @brief Heap allocation hook, called by the heap component on every malloc.
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if (ptr != NULL) {
+        __atomic_fetch_add(&s_allocs[s_state], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Heap free hook, called by the heap component on every free.
+ */
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+    if (ptr != NULL) {
+        __atomic_fetch_add(&s_frees[s_state], 1, __ATOMIC_RELAXED);
+    }
+}
+#endif
+
+void diag_set_state(int state)
+{
+    if (state < 0 || state >= DIAG_MAX_STATES) {
+        return;
+    }
+    s_state = state;
+    if (state >= s_state_count) {
+        s_state_count = state + 1;
+    }
+}
+
+uint32_t diag_alloc_count(int state)
+{
+    if (state < 0 || state >= DIAG_MAX_STATES) {
+        return 0;
+    }
+    return __atomic_load_n(&s_allocs[state], __ATOMIC_RELAXED);
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+static TaskStatus_t s_tasks[DIAG_MAX_TASKS];
+#endif
+
+/**
+ * @brief Snapshot the task list (or the calling task only without trace facility).
+ * @param names Output task names.
+ * @param hwm Output stack high-water marks in bytes.
+ * @return Number of tasks written.
+ */
+static int diag_collect_tasks(const char **names, uint32_t *hwm)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t n = uxTaskGetSystemState(s_tasks, DIAG_MAX_TASKS, NULL);
+    for (UBaseType_t i = 0; i < n; i++) {
+        names[i] = s_tasks[i].pcTaskName;
+        hwm[i] = s_tasks[i].usStackHighWaterMark;
+    }
+    return (int)n;
+#else
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    names[0] = pcTaskGetName(self);
+    hwm[0] = uxTaskGetStackHighWaterMark(self);
+    return 1;
+#endif
+}
+
+void diag_log(void)
+{
+    const char *names[DIAG_MAX_TASKS];
+    uint32_t hwm[DIAG_MAX_TASKS];
+    int n = diag_collect_tasks(names, hwm);
+
+    ESP_LOGI(TAG, "heap free %u B, min free %u B",
+             (unsigned)esp_get_free_heap_size(), (unsigned)esp_get_minimum_free_heap_size());
+    for (int i = 0; i < n; i++) {
+        ESP_LOGI(TAG, "stack %-16s %5u B unused", names[i], (unsigned)hwm[i]);
+    }
+    for (int i = 0; i < s_state_count; i++) {
+        ESP_LOGI(TAG, "state %d: %u allocs, %u frees", i, (unsigned)s_allocs[i], (unsigned)s_frees[i]);
+    }
+}
+
+/**
+ * @brief Append a JSON array of per-state counters.
+ * @return Bytes written, or -1 if it does not fit.
+ */
+static int diag_append_counts(char *buf, size_t len, const char *key, const uint32_t *counts)
+{
+    int pos = snprintf(buf, len, ",\"%s\":[", key);
+    for (int i = 0; i < s_state_count && pos > 0 && (size_t)pos < len; i++) {
+        pos += snprintf(buf + pos, len - pos, "%s%u", i ? "," : "", (unsigned)counts[i]);
+    }
+    if (pos < 0 || (size_t)pos >= len) {
+        return -1;
+    }
+    pos += snprintf(buf + pos, len - pos, "]");
+    return (size_t)pos < len ? pos : -1;
+}
+
+int diag_format_json(char *buf, size_t len)
+{
+    const char *names[DIAG_MAX_TASKS];
+    uint32_t hwm[DIAG_MAX_TASKS];
+    int n = diag_collect_tasks(names, hwm);
+
+    int pos = snprintf(buf, len, "{\"diag\":1,\"heap\":%u,\"heap_min\":%u",
+                       (unsigned)esp_get_free_heap_size(), (unsigned)esp_get_minimum_free_heap_size());
+    if (pos < 0 || (size_t)pos >= len) {
+        return 0;
+    }
+
+    int w = diag_append_counts(buf + pos, len - pos, "alloc", s_allocs);
+    if (w < 0) {
+        return 0;
+    }
+    pos += w;
+    w = diag_append_counts(buf + pos, len - pos, "free", s_frees);
+    if (w < 0) {
+        return 0;
+    }
+    pos += w;
+
+    // Keep room for the closing "}}"
+    w = snprintf(buf + pos, len - pos, ",\"stack\":{");
+    if (w < 0 || (size_t)(pos + w + 2) >= len) {
+        return 0;
+    }
+    pos += w;
+    for (int i = 0, first = 1; i < n; i++) {
+        char entry[40];
+        int e = snprintf(entry, sizeof(entry), "%s\"%s\":%u", first ? "" : ",", names[i], (unsigned)hwm[i]);
+        if (e < 0 || (size_t)e >= sizeof(entry) || (size_t)(pos + e + 2) >= len) {
+            continue;
+        }
+        memcpy(buf + pos, entry, e);
+        pos += e;
+        first = 0;
+    }
+    pos += snprintf(buf + pos, len - pos, "}}");
+    return pos;
+}
@@ -0,0 +1,62 @@
+#ifndef BEACON_H
+#define BEACON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+/**
+ * @file beacon.h
+ * @brief Time beacon sent by the receiver for TDMA uplink slots.
+ *
+ * The receiver sends a beacon at the start of every period. The header
+ * carries the receiver ID and a beacon counter, then, little-endian:
+ *
+ *   bytes 4-5  period, uint16, seconds
+ *   bytes 6-7  slot length, uint16, ms
+ *   byte 8     number of slots
+ *
+ * The first slot of the period holds the beacon itself, sender slots
+ * follow, so the layout must fit in the period. The end of the beacon
+ * (RxDone) gives the senders the start of the period, less its time on air.
+ */
+
+#define BEACON_LEN (FRAME_HEADER_LEN + 5)
+
+/**
+ * @brief Slot layout of a TDMA period.
+ */
+typedef struct {
+    uint16_t period_s;     ///< Time between beacons
+    uint16_t slot_ms;      ///< Length of a slot, the beacon's included
+    uint8_t slot_count;    ///< Sender slots after the beacon's
+} BeaconSchedule;
+
+/**
+ * @brief Check that a layout fits in its period.
+ * @param s Layout.
+ * @return 0 if valid, -1 otherwise.
+ */
+int beacon_validate(const BeaconSchedule *s);
+
+/**
+ * @brief Encode a beacon.
+ * @param hdr Receiver ID and beacon counter (type is set by the encoder).
+ * @param s Layout, checked with beacon_validate().
+ * @param buf Output buffer.
+ * @param len Size of @p buf (BEACON_LEN is enough).
+ * @return Frame length (BEACON_LEN), or -1 on an invalid layout or a too small buffer.
+ */
+int beacon_encode(const FrameHeader *hdr, const BeaconSchedule *s, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode a beacon.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param hdr Output header.
+ * @param s Output layout.
+ * @return 0 on success, -1 if @p buf is not a valid beacon.
+ */
+int beacon_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, BeaconSchedule *s);
+
+#endif // BEACON_H
@@ -0,0 +1,79 @@
+#ifndef BULK_H
+#define BULK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+/**
+ * @file bulk.h
+ * @brief Bulk transfer of a sender's backlog in an FSK burst.
+ *
+ * A sender that kept frames during an outage asks for a transfer over LoRa.
+ * When the receiver grants it, both radios switch to FSK, the sender sends
+ * the backlog frame by frame, each acknowledged, then ends the transfer and
+ * both go back to LoRa. Every message is a FRAME_TYPE_BULK frame, the
+ * header then:
+ *
+ *   byte 4     operation (BulkOp)
+ *   then       by operation:
+ *     REQUEST  byte 5, frames to send                      (LoRa)
+ *     ACCEPT   byte 5, frames granted, 0 to refuse         (LoRa)
+ *     DATA     bytes 5-8, age of the last sample of the
+ *              frame, uint32, seconds; then the frame      (FSK)
+ *     END      nothing                                     (FSK)
+ *
+ * ACCEPT carries the device ID and sequence number of the request, so it
+ * is also its ACK. DATA and END are acknowledged with ACK frames. A frame
+ * carried by DATA has the device ID and sequence number of its DATA frame.
+ */
+
+#define BULK_CONTROL_LEN      (FRAME_HEADER_LEN + 2)
+#define BULK_END_LEN          (FRAME_HEADER_LEN + 1)
+#define BULK_DATA_HEADER_LEN  (FRAME_HEADER_LEN + 5)
+#define BULK_DATA_MAX         (FRAME_MAX_LEN - BULK_DATA_HEADER_LEN)   ///< Longest frame carried
+
+/**
+ * @enum BulkOp
+ * @brief Bulk transfer operations (byte 4).
+ */
+typedef enum {
+    BULK_REQUEST = 1,   ///< Sender asks for a transfer
+    BULK_ACCEPT = 2,    ///< Receiver grants it, or refuses with 0 frames
+    BULK_DATA = 3,      ///< One frame of the backlog
+    BULK_END = 4,       ///< Last message, both ends go back to LoRa
+} BulkOp;
+
+/**
+ * @brief A bulk transfer message, only the fields of its operation are meaningful.
+ */
+typedef struct {
+    uint8_t op;             ///< BulkOp
+    uint8_t count;          ///< REQUEST: frames to send, ACCEPT: frames granted
+    uint32_t age_s;         ///< DATA: age of the last sample of the frame
+    const uint8_t *frame;   ///< DATA: frame carried, points into the encoded bytes on decode
+    size_t frame_len;       ///< DATA: length of @c frame
+} BulkMsg;
+
+/**
+ * @brief Encode a bulk transfer message.
+ * @param hdr Device ID and sequence number (type is set by the encoder).
+ * @param m Message. A DATA frame must be a frame of another type, at most
+ *        BULK_DATA_MAX bytes.
+ * @param buf Output buffer.
+ * @param len Size of @p buf.
+ * @return Message length, or -1 on an invalid message or a too small buffer.
+ */
+int bulk_encode(const FrameHeader *hdr, const BulkMsg *m, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode a bulk transfer message.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param hdr Output header.
+ * @param m Output message, @c frame points into @p buf.
+ * @return 0 on success, -1 if @p buf is not a valid bulk transfer message.
+ */
+int bulk_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, BulkMsg *m);
+
+#endif // BULK_H
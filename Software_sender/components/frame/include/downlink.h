@@ -0,0 +1,90 @@
+#ifndef DOWNLINK_H
+#define DOWNLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+/**
+ * @file downlink.h
+ * @brief Configuration commands sent by the receiver to a sender.
+ *
+ * When the receiver holds commands for a sender, it answers that sender's
+ * frame with a FRAME_TYPE_CONFIG frame instead of a plain ACK. The header
+ * carries the device ID and sequence number of the acknowledged frame, so the
+ * frame is also the ACK. Commands follow, each an ID byte then a fixed-size
+ * little-endian value:
+ *
+ *   0x01  sleep interval, uint16, seconds
+ *   0x02  samples per cycle, uint8
+ *   0x03  sampling period, uint16, ms
+ *   0x04  spreading factor, uint8
+ *   0x05  TX power, uint8, dBm
+ *
+ * A frame with all five commands is 16 bytes. An unknown ID or an
+ * out-of-range value rejects the whole frame, so a sender never applies
+ * part of a command set.
+ */
+
+#define DOWNLINK_MAX_LEN        (FRAME_HEADER_LEN + 12)
+#define DOWNLINK_SLEEP_MIN_S    1
+#define DOWNLINK_SAMPLES_MAX    30     ///< Bounds the sender's per-cycle sample buffers
+#define DOWNLINK_PERIOD_MIN_MS  100
+#define DOWNLINK_PERIOD_MAX_MS  60000
+#define DOWNLINK_SF_MIN         7      ///< SF6 needs implicit header mode
+#define DOWNLINK_SF_MAX         12
+#define DOWNLINK_TX_POWER_MIN   2      ///< PA_BOOST range of lora_set_tx_power()
+#define DOWNLINK_TX_POWER_MAX   17
+
+/**
+ * @enum DownlinkCmd
+ * @brief Command IDs, also the bit of each command in DownlinkConfig.set.
+ */
+typedef enum {
+    DOWNLINK_SLEEP_S = 1,
+    DOWNLINK_SAMPLE_COUNT = 2,
+    DOWNLINK_SAMPLE_PERIOD_MS = 3,
+    DOWNLINK_SF = 4,
+    DOWNLINK_TX_POWER = 5,
+} DownlinkCmd;
+
+/**
+ * @brief A set of commands, only the fields flagged in @c set are meaningful.
+ */
+typedef struct {
+    uint8_t set;                 ///< Bit (1 << DownlinkCmd) for each command present
+    uint16_t sleep_s;
+    uint8_t sample_count;
+    uint16_t sample_period_ms;
+    uint8_t sf;
+    uint8_t tx_power;
+} DownlinkConfig;
+
+/**
+ * @brief Check that every command of a set is in range.
+ * @param c Commands.
+ * @return 0 if valid and not empty, -1 otherwise.
+ */
+int downlink_validate(const DownlinkConfig *c);
+
+/**
+ * @brief Encode a configuration frame.
+ * @param hdr Device ID and sequence number of the acknowledged frame.
+ * @param c Commands, checked with downlink_validate().
+ * @param buf Output buffer.
+ * @param len Size of @p buf (DOWNLINK_MAX_LEN is enough).
+ * @return Frame length, or -1 on invalid commands or a too small buffer.
+ */
+int downlink_encode(const FrameHeader *hdr, const DownlinkConfig *c, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode a configuration frame.
+ * @param buf Received bytes.
+ * @param len Number of bytes.
+ * @param hdr Output header.
+ * @param c Output commands.
+ * @return 0 on success, -1 if @p buf is not a valid configuration frame.
+ */
+int downlink_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, DownlinkConfig *c);
+
+#endif // DOWNLINK_H
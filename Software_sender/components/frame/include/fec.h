@@ -0,0 +1,148 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+/**
+ * @file fec.h
+ * @brief Erasure coding across frames (systematic Reed-Solomon, Cauchy matrix over GF(256)).
+ *
+ * Data frames are sent unchanged. After a group of k consecutive frames
+ * (sequence numbers seq .. seq + k - 1), the sender adds m repair frames
+ * (FRAME_TYPE_FEC). Any k of the k + m frames rebuild the group, so up to m
+ * lost frames per group are recovered without a downlink.
+ *
+ * Each data frame is coded as a symbol of its length byte followed by the
+ * frame, zero-padded to the longest symbol of the group. A repair frame is:
+ *
+ *   bytes 0-3   common header, seq = first sequence number of the group
+ *   byte 4      k, data frames in the group
+ *   byte 5      m, repair frames of the group
+ *   byte 6      repair index j (0 .. m - 1)
+ *   then        repair symbol j = sum over i of C[j][i] * symbol i
+ *
+ * with C[j][i] = 1 / (j + (FEC_MAX_M + i)) in GF(256), a Cauchy matrix:
+ * every square submatrix is invertible, which makes the code MDS.
+ *
+ * The encoder accumulates repair symbols frame by frame, so its state is a
+ * few hundred bytes and can stay in RTC memory across deep sleep.
+ */
+
+#define FEC_MAX_K         16   ///< Data frames per group
+#define FEC_MAX_M         4    ///< Repair frames per group
+#define FEC_HEADER_LEN    (FRAME_HEADER_LEN + 3)
+#define FEC_MAX_DATA_LEN  (FRAME_MAX_LEN - FEC_HEADER_LEN - 1)   ///< Longest frame that can be protected
+#define FEC_SYMBOL_MAX    (FEC_MAX_DATA_LEN + 1)
+
+/**
+ * @brief Sender state of the current group.
+ */
+typedef struct {
+    uint8_t k;                                 ///< Group size
+    uint8_t m;                                 ///< Repair frames per group
+    uint8_t count;                             ///< Data frames added to the group
+    uint8_t first_seq;                         ///< Sequence number of the first frame
+    uint8_t sym_len;                           ///< Longest symbol of the group
+    uint8_t repair[FEC_MAX_M][FEC_SYMBOL_MAX]; ///< Repair symbols accumulated so far
+} FecEncoder;
+
+/**
+ * @brief Data frame kept by the receiver.
+ */
+typedef struct {
+    uint8_t valid;
+    uint8_t seq;
+    uint8_t len;
+    uint8_t data[FEC_MAX_DATA_LEN];
+} FecFrame;
+
+/**
+ * @brief Receiver state for one sender.
+ */
+typedef struct {
+    uint8_t used;
+    uint16_t device_id;
+    FecFrame hist[FEC_MAX_K];                  ///< Last data frames, by seq % FEC_MAX_K
+    uint8_t group_seq;                         ///< Group of the stored repair frames
+    uint8_t group_k;
+    uint8_t group_done;                        ///< Group rebuilt or complete
+    uint8_t repair_have;                       ///< Bit j set when repair j was received
+    uint8_t repair_len;                        ///< Repair symbol length
+    uint8_t repair[FEC_MAX_M][FEC_SYMBOL_MAX];
+    uint32_t recovered;                        ///< Frames rebuilt
+    uint32_t unrecoverable;                    ///< Frames lost with too few repairs
+} FecDecoder;
+
+/**
+ * @brief A frame rebuilt by the decoder.
+ */
+typedef struct {
+    uint8_t seq;
+    const uint8_t *frame;   ///< Points into the decoder history
+    size_t len;
+} FecRecovered;
+
+/**
+ * @brief Start a new group.
+ * @param e Encoder.
+ * @param k Data frames per group (1 to FEC_MAX_K).
+ * @param m Repair frames per group (1 to FEC_MAX_M).
+ */
+void fec_encoder_init(FecEncoder *e, int k, int m);
+
+/**
+ * @brief Add a sent data frame to the current group.
+ * @param e Encoder.
+ * @param frame Frame, its header gives the sequence number.
+ * @param len Frame length.
+ * @return Frames in the group (k when the repair frames are due), or -1 if
+ *         the frame is longer than FEC_MAX_DATA_LEN or not a frame.
+ */
+int fec_encoder_add(FecEncoder *e, const uint8_t *frame, size_t len);
+
+/**
+ * @brief Encode repair frame @p j of the current group.
+ *
+ * Can be called before the group is full, the repair then covers the frames
+ * added so far. Call fec_encoder_init() afterwards to start the next group.
+ *
+ * @param e Encoder.
+ * @param device_id Sender ID.
+ * @param j Repair index (0 .. m - 1).
+ * @param buf Output buffer.
+ * @param len Size of @p buf.
+ * @return Frame length, or -1 if the group is empty or @p buf is too small.
+ */
+int fec_encode_repair(const FecEncoder *e, uint16_t device_id, int j, uint8_t *buf, size_t len);
+
+/**
+ * @brief Reset the receiver state for a sender.
+ * @param d Decoder.
+ * @param device_id Sender ID.
+ */
+void fec_decoder_init(FecDecoder *d, uint16_t device_id);
+
+/**
+ * @brief Keep a received data frame for a later repair.
+ * @param d Decoder of the sender.
+ * @param seq Sequence number of the frame.
+ * @param frame Frame.
+ * @param len Frame length, frames longer than FEC_MAX_DATA_LEN are ignored.
+ */
+void fec_decoder_add_data(FecDecoder *d, uint8_t seq, const uint8_t *frame, size_t len);
+
+/**
+ * @brief Add a repair frame and rebuild the missing frames of its group.
+ * @param d Decoder of the sender.
+ * @param buf Repair frame.
+ * @param len Frame length.
+ * @param out Output rebuilt frames, valid until the next call.
+ * @param max Capacity of @p out (FEC_MAX_M is enough).
+ * @return Number of rebuilt frames, 0 while repairs are missing, -1 if
+ *         @p buf is not a valid repair frame.
+ */
+int fec_decoder_add_repair(FecDecoder *d, const uint8_t *buf, size_t len, FecRecovered *out, int max);
+
+#endif // FEC_H
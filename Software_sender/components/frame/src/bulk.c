@@ -0,0 +1,86 @@
+/**
+ * @file bulk.c
+ * @brief Bulk transfer message encoder and decoder.
+ */
+
+#include <string.h>
+#include "bulk.h"
+
+/**
+ * @brief Check that a DATA message carries a frame of another type.
+ */
+static int bulk_frame_valid(const uint8_t *frame, size_t len)
+{
+    FrameHeader hdr;
+    return len <= BULK_DATA_MAX && frame_parse_header(frame, len, &hdr) == 0
+           && hdr.type != FRAME_TYPE_BULK;
+}
+
+int bulk_encode(const FrameHeader *hdr, const BulkMsg *m, uint8_t *buf, size_t len)
+{
+    size_t n;
+    switch (m->op) {
+    case BULK_REQUEST:
+    case BULK_ACCEPT:
+        n = BULK_CONTROL_LEN;
+        break;
+    case BULK_DATA:
+        if (!bulk_frame_valid(m->frame, m->frame_len)) {
+            return -1;
+        }
+        n = BULK_DATA_HEADER_LEN + m->frame_len;
+        break;
+    case BULK_END:
+        n = BULK_END_LEN;
+        break;
+    default:
+        return -1;
+    }
+    if (len < n || (m->op == BULK_REQUEST && m->count == 0)) {
+        return -1;
+    }
+    buf[0] = (FRAME_VERSION << 4) | FRAME_TYPE_BULK;
+    buf[1] = hdr->device_id & 0xff;
+    buf[2] = hdr->device_id >> 8;
+    buf[3] = hdr->seq;
+    buf[4] = m->op;
+    if (m->op == BULK_REQUEST || m->op == BULK_ACCEPT) {
+        buf[5] = m->count;
+    } else if (m->op == BULK_DATA) {
+        for (int i = 0; i < 4; i++) {
+            buf[5 + i] = m->age_s >> (8 * i);
+        }
+        memcpy(buf + BULK_DATA_HEADER_LEN, m->frame, m->frame_len);
+    }
+    return (int)n;
+}
+
+int bulk_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, BulkMsg *m)
+{
+    if (frame_parse_header(buf, len, hdr) != 0 || hdr->type != FRAME_TYPE_BULK || len < BULK_END_LEN) {
+        return -1;
+    }
+    *m = (BulkMsg){ .op = buf[4] };
+    switch (m->op) {
+    case BULK_REQUEST:
+    case BULK_ACCEPT:
+        if (len != BULK_CONTROL_LEN || (m->op == BULK_REQUEST && buf[5] == 0)) {
+            return -1;
+        }
+        m->count = buf[5];
+        return 0;
+    case BULK_DATA:
+        if (len <= BULK_DATA_HEADER_LEN
+            || !bulk_frame_valid(buf + BULK_DATA_HEADER_LEN, len - BULK_DATA_HEADER_LEN)) {
+            return -1;
+        }
+        m->age_s = buf[5] | (buf[6] << 8) | (buf[7] << 16) | ((uint32_t)buf[8] << 24);
+        m->frame = buf + BULK_DATA_HEADER_LEN;
+        m->frame_len = len - BULK_DATA_HEADER_LEN;
+        return 0;
+    case BULK_END:
+        return len == BULK_END_LEN ? 0 : -1;
+    default:
+        return -1;
+    }
+}
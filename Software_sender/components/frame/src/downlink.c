@@ -0,0 +1,110 @@
+/**
+ * @file downlink.c
+ * @brief Configuration frame encoder and decoder.
+ */
+
+#include "downlink.h"
+
+#define BIT(cmd) (1u << (cmd))
+#define DOWNLINK_ALL (BIT(DOWNLINK_SLEEP_S) | BIT(DOWNLINK_SAMPLE_COUNT) | BIT(DOWNLINK_SAMPLE_PERIOD_MS) \
+                      | BIT(DOWNLINK_SF) | BIT(DOWNLINK_TX_POWER))
+
+/**
+ * @brief Value size of a command, 0 if the ID is unknown.
+ */
+static int downlink_value_len(int cmd)
+{
+    switch (cmd) {
+    case DOWNLINK_SLEEP_S:
+    case DOWNLINK_SAMPLE_PERIOD_MS:
+        return 2;
+    case DOWNLINK_SAMPLE_COUNT:
+    case DOWNLINK_SF:
+    case DOWNLINK_TX_POWER:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int downlink_validate(const DownlinkConfig *c)
+{
+    if (c->set == 0 || (c->set & ~DOWNLINK_ALL)) {
+        return -1;
+    }
+    if ((c->set & BIT(DOWNLINK_SLEEP_S)) && c->sleep_s < DOWNLINK_SLEEP_MIN_S) {
+        return -1;
+    }
+    if ((c->set & BIT(DOWNLINK_SAMPLE_COUNT))
+        && (c->sample_count < 1 || c->sample_count > DOWNLINK_SAMPLES_MAX)) {
+        return -1;
+    }
+    if ((c->set & BIT(DOWNLINK_SAMPLE_PERIOD_MS))
+        && (c->sample_period_ms < DOWNLINK_PERIOD_MIN_MS || c->sample_period_ms > DOWNLINK_PERIOD_MAX_MS)) {
+        return -1;
+    }
+    if ((c->set & BIT(DOWNLINK_SF)) && (c->sf < DOWNLINK_SF_MIN || c->sf > DOWNLINK_SF_MAX)) {
+        return -1;
+    }
+    if ((c->set & BIT(DOWNLINK_TX_POWER))
+        && (c->tx_power < DOWNLINK_TX_POWER_MIN || c->tx_power > DOWNLINK_TX_POWER_MAX)) {
+        return -1;
+    }
+    return 0;
+}
+
+int downlink_encode(const FrameHeader *hdr, const DownlinkConfig *c, uint8_t *buf, size_t len)
+{
+    if (downlink_validate(c) != 0 || len < DOWNLINK_MAX_LEN) {
+        return -1;
+    }
+    buf[0] = (FRAME_VERSION << 4) | FRAME_TYPE_CONFIG;
+    buf[1] = hdr->device_id & 0xff;
+    buf[2] = hdr->device_id >> 8;
+    buf[3] = hdr->seq;
+
+    int n = FRAME_HEADER_LEN;
+    for (int cmd = DOWNLINK_SLEEP_S; cmd <= DOWNLINK_TX_POWER; cmd++) {
+        if (!(c->set & BIT(cmd))) {
+            continue;
+        }
+        uint16_t v = cmd == DOWNLINK_SLEEP_S ? c->sleep_s
+                   : cmd == DOWNLINK_SAMPLE_COUNT ? c->sample_count
+                   : cmd == DOWNLINK_SAMPLE_PERIOD_MS ? c->sample_period_ms
+                   : cmd == DOWNLINK_SF ? c->sf
+                   : c->tx_power;
+        buf[n++] = (uint8_t)cmd;
+        buf[n++] = v & 0xff;
+        if (downlink_value_len(cmd) == 2) {
+            buf[n++] = v >> 8;
+        }
+    }
+    return n;
+}
+
+int downlink_decode(const uint8_t *buf, size_t len, FrameHeader *hdr, DownlinkConfig *c)
+{
+    if (frame_parse_header(buf, len, hdr) != 0 || hdr->type != FRAME_TYPE_CONFIG) {
+        return -1;
+    }
+    *c = (DownlinkConfig){ 0 };
+    size_t i = FRAME_HEADER_LEN;
+    while (i < len) {
+        int cmd = buf[i++];
+        int n = downlink_value_len(cmd);
+        if (n == 0 || i + n > len || (c->set & BIT(cmd))) {
+            return -1;   // Unknown, truncated or repeated command
+        }
+        uint16_t v = n == 2 ? buf[i] | (buf[i + 1] << 8) : buf[i];
+        i += n;
+        switch (cmd) {
+        case DOWNLINK_SLEEP_S:          c->sleep_s = v; break;
+        case DOWNLINK_SAMPLE_COUNT:     c->sample_count = (uint8_t)v; break;
+        case DOWNLINK_SAMPLE_PERIOD_MS: c->sample_period_ms = v; break;
+        case DOWNLINK_SF:               c->sf = (uint8_t)v; break;
+        case DOWNLINK_TX_POWER:         c->tx_power = (uint8_t)v; break;
+        }
+        c->set |= BIT(cmd);
+    }
+    return downlink_validate(c);
+}
@@ -0,0 +1,295 @@
+/**
+ * @file fec.c
+ * @brief Reed-Solomon erasure coding across frames, GF(256) with polynomial 0x11d.
+ */
+
+#include <string.h>
+#include "fec.h"
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+
+/**
+ * @brief Build the log / antilog tables, once.
+ */
+static void gf_init(void)
+{
+    if (gf_exp[0]) {
+        return;
+    }
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf_exp[i] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11d;
+        }
+    }
+    // Doubled so that gf_exp[log a + log b] needs no modulo
+    for (int i = 255; i < 512; i++) {
+        gf_exp[i] = gf_exp[i - 255];
+    }
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    return (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+static uint8_t gf_inv(uint8_t a)
+{
+    return gf_exp[255 - gf_log[a]];
+}
+
+/**
+ * @brief Cauchy coefficient of data symbol @p i in repair symbol @p j.
+ */
+static uint8_t fec_coef(int j, int i)
+{
+    return gf_inv((uint8_t)(j ^ (FEC_MAX_M + i)));
+}
+
+/**
+ * @brief dst ^= c * src over @p n bytes.
+ */
+static void gf_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, size_t n)
+{
+    if (c == 0) {
+        return;
+    }
+    unsigned lc = gf_log[c];
+    for (size_t b = 0; b < n; b++) {
+        if (src[b]) {
+            dst[b] ^= gf_exp[lc + gf_log[src[b]]];
+        }
+    }
+}
+
+/**
+ * @brief Add the symbol of a frame (length byte, then the frame) times @p c.
+ */
+static void fec_add_symbol(uint8_t *dst, const uint8_t *frame, size_t len, uint8_t c)
+{
+    uint8_t n = (uint8_t)len;
+    gf_mul_add(dst, &n, c, 1);
+    gf_mul_add(dst + 1, frame, c, len);
+}
+
+void fec_encoder_init(FecEncoder *e, int k, int m)
+{
+    gf_init();
+    e->k = (uint8_t)(k < 1 ? 1 : k > FEC_MAX_K ? FEC_MAX_K : k);
+    e->m = (uint8_t)(m < 1 ? 1 : m > FEC_MAX_M ? FEC_MAX_M : m);
+    e->count = 0;
+    e->sym_len = 0;
+}
+
+int fec_encoder_add(FecEncoder *e, const uint8_t *frame, size_t len)
+{
+    FrameHeader hdr;
+    if (len > FEC_MAX_DATA_LEN || frame_parse_header(frame, len, &hdr) != 0) {
+        return -1;
+    }
+    gf_init();
+    if (e->count == 0) {
+        e->first_seq = hdr.seq;
+        memset(e->repair, 0, sizeof(e->repair));
+    } else if (hdr.seq != (uint8_t)(e->first_seq + e->count) || e->count >= e->k) {
+        return -1;   // Not the next frame of this group
+    }
+    for (int j = 0; j < e->m; j++) {
+        fec_add_symbol(e->repair[j], frame, len, fec_coef(j, e->count));
+    }
+    if (len + 1 > e->sym_len) {
+        e->sym_len = (uint8_t)(len + 1);
+    }
+    return ++e->count;
+}
+
+int fec_encode_repair(const FecEncoder *e, uint16_t device_id, int j, uint8_t *buf, size_t len)
+{
+    if (e->count == 0 || j < 0 || j >= e->m || len < (size_t)FEC_HEADER_LEN + e->sym_len) {
+        return -1;
+    }
+    buf[0] = (FRAME_VERSION << 4) | FRAME_TYPE_FEC;
+    buf[1] = device_id & 0xff;
+    buf[2] = device_id >> 8;
+    buf[3] = e->first_seq;
+    buf[4] = e->count;
+    buf[5] = e->m;
+    buf[6] = (uint8_t)j;
+    memcpy(buf + FEC_HEADER_LEN, e->repair[j], e->sym_len);
+    return FEC_HEADER_LEN + e->sym_len;
+}
+
+void fec_decoder_init(FecDecoder *d, uint16_t device_id)
+{
+    gf_init();
+    memset(d, 0, sizeof(*d));
+    d->used = 1;
+    d->device_id = device_id;
+}
+
+void fec_decoder_add_data(FecDecoder *d, uint8_t seq, const uint8_t *frame, size_t len)
+{
+    if (len > FEC_MAX_DATA_LEN) {
+        return;
+    }
+    FecFrame *h = &d->hist[seq % FEC_MAX_K];
+    h->valid = 1;
+    h->seq = seq;
+    h->len = (uint8_t)len;
+    memcpy(h->data, frame, len);
+}
+
+/**
+ * @brief Data frame @p i of the current group, or NULL if it was not received.
+ */
+static FecFrame *fec_group_frame(FecDecoder *d, int i)
+{
+    uint8_t seq = d->group_seq + i;
+    FecFrame *h = &d->hist[seq % FEC_MAX_K];
+    return h->valid && h->seq == seq ? h : NULL;
+}
+
+/**
+ * @brief Invert an n x n matrix in place (Gauss-Jordan).
+ * @return 0 on success, -1 if singular (never for a Cauchy submatrix).
+ */
+static int gf_invert(uint8_t a[FEC_MAX_M][FEC_MAX_M], int n)
+{
+    uint8_t inv[FEC_MAX_M][FEC_MAX_M] = { 0 };
+    for (int i = 0; i < n; i++) {
+        inv[i][i] = 1;
+    }
+    for (int c = 0; c < n; c++) {
+        int p = c;
+        while (p < n && a[p][c] == 0) {
+            p++;
+        }
+        if (p == n) {
+            return -1;
+        }
+        for (int k = 0; k < n; k++) {
+            uint8_t t = a[c][k]; a[c][k] = a[p][k]; a[p][k] = t;
+            t = inv[c][k]; inv[c][k] = inv[p][k]; inv[p][k] = t;
+        }
+        uint8_t s = gf_inv(a[c][c]);
+        for (int k = 0; k < n; k++) {
+            a[c][k] = gf_mul(a[c][k], s);
+            inv[c][k] = gf_mul(inv[c][k], s);
+        }
+        for (int r = 0; r < n; r++) {
+            uint8_t f = a[r][c];
+            if (r == c || f == 0) {
+                continue;
+            }
+            for (int k = 0; k < n; k++) {
+                a[r][k] ^= gf_mul(f, a[c][k]);
+                inv[r][k] ^= gf_mul(f, inv[c][k]);
+            }
+        }
+    }
+    memcpy(a, inv, sizeof(inv));
+    return 0;
+}
+
+int fec_decoder_add_repair(FecDecoder *d, const uint8_t *buf, size_t len, FecRecovered *out, int max)
+{
+    FrameHeader hdr;
+    if (frame_parse_header(buf, len, &hdr) != 0 || hdr.type != FRAME_TYPE_FEC
+        || len < FEC_HEADER_LEN + 1 || len > FEC_HEADER_LEN + FEC_SYMBOL_MAX) {
+        return -1;
+    }
+    int k = buf[4], m = buf[5], j = buf[6];
+    uint8_t sym_len = (uint8_t)(len - FEC_HEADER_LEN);
+    if (k < 1 || k > FEC_MAX_K || m < 1 || m > FEC_MAX_M || j >= m) {
+        return -1;
+    }
+
+    if (hdr.seq != d->group_seq || k != d->group_k || sym_len != d->repair_len) {
+        // First repair of a new group: the previous one will get no more
+        if (d->group_k && !d->group_done) {
+            for (int i = 0; i < d->group_k; i++) {
+                d->unrecoverable += fec_group_frame(d, i) == NULL;
+            }
+        }
+        d->group_seq = hdr.seq;
+        d->group_k = (uint8_t)k;
+        d->group_done = 0;
+        d->repair_have = 0;
+        d->repair_len = sym_len;
+    }
+    if (d->group_done || (d->repair_have & (1 << j))) {
+        return 0;
+    }
+    memcpy(d->repair[j], buf + FEC_HEADER_LEN, sym_len);
+    d->repair_have |= 1 << j;
+
+    int missing[FEC_MAX_M];
+    int rows[FEC_MAX_M];
+    int e = 0, r = 0;
+    for (int i = 0; i < k; i++) {
+        if (!fec_group_frame(d, i)) {
+            if (e == FEC_MAX_M) {
+                return 0;   // More losses than any group can repair
+            }
+            missing[e++] = i;
+        }
+    }
+    for (int jj = 0; jj < FEC_MAX_M && r < e; jj++) {
+        if (d->repair_have & (1 << jj)) {
+            rows[r++] = jj;
+        }
+    }
+    if (e == 0) {
+        d->group_done = 1;
+        return 0;
+    }
+    if (r < e || e > max) {
+        return 0;
+    }
+
+    // Remove the received frames from the repair symbols
+    for (int i = 0; i < k; i++) {
+        const FecFrame *f = fec_group_frame(d, i);
+        if (f && f->len + 1 <= sym_len) {
+            for (int q = 0; q < e; q++) {
+                fec_add_symbol(d->repair[rows[q]], f->data, f->len, fec_coef(rows[q], i));
+            }
+        }
+    }
+    // Solve A x = repair, A[q][c] = C[rows[q]][missing[c]]
+    uint8_t a[FEC_MAX_M][FEC_MAX_M];
+    for (int q = 0; q < e; q++) {
+        for (int c = 0; c < e; c++) {
+            a[q][c] = fec_coef(rows[q], missing[c]);
+        }
+    }
+    if (gf_invert(a, e) != 0) {
+        return 0;
+    }
+    d->group_done = 1;
+
+    int n = 0;
+    for (int c = 0; c < e; c++) {
+        uint8_t sym[FEC_SYMBOL_MAX] = { 0 };
+        for (int q = 0; q < e; q++) {
+            gf_mul_add(sym, d->repair[rows[q]], a[c][q], sym_len);
+        }
+        // Keep only what decodes to the frame the sender numbered
+        uint8_t seq = d->group_seq + missing[c];
+        FrameHeader fh;
+        if (sym[0] + 1 > sym_len || sym[0] > FEC_MAX_DATA_LEN
+            || frame_parse_header(sym + 1, sym[0], &fh) != 0 || fh.seq != seq) {
+            d->unrecoverable++;
+            continue;
+        }
+        fec_decoder_add_data(d, seq, sym + 1, sym[0]);
+        const FecFrame *f = &d->hist[seq % FEC_MAX_K];
+        out[n++] = (FecRecovered){ .seq = seq, .frame = f->data, .len = f->len };
+    }
+    d->recovered += n;
+    return n;
+}
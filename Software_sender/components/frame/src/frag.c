@@ -0,0 +1,190 @@
+/**
+ * @file frag.c
+ * @brief Message fragmentation and bounded-pool reassembly.
+ */
+
+#include <string.h>
+#include "frag.h"
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/**
+ * @brief Payload bytes carried by each fragment but the last.
+ */
+static size_t frag_chunk(size_t msg_len, int count)
+{
+    return (msg_len + count - 1) / count;
+}
+
+/**
+ * @brief Payload length of fragment @p index, 0 if there is none.
+ */
+static size_t frag_data_len(size_t msg_len, int count, int index)
+{
+    size_t chunk = frag_chunk(msg_len, count);
+    size_t start = index * chunk;
+    if (start >= msg_len) {
+        return 0;
+    }
+    return msg_len - start < chunk ? msg_len - start : chunk;
+}
+
+int frag_count(size_t msg_len, size_t frag_len)
+{
+    if (frag_len <= FRAG_HEADER_LEN || msg_len == 0 || msg_len > UINT16_MAX) {
+        return -1;
+    }
+    size_t payload = frag_len - FRAG_HEADER_LEN;
+    size_t count = (msg_len + payload - 1) / payload;
+    return count <= FRAG_MAX_COUNT ? (int)count : -1;
+}
+
+int frag_encode(const FrameHeader *hdr, uint8_t msg_id, const uint8_t *msg, size_t msg_len,
+                size_t frag_len, int index, uint8_t *buf, size_t len)
+{
+    int count = frag_count(msg_len, frag_len);
+    if (count < 0 || index < 0 || index >= count) {
+        return -1;
+    }
+    size_t n = frag_data_len(msg_len, count, index);
+    if (n == 0 || FRAG_HEADER_LEN + n > len) {
+        return -1;
+    }
+
+    buf[0] = (FRAME_VERSION << 4) | FRAME_TYPE_FRAG;
+    put_u16(buf + 1, hdr->device_id);
+    buf[3] = hdr->seq;
+    buf[4] = msg_id;
+    buf[5] = (uint8_t)index;
+    buf[6] = (uint8_t)count;
+    put_u16(buf + 7, (uint16_t)msg_len);
+    memcpy(buf + FRAG_HEADER_LEN, msg + index * frag_chunk(msg_len, count), n);
+    return (int)(FRAG_HEADER_LEN + n);
+}
+
+int frag_parse(const uint8_t *buf, size_t len, FrameFragment *f)
+{
+    if (frame_parse_header(buf, len, &f->hdr) != 0 || f->hdr.type != FRAME_TYPE_FRAG
+        || len < FRAG_HEADER_LEN) {
+        return -1;
+    }
+    f->msg_id = buf[4];
+    f->index = buf[5];
+    f->count = buf[6];
+    f->msg_len = get_u16(buf + 7);
+    f->data = buf + FRAG_HEADER_LEN;
+    f->data_len = len - FRAG_HEADER_LEN;
+    if (f->count == 0 || f->count > FRAG_MAX_COUNT || f->index >= f->count || f->msg_len == 0) {
+        return -1;
+    }
+    // Every fragment length follows from the message length and count
+    size_t expected = frag_data_len(f->msg_len, f->count, f->index);
+    return expected != 0 && f->data_len == expected ? 0 : -1;
+}
+
+void frag_reasm_init(FragReasm *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+int frag_reasm_expire(FragReasm *r, uint32_t now_ms)
+{
+    int n = 0;
+    for (int i = 0; i < CONFIG_FRAME_REASM_SLOTS; i++) {
+        FragSlot *s = &r->slots[i];
+        if (s->used && now_ms - s->last_ms >= CONFIG_FRAME_REASM_TIMEOUT_MS) {
+            s->used = 0;
+            n++;
+        }
+    }
+    r->evicted += n;
+    return n;
+}
+
+/**
+ * @brief Slot of a message, or a free / least recently updated one for a new message.
+ */
+static FragSlot *frag_reasm_slot(FragReasm *r, const FrameFragment *f)
+{
+    FragSlot *free_slot = NULL;
+    FragSlot *oldest = NULL;
+    for (int i = 0; i < CONFIG_FRAME_REASM_SLOTS; i++) {
+        FragSlot *s = &r->slots[i];
+        if (!s->used) {
+            if (!free_slot) {
+                free_slot = s;
+            }
+            continue;
+        }
+        if (s->device_id == f->hdr.device_id && s->msg_id == f->msg_id) {
+            if (s->count == f->count && s->msg_len == f->msg_len) {
+                return s;
+            }
+            // Same ID for another message: the sender restarted, drop the old one
+            r->evicted++;
+            s->used = 0;
+            return s;
+        }
+        if (!oldest || (int32_t)(s->last_ms - oldest->last_ms) < 0) {
+            oldest = s;
+        }
+    }
+    if (free_slot) {
+        return free_slot;
+    }
+    r->evicted++;
+    oldest->used = 0;
+    return oldest;
+}
+
+int frag_reasm_push(FragReasm *r, const FrameFragment *f, uint32_t now_ms, const uint8_t **msg)
+{
+    if (f->msg_len > CONFIG_FRAME_REASM_MAX_LEN) {
+        r->rejected++;
+        return -1;
+    }
+    if (f->count == 1) {
+        // Nothing to reassemble
+        r->completed++;
+        *msg = f->data;
+        return f->msg_len;
+    }
+
+    frag_reasm_expire(r, now_ms);
+    FragSlot *s = frag_reasm_slot(r, f);
+    if (!s->used) {
+        s->used = 1;
+        s->device_id = f->hdr.device_id;
+        s->msg_id = f->msg_id;
+        s->count = f->count;
+        s->msg_len = f->msg_len;
+        s->received = 0;
+        s->have = 0;
+    }
+    s->last_ms = now_ms;
+
+    uint64_t bit = (uint64_t)1 << f->index;
+    if (s->have & bit) {
+        return 0;   // Duplicate
+    }
+    memcpy(s->data + f->index * frag_chunk(s->msg_len, s->count), f->data, f->data_len);
+    s->have |= bit;
+    if (++s->received < s->count) {
+        return 0;
+    }
+
+    // Complete: the slot is free again, its data stays until the next push
+    s->used = 0;
+    r->completed++;
+    *msg = s->data;
+    return s->msg_len;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file frame.c
+ * @brief Binary LoRa frame encoder and decoder.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "frame.h"
+#include "tscomp.h"
+
+/**
+ * @brief Scale a value to a fixed-point integer, rounded and clamped.
+ */
+static int32_t frame_scale(float value, float scale, int32_t min, int32_t max)
+{
+    if (!isfinite(value)) {
+        return 0;
+    }
+    float v = roundf(value * scale);
+    if (v < min) {
+        return min;
+    }
+    if (v > max) {
+        return max;
+    }
+    return (int32_t)v;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/**
+ * @brief Write the common header.
+ */
+static void frame_put_header(const FrameHeader *hdr, uint8_t *buf)
+{
+    buf[0] = (FRAME_VERSION << 4) | (hdr->type & 0x0f);
+    put_u16(buf + 1, hdr->device_id);
+    buf[3] = hdr->seq;
+}
+
+int frame_parse_header(const uint8_t *buf, size_t len, FrameHeader *hdr)
+{
+    if (len < FRAME_HEADER_LEN || (buf[0] >> 4) != FRAME_VERSION) {
+        return -1;
+    }
+    hdr->type = buf[0] & 0x0f;
+    hdr->device_id = get_u16(buf + 1);
+    hdr->seq = buf[3];
+    return 0;
+}
+
+void frame_quantize(const FrameMeasure *m, FrameSample *s)
+{
+    s->valid = m->valid & 0x0f;
+    s->q[0] = (s->valid & 0x1) ? frame_scale(m->temp, 100.0f, INT16_MIN, INT16_MAX) : 0;
+    s->q[1] = (s->valid & 0x2) ? frame_scale(m->press, 10.0f, 0, UINT16_MAX) : 0;
+    s->q[2] = (s->valid & 0x4) ? frame_scale(m->hum, 2.0f, 0, UINT8_MAX) : 0;
+    s->q[3] = (s->valid & 0x8) ? frame_scale(m->sound, 100.0f, 0, UINT16_MAX) : 0;
+}
+
+void frame_dequantize(const FrameSample *s, FrameMeasure *m)
+{
+    m->valid = s->valid;
+    m->temp = s->q[0] / 100.0f;
+    m->press = s->q[1] / 10.0f;
+    m->hum = s->q[2] / 2.0f;
+    m->sound = s->q[3] / 100.0f;
+}
+
+int frame_encode_ack(const FrameHeader *hdr, uint8_t *buf, size_t len)
+{
+    if (len < FRAME_ACK_LEN) {
+        return -1;
+    }
+    FrameHeader h = *hdr;
+    h.type = FRAME_TYPE_ACK;
+    frame_put_header(&h, buf);
+    return FRAME_ACK_LEN;
+}
+
+int frame_encode_measure(const FrameMeasure *m, uint8_t *buf, size_t len)
+{
+    if (len < FRAME_MEASURE_LEN) {
+        return -1;
+    }
+    FrameHeader hdr = m->hdr;
+    hdr.type = FRAME_TYPE_MEASURE;
+    frame_put_header(&hdr, buf);
+
+    FrameSample s;
+    frame_quantize(m, &s);
+    buf[4] = s.valid;
+    put_u16(buf + 5, (uint16_t)(int16_t)s.q[0]);
+    put_u16(buf + 7, (uint16_t)s.q[1]);
+    buf[9] = (uint8_t)s.q[2];
+    put_u16(buf + 10, (uint16_t)s.q[3]);
+    return FRAME_MEASURE_LEN;
+}
+
+int frame_decode_measure(const uint8_t *buf, size_t len, FrameMeasure *m)
+{
+    if (frame_parse_header(buf, len, &m->hdr) != 0 || m->hdr.type != FRAME_TYPE_MEASURE
+        || len < FRAME_MEASURE_LEN) {
+        return -1;
+    }
+    FrameSample s = {
+        .valid = buf[4] & 0x0f,
+        .q = { (int16_t)get_u16(buf + 5), get_u16(buf + 7), buf[9], get_u16(buf + 10) },
+    };
+    frame_dequantize(&s, m);
+    return 0;
+}
+
+int frame_encode_batch(const FrameHeader *hdr, uint16_t interval_s, const FrameSample *samples,
+                       int count, uint8_t *buf, size_t len, int *encoded)
+{
+    uint8_t body[FRAME_MAX_LEN];
+    TsWriter w = { .buf = body, .cap = sizeof(body) };
+    TsChannel ch[FRAME_CHANNELS] = { 0 };
+    int n = 0;
+
+    if (len > FRAME_MAX_LEN) {
+        len = FRAME_MAX_LEN;
+    }
+    if (count > FRAME_BATCH_MAX) {
+        count = FRAME_BATCH_MAX;
+    }
+    for (; n < count; n++) {
+        // Encode on copies, commit only if the whole sample still fits
+        TsChannel next[FRAME_CHANNELS];
+        memcpy(next, ch, sizeof(ch));
+        TsWriter sw = w;
+        int ok = 1;
+        for (int c = 0; c < FRAME_CHANNELS && ok; c++) {
+            int32_t v = (samples[n].valid & (1 << c)) ? samples[n].q[c] : ts_predict(&next[c]);
+            ok = ts_encode(&next[c], &sw, v) == 0;
+        }
+        if (!ok || FRAME_BATCH_HEADER_LEN + (n + 2) / 2 + sw.len > len) {
+            break;
+        }
+        memcpy(ch, next, sizeof(ch));
+        w = sw;
+    }
+    *encoded = n;
+    if (n == 0) {
+        return -1;
+    }
+
+    FrameHeader h = *hdr;
+    h.type = FRAME_TYPE_BATCH;
+    frame_put_header(&h, buf);
+    buf[4] = (uint8_t)n;
+    put_u16(buf + 5, interval_s);
+    size_t pos = FRAME_BATCH_HEADER_LEN;
+    memset(buf + pos, 0, (n + 1) / 2);
+    for (int i = 0; i < n; i++) {
+        buf[pos + i / 2] |= (samples[i].valid & 0x0f) << ((i & 1) * 4);
+    }
+    pos += (n + 1) / 2;
+    memcpy(buf + pos, body, w.len);
+    return (int)(pos + w.len);
+}
+
+int frame_decode_batch(const uint8_t *buf, size_t len, FrameHeader *hdr, uint16_t *interval_s,
+                       FrameSample *samples, int max)
+{
+    if (frame_parse_header(buf, len, hdr) != 0 || hdr->type != FRAME_TYPE_BATCH
+        || len < FRAME_BATCH_HEADER_LEN) {
+        return -1;
+    }
+    int n = buf[4];
+    *interval_s = get_u16(buf + 5);
+    size_t pos = FRAME_BATCH_HEADER_LEN;
+    if (n > max || pos + (n + 1) / 2 > len) {
+        return -1;
+    }
+
+    TsReader r = { .buf = buf, .len = len, .pos = pos + (n + 1) / 2 };
+    TsChannel ch[FRAME_CHANNELS] = { 0 };
+    for (int i = 0; i < n; i++) {
+        samples[i].valid = (buf[pos + i / 2] >> ((i & 1) * 4)) & 0x0f;
+        for (int c = 0; c < FRAME_CHANNELS; c++) {
+            int32_t v;
+            if (ts_decode(&ch[c], &r, &v) != 0) {
+                return -1;
+            }
+            samples[i].q[c] = (samples[i].valid & (1 << c)) ? v : 0;
+        }
+    }
+    return n;
+}
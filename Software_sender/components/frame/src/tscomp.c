@@ -0,0 +1,68 @@
+/**
+ * @file tscomp.c
+ * @brief Delta-of-delta / zig-zag varint codec.
+ */
+
+#include "tscomp.h"
+
+int ts_put_varint(TsWriter *w, uint32_t v)
+{
+    uint8_t tmp[5];
+    size_t n = 0;
+    do {
+        tmp[n] = v & 0x7f;
+        v >>= 7;
+        if (v) {
+            tmp[n] |= 0x80;
+        }
+        n++;
+    } while (v);
+
+    if (w->len + n > w->cap) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        w->buf[w->len++] = tmp[i];
+    }
+    return 0;
+}
+
+int ts_get_varint(TsReader *r, uint32_t *v)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (r->pos >= r->len) {
+            return -1;
+        }
+        uint8_t b = r->buf[r->pos++];
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int ts_encode(TsChannel *c, TsWriter *w, int32_t value)
+{
+    int32_t delta = value - c->prev;
+    if (ts_put_varint(w, ts_zigzag(delta - c->delta)) != 0) {
+        return -1;
+    }
+    c->prev = value;
+    c->delta = delta;
+    return 0;
+}
+
+int ts_decode(TsChannel *c, TsReader *r, int32_t *value)
+{
+    uint32_t u;
+    if (ts_get_varint(r, &u) != 0) {
+        return -1;
+    }
+    c->delta += ts_unzigzag(u);
+    c->prev += c->delta;
+    *value = c->prev;
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef ADR_H
+#define ADR_H
+
+#include <stdint.h>
+#include "downlink.h"
+#include "link.h"
+
+/**
+ * @file adr.h
+ * @brief Adaptive data rate on the receiver: spreading factor and TX power
+ * per sender from the SNR of its frames.
+ *
+ * The receiver keeps the best SNR of the last frames of each sender. After
+ * a number of frames it compares it with the demodulation floor of the
+ * spreading factor in use, plus an installation margin. Every 3 dB of
+ * margin lowers the spreading factor one step, down to the lowest one
+ * allowed, then the TX power by 3 dB. A negative margin raises the TX
+ * power, then the spreading factor. The new settings go to the sender as
+ * downlink commands (downlink.h).
+ *
+ * The receiver never learns which settings a sender applied, so it assumes
+ * its last commands were. The sender undoes settings that lose the
+ * receiver by itself (node_config.h), raising its TX power. A gap in the
+ * sequence numbers is the receiver's only sign of it, so after one it
+ * assumes the highest TX power and starts a fresh history: commands are
+ * absolute, and a power overestimate only makes the next one too high.
+ */
+
+/**
+ * @brief Tuning of the ADR decision.
+ */
+typedef struct {
+    uint8_t history;     ///< Frames per decision
+    float margin_db;     ///< Installation margin kept above the demodulation floor
+    uint8_t sf_min;      ///< Lowest spreading factor the receiver can hear
+    uint8_t sf_max;      ///< Highest spreading factor the receiver can hear
+} AdrParams;
+
+/**
+ * @brief ADR state of one sender.
+ */
+typedef struct {
+    uint8_t used;
+    uint16_t device_id;
+    uint8_t sf;          ///< Spreading factor assumed in use
+    uint8_t tx_power;    ///< TX power assumed in use, dBm
+    uint8_t count;       ///< Frames since the last decision
+    uint8_t seq;         ///< Sequence number of the last frame
+    float snr_max;       ///< Best SNR since the last decision
+} AdrPeer;
+
+/**
+ * @brief ADR state of every sender.
+ */
+typedef struct {
+    AdrPeer peers[LINK_MAX_PEERS];
+} AdrPeers;
+
+/**
+ * @brief Demodulation floor of a spreading factor (SX1276 datasheet).
+ * @param sf Spreading factor (6-12).
+ * @return Lowest SNR that can be received, dB.
+ */
+float adr_required_snr(int sf);
+
+/**
+ * @brief Settings that keep the margin, from the best SNR seen.
+ * @param snr_max Best SNR with the current settings.
+ * @param p Tuning.
+ * @param sf Spreading factor in use, updated.
+ * @param tx_power TX power in use, updated.
+ * @return 1 if the settings changed, 0 otherwise.
+ */
+int adr_decide(float snr_max, const AdrParams *p, uint8_t *sf, uint8_t *tx_power);
+
+/**
+ * @brief Account for a received frame and decide when enough were seen.
+ *
+ * A new sender, or one whose frames were lost, is assumed to use
+ * @p sf_heard and the highest TX power.
+ *
+ * @param t ADR state.
+ * @param device_id Sender.
+ * @param seq Sequence number of the frame.
+ * @param snr SNR of the frame.
+ * @param sf_heard Spreading factor the frame was received with.
+ * @param p Tuning.
+ * @param out Commands to send, when 1 is returned.
+ * @return 1 if the sender should change its settings, 0 otherwise.
+ */
+int adr_update(AdrPeers *t, uint16_t device_id, uint8_t seq, float snr, uint8_t sf_heard,
+               const AdrParams *p, DownlinkConfig *out);
+
+/**
+ * @brief Record radio commands sent to a sender by other means (API).
+ * The history is dropped, it was measured with the former settings.
+ * @param t ADR state.
+ * @param device_id Sender.
+ * @param c Commands queued for it.
+ */
+void adr_note_downlink(AdrPeers *t, uint16_t device_id, const DownlinkConfig *c);
+
+#endif // ADR_H
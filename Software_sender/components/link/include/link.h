@@ -0,0 +1,215 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "frame.h"
+#include "downlink.h"
+#include "beacon.h"
+#include "bulk.h"
+
+/**
+ * @file link.h
+ * @brief Acknowledged frame delivery and delivery counters.
+ *
+ * Each sender numbers its frames with the header sequence number. The
+ * receiver answers every frame with an ACK frame carrying the same device ID
+ * and sequence number. After each transmission the sender listens
+ * CONFIG_LINK_ACK_TIMEOUT_MS for it and sends the same packet again, up to
+ * CONFIG_LINK_ACK_RETRIES times. A retransmission keeps its sequence number,
+ * so the receiver acknowledges it again without forwarding it twice.
+ *
+ * When configuration commands are queued for a sender (link_queue_downlink()),
+ * the receiver sends them in place of its next CONFIG_LINK_DOWNLINK_REPEAT
+ * ACKs to that sender (downlink.h). The sender takes them as ACKs and keeps
+ * the commands for link_take_downlink(). Repeating them covers a lost
+ * downlink without any confirmation on the uplink; applying the same
+ * commands twice has no effect.
+ *
+ * Fragments are acknowledged one by one, so only the missing fragments of a
+ * message are sent again.
+ *
+ * With CONFIG_FEC_ENABLE, link_send() also adds each frame to a group of
+ * CONFIG_FEC_K frames and sends CONFIG_FEC_M repair frames after the group
+ * (fec.h), so the receiver can rebuild lost frames without any ACK.
+ *
+ * With CONFIG_TDMA_ENABLE the receiver sends beacons and each sender keeps
+ * to its slot (tdma.h). Beacons go on the first channel of the plan.
+ *
+ * With CONFIG_LINK_BULK_ENABLE a sender sends the frames it could not
+ * deliver in one FSK burst once the receiver answers again (bulk.h). The
+ * request and its answer go over LoRa, the burst is stop-and-wait: each
+ * frame is acknowledged and retried as with link_send().
+ */
+
+#define LINK_MAX_PEERS   8    ///< Senders tracked by the receiver
+#define LINK_LATE_WINDOW 32   ///< Sequence numbers behind the last one accepted as late frames
+#define LINK_REFUSED     -1   ///< link_send(): refused by the duty-cycle budget, not sent
+
+/**
+ * @brief Sender counters, kept across deep sleep.
+ */
+typedef struct {
+    uint32_t sent;       ///< Frames sent with an ACK expected (retransmissions not counted)
+    uint32_t acked;      ///< Frames acknowledged
+    uint32_t attempts;   ///< Transmissions, retransmissions included
+    uint32_t repairs;    ///< FEC repair frames sent
+    uint32_t refused;    ///< Frames refused by the duty-cycle budget (repair frames not counted)
+} LinkTxStats;
+
+/**
+ * @brief Receiver counters of one sender.
+ */
+typedef struct {
+    uint8_t used;
+    uint8_t last_seq;      ///< Last sequence number received
+    uint16_t device_id;
+    uint32_t received;     ///< Distinct frames received
+    uint32_t missed;       ///< Sequence numbers never received
+    uint32_t duplicates;   ///< Retransmissions already received
+} LinkPeer;
+
+/**
+ * @brief Receiver counters per sender.
+ */
+typedef struct {
+    LinkPeer peers[LINK_MAX_PEERS];
+} LinkPeers;
+
+/**
+ * @brief Send a packet and wait for its acknowledgement.
+ *
+ * Packets that are not frames (JSON) are sent once, without waiting.
+ * Without CONFIG_LINK_ACK_ENABLE, frames are sent with
+ * lora_send_packet_async() and the call returns while they are on air.
+ *
+ * When lora_send_packet() refuses a transmission, the call stops at once:
+ * no ACK window, no retry. The frame is then not counted in sent, a limit
+ * of our own is not a lost link.
+ *
+ * @param pkt Frame to send, its header gives the sequence number to acknowledge.
+ * @param len Packet length.
+ * @return 1 if acknowledged, 0 otherwise, LINK_REFUSED if not sent.
+ */
+int link_send(uint8_t *pkt, int len);
+
+/**
+ * @brief Acknowledge a received frame.
+ * @param hdr Header of the received frame.
+ */
+void link_send_ack(const FrameHeader *hdr);
+
+/**
+ * @brief Send a TDMA beacon (receiver).
+ * @param device_id Receiver ID.
+ * @param seq Beacon counter.
+ * @param s Slot layout.
+ */
+void link_send_beacon(uint16_t device_id, uint8_t seq, const BeaconSchedule *s);
+
+/**
+ * @brief Listen for a TDMA beacon (sender).
+ * @param timeout_ms Receive window.
+ * @param s Output slot layout.
+ * @param start_us Output start of the beacon on the esp_timer clock, RxDone
+ *        less its time on air.
+ * @return 1 if a beacon came, 0 otherwise.
+ */
+int link_wait_beacon(int timeout_ms, BeaconSchedule *s, int64_t *start_us);
+
+/**
+ * @brief Ask the receiver for a bulk transfer and switch to FSK (sender).
+ * @param device_id Sender ID.
+ * @param seq Frame sequence counter, the request takes one number.
+ * @param frames Frames to send.
+ * @return Frames granted, the radio is then in FSK. 0 if refused or
+ *         unanswered, the radio stays in LoRa.
+ */
+int link_bulk_begin(uint16_t device_id, uint8_t *seq, int frames);
+
+/**
+ * @brief Send one frame of a bulk transfer and wait for its acknowledgement.
+ * @param frame Frame, carried with its own device ID and sequence number.
+ * @param len Frame length, at most BULK_DATA_MAX.
+ * @param age_s Age of the last sample of the frame.
+ * @return 1 if acknowledged, 0 otherwise.
+ */
+int link_bulk_send(const uint8_t *frame, int len, uint32_t age_s);
+
+/**
+ * @brief End a bulk transfer and switch back to LoRa (sender).
+ * @param device_id Sender ID.
+ * @param seq Frame sequence counter, the end takes one number.
+ */
+void link_bulk_end(uint16_t device_id, uint8_t *seq);
+
+/**
+ * @brief Answer a bulk transfer request (receiver).
+ * @param hdr Header of the request.
+ * @param granted Frames granted, 0 to refuse.
+ */
+void link_send_bulk_accept(const FrameHeader *hdr, uint8_t granted);
+
+/**
+ * @brief Queue configuration commands for a sender.
+ *
+ * Commands already queued for the same sender and not in @p c are kept.
+ *
+ * @param device_id Sender.
+ * @param c Commands, checked with downlink_validate().
+ * @return 0 on success, -1 on invalid commands or when LINK_MAX_PEERS other
+ *         senders already have commands queued.
+ */
+int link_queue_downlink(uint16_t device_id, const DownlinkConfig *c);
+
+/**
+ * @brief Take the commands received with an ACK since the last call.
+ * @param c Output commands.
+ * @return 1 if commands were received, 0 otherwise.
+ */
+int link_take_downlink(DownlinkConfig *c);
+
+/**
+ * @brief Sender counters since the last power-on.
+ * @return Counters.
+ */
+const LinkTxStats *link_tx_stats(void);
+
+/**
+ * @brief Account for a received frame in the counters of its sender.
+ *
+ * The sequence number following the last one is a new frame, a jump of less
+ * than 128 counts the skipped numbers as missed, and the last sequence
+ * number again is a retransmission. Up to LINK_LATE_WINDOW numbers behind
+ * is a late frame (rebuilt by FEC) that was counted as missed. Anything
+ * else is taken as a sender restart.
+ *
+ * @param t Counters.
+ * @param device_id Sender.
+ * @param seq Sequence number of the frame.
+ * @return 1 for a new frame, 0 for a retransmission.
+ */
+int link_track(LinkPeers *t, uint16_t device_id, uint8_t seq);
+
+/**
+ * @brief Delivery ratio of one sender seen by the receiver.
+ * @param p Sender counters.
+ * @return Received / (received + missed), 1 before any frame.
+ */
+static inline float link_peer_ratio(const LinkPeer *p)
+{
+    uint32_t total = p->received + p->missed;
+    return total ? (float)p->received / total : 1.0f;
+}
+
+/**
+ * @brief Delivery ratio seen by the sender.
+ * @param s Sender counters.
+ * @return Acked / sent, 1 before any frame.
+ */
+static inline float link_tx_ratio(const LinkTxStats *s)
+{
+    return s->sent ? (float)s->acked / s->sent : 1.0f;
+}
+
+#endif // LINK_H
@@ -0,0 +1,94 @@
+/**
+ * @file tdma.c
+ * @brief Beacon tracking and slot times of the TDMA schedule.
+ */
+
+#include "tdma.h"
+
+#define TDMA_SEARCH_BACKOFF_MAX 32   ///< Cycles between searches when no beacon comes
+
+/**
+ * @brief Duration on the sender's clock of a duration on the receiver's.
+ */
+static int64_t tdma_local_us(const TdmaSync *t, int64_t us)
+{
+    return us + us * t->drift_ppm / 1000000;
+}
+
+int64_t tdma_heard(TdmaSync *t, const BeaconSchedule *s, int64_t beacon_us, const TdmaParams *p)
+{
+    int64_t error = 0;
+    const int64_t period = s->period_s * 1000000LL;
+    if (t->synced && t->sched.period_s == s->period_s && beacon_us > t->heard_us) {
+        int64_t elapsed = beacon_us - t->heard_us;
+        int64_t periods = (elapsed + period / 2) / period;
+        if (periods > 0) {
+            error = beacon_us - (t->heard_us + tdma_local_us(t, periods * period));
+            // A beacon sent late (duty cycle, busy channel) is not drift: keep the estimate
+            int64_t ppm = error * 1000000 / (periods * period);
+            if (ppm <= 2 * p->drift_ppm && ppm >= -2 * p->drift_ppm) {
+                t->drift_ppm += ppm / 2;
+            }
+        }
+    }
+    t->sched = *s;
+    t->heard_us = beacon_us;
+    t->anchor_us = beacon_us;
+    t->synced = 1;
+    t->missed = 0;
+    t->search_skip = 0;
+    t->search_backoff = 0;
+    return error;
+}
+
+int tdma_missed(TdmaSync *t, int64_t predicted_us, const TdmaParams *p)
+{
+    t->anchor_us = predicted_us;
+    if (++t->missed > p->max_missed) {
+        t->synced = 0;
+        t->drift_ppm = 0;
+    }
+    return t->synced;
+}
+
+int64_t tdma_beacon_after(const TdmaSync *t, int64_t after_us)
+{
+    const int64_t period = tdma_local_us(t, t->sched.period_s * 1000000LL);
+    if (after_us <= t->heard_us) {
+        return t->heard_us;
+    }
+    int64_t periods = (after_us - t->heard_us + period - 1) / period;
+    // From the beacon heard, rounding errors do not add up over the periods
+    return t->heard_us + tdma_local_us(t, periods * t->sched.period_s * 1000000LL);
+}
+
+int64_t tdma_guard_us(const TdmaSync *t, int64_t beacon_us, const TdmaParams *p)
+{
+    int64_t since = beacon_us > t->heard_us ? beacon_us - t->heard_us : 0;
+    return p->guard_ms * 1000LL + since * p->drift_ppm / 1000000;
+}
+
+int64_t tdma_slot_us(const TdmaSync *t, uint16_t device_id)
+{
+    // Slot 0 of the period is the beacon's
+    int64_t offset = (tdma_slot_of(&t->sched, device_id) + 1) * (int64_t)t->sched.slot_ms * 1000;
+    return t->anchor_us + tdma_local_us(t, offset);
+}
+
+int tdma_search_due(TdmaSync *t)
+{
+    if (t->search_skip > 0) {
+        t->search_skip--;
+        return 0;
+    }
+    return 1;
+}
+
+void tdma_search_failed(TdmaSync *t)
+{
+    t->search_backoff = t->search_backoff ? t->search_backoff * 2 : 1;
+    if (t->search_backoff > TDMA_SEARCH_BACKOFF_MAX) {
+        t->search_backoff = TDMA_SEARCH_BACKOFF_MAX;
+    }
+    t->search_skip = t->search_backoff;
+}
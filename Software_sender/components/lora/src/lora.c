@@ -7,12 +7,21 @@
  */
 
 #include <string.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "esp_log.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "lora.h"
+#include "lora_airtime.h"
+#include "trace.h"
+#include "binlog.h"
 
 /*
  * Register definitions
@@ -34,6 +43,7 @@
 #define REG_PKT_RSSI_VALUE             0x1a
 #define REG_MODEM_CONFIG_1             0x1d
 #define REG_MODEM_CONFIG_2             0x1e
+#define REG_SYMB_TIMEOUT_LSB           0x1f
 #define REG_PREAMBLE_MSB               0x20
 #define REG_PREAMBLE_LSB               0x21
 #define REG_PAYLOAD_LENGTH             0x22
@@ -46,6 +56,29 @@
 #define REG_DIO_MAPPING_2              0x41
 #define REG_VERSION                    0x42
 
+/*
+ * FSK mode registers, where they differ from the LoRa ones
+ */
+#define REG_BITRATE_MSB                0x02
+#define REG_BITRATE_LSB                0x03
+#define REG_FDEV_MSB                   0x04
+#define REG_FDEV_LSB                   0x05
+#define REG_RX_CONFIG                  0x0d
+#define REG_RSSI_VALUE                 0x11
+#define REG_RX_BW                      0x12
+#define REG_AFC_BW                     0x13
+#define REG_PREAMBLE_DETECT            0x1f
+#define REG_FSK_PREAMBLE_MSB           0x25
+#define REG_FSK_PREAMBLE_LSB           0x26
+#define REG_SYNC_CONFIG                0x27
+#define REG_SYNC_VALUE_1               0x28
+#define REG_PACKET_CONFIG_1            0x30
+#define REG_PACKET_CONFIG_2            0x31
+#define REG_FSK_PAYLOAD_LENGTH         0x32
+#define REG_FIFO_THRESH                0x35
+#define REG_IRQ_FLAGS_1                0x3e
+#define REG_IRQ_FLAGS_2                0x3f
+
 /*
  * Transceiver modes
  */
@@ -55,6 +88,7 @@
 #define MODE_TX                        0x03
 #define MODE_RX_CONTINUOUS             0x05
 #define MODE_RX_SINGLE                 0x06
+#define MODE_CAD                       0x07
 
 /*
  * PA configuration
@@ -64,9 +98,30 @@
 /*
  * IRQ masks
  */
+#define IRQ_CAD_DETECTED_MASK          0x01
+#define IRQ_CAD_DONE_MASK              0x04
 #define IRQ_TX_DONE_MASK               0x08
 #define IRQ_PAYLOAD_CRC_ERROR_MASK     0x20
 #define IRQ_RX_DONE_MASK               0x40
+#define IRQ_RX_TIMEOUT_MASK            0x80
+
+/*
+ * FSK IRQ masks (REG_IRQ_FLAGS_1, REG_IRQ_FLAGS_2)
+ */
+#define IRQ1_PREAMBLE_DETECT           0x02
+#define IRQ1_SYNC_ADDRESS_MATCH        0x01
+#define IRQ2_FIFO_EMPTY                0x40
+#define IRQ2_FIFO_LEVEL                0x20
+#define IRQ2_FIFO_OVERRUN              0x10
+#define IRQ2_PACKET_SENT               0x08
+#define IRQ2_PAYLOAD_READY             0x04
+
+/*
+ * DIO0 function (REG_DIO_MAPPING_1 bits 7-6)
+ */
+#define DIO0_RX_DONE                   0x00
+#define DIO0_TX_DONE                   0x40
+#define DIO0_CAD_DONE                  0x80
 
 #define PA_OUTPUT_RFO_PIN              0
 #define PA_OUTPUT_PA_BOOST_PIN         1
@@ -84,20 +139,153 @@
 #define TAG "LORA"
 
 static spi_device_handle_t _spi;
-static int _implicit;
-static long _frequency;
 static int _send_packet_lost = 0;
-static int _cr = 0;
+static int _send_packet_refused = 0;
+static RTC_DATA_ATTR LoraLbtStats _lbt;
+static LoraSniffStats _sniff;
 static int _sbw = 0;
-static int _sf = 0;
 
-// use spi_device_transmit
-#define SPI_TRANSMIT 1
+#if CONFIG_LORA_DIO0_IRQ
+// Task blocked in lora_dio0_wait(), notified by the DIO0 interrupt
+static TaskHandle_t volatile _dio0_waiter = NULL;
+static volatile int64_t _dio0_us;   // Time of the last DIO0 edge
+
+/**
+ * @brief DIO0 rising edge: TxDone or RxDone, as mapped in REG_DIO_MAPPING_1.
+ */
+static void IRAM_ATTR
+lora_dio0_isr(void *arg)
+{
+   BaseType_t woken = pdFALSE;
+   _dio0_us = esp_timer_get_time();
+   TaskHandle_t waiter = _dio0_waiter;
+   if (waiter != NULL) {
+      vTaskNotifyGiveFromISR(waiter, &woken);
+   }
+   portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Register the calling task for the next DIO0 edge.
+ * Must be called before the operation that raises DIO0 is started.
+ */
+static void
+lora_dio0_arm(void)
+{
+   _dio0_waiter = xTaskGetCurrentTaskHandle();
+   ulTaskNotifyTake(pdTRUE, 0);   // Drop a stale notification
+}
+
+/**
+ * @brief Block until DIO0 is high or the timeout expires.
+ * @param ticks Timeout in ticks.
+ * @return 1 if DIO0 is high.
+ */
+static int
+lora_dio0_wait(TickType_t ticks)
+{
+   // The edge may have come before lora_dio0_arm(), the level stays until the flags are cleared
+   if (!gpio_get_level(CONFIG_DIO0_GPIO)) {
+      ulTaskNotifyTake(pdTRUE, ticks);
+   }
+   _dio0_waiter = NULL;
+   return gpio_get_level(CONFIG_DIO0_GPIO);
+}
+#endif
 
 // use buffer io
 // A little faster
 #define BUFFER_IO 1
 
+#define LORA_FIFO_SIZE                 256
+#define LORA_SPI_QUEUE_SIZE            7    ///< Transactions in flight, also the device queue size
+
+/*
+ * DMA-capable transfer buffers, shared by every FIFO access. The driver is
+ * used from one task at a time, so one pair is enough and no transfer
+ * allocates from the heap.
+ */
+static DMA_ATTR uint8_t _spi_tx[LORA_FIFO_SIZE + 1];
+static DMA_ATTR uint8_t _spi_rx[LORA_FIFO_SIZE + 1];
+
+// Transactions of lora_write_reg_seq(), owned by the SPI driver until their result is fetched
+static spi_transaction_t _spi_seq[LORA_SPI_QUEUE_SIZE];
+
+/*
+ * Shadow of the configuration registers
+ */
+#define SHADOW_REGS ((1ULL << REG_FRF_MSB) | (1ULL << REG_FRF_MID) | (1ULL << REG_FRF_LSB) \
+                     | (1ULL << REG_PA_CONFIG) | (1ULL << REG_LNA) \
+                     | (1ULL << REG_FIFO_TX_BASE_ADDR) | (1ULL << REG_FIFO_RX_BASE_ADDR) \
+                     | (1ULL << REG_MODEM_CONFIG_1) | (1ULL << REG_MODEM_CONFIG_2) \
+                     | (1ULL << REG_SYMB_TIMEOUT_LSB) \
+                     | (1ULL << REG_PREAMBLE_MSB) | (1ULL << REG_PREAMBLE_LSB) \
+                     | (1ULL << REG_PAYLOAD_LENGTH) | (1ULL << REG_MODEM_CONFIG_3) \
+                     | (1ULL << REG_DETECTION_OPTIMIZE) | (1ULL << REG_DETECTION_THRESHOLD) \
+                     | (1ULL << REG_SYNC_WORD))
+#define SHADOW_MAGIC 0x5348
+#define SHADOW(reg)  (_shadow.val[reg])
+
+/*
+ * Last value written to each configuration register, indexed by address.
+ * Setters compare against it and getters read it, so neither needs an SPI
+ * read. It lives in RTC memory: lora_init() resets the radio, and after deep
+ * sleep it writes the whole shadow back instead of starting from defaults.
+ */
+typedef struct {
+   uint16_t magic;                   ///< SHADOW_MAGIC once loaded from the radio
+   long frequency;                   ///< Carrier frequency in Hz
+   uint8_t val[REG_SYNC_WORD + 1];
+} LoraShadow;
+
+static RTC_DATA_ATTR LoraShadow _shadow;
+static uint64_t _dirty;    // Shadow registers not written to the radio yet
+static int _deferred;      // lora_config_begin() nesting depth
+static int _modem = LORA_MODEM_LORA;
+
+// FSK packet read by lora_wait_received(), returned by lora_receive_packet()
+static uint8_t _fsk_rx[LORA_FIFO_SIZE];
+static int _fsk_rx_len;
+static int _fsk_rssi;
+static int _fsk_preamble;   // Preamble length in bytes, set with the FSK settings
+
+/*
+ * Only LoRa settings are shadowed. FSK registers share the same addresses,
+ * so in FSK the shadow is left alone and written back by lora_set_modem().
+ */
+static inline int
+lora_shadowed(int reg)
+{
+   return _modem == LORA_MODEM_LORA && reg <= REG_SYNC_WORD && ((SHADOW_REGS >> reg) & 1);
+}
+
+/**
+ * @brief RegOpMode value of a mode in the current modem.
+ */
+static inline int
+lora_op_mode(int mode)
+{
+   return (_modem == LORA_MODEM_LORA ? MODE_LONG_RANGE_MODE : 0) | mode;
+}
+
+/**
+ * @brief Set a configuration register through the shadow.
+ * Nothing is sent if the value is unchanged; inside lora_config_begin() /
+ * lora_config_commit(), or in FSK, the register is only marked dirty.
+ * @param reg Register index, one of SHADOW_REGS.
+ * @param val Value to write.
+ */
+static void
+lora_shadow_write(int reg, int val)
+{
+   if (SHADOW(reg) == (uint8_t)val) return;
+   if (_deferred || _modem != LORA_MODEM_LORA) {
+      SHADOW(reg) = val;
+      _dirty |= 1ULL << reg;
+   } else {
+      lora_write_reg(reg, val);
+   }
+}
 
 /**
  * @brief Write a value to a LoRa register.
@@ -107,56 +295,104 @@ static int _sf = 0;
 void 
 lora_write_reg(int reg, int val)
 {
-   uint8_t out[2] = { 0x80 | reg, val };
-   uint8_t in[2];
-
+   // Two bytes fit in the transaction itself, no buffer to set up
    spi_transaction_t t = {
-      .flags = 0,
-      .length = 8 * sizeof(out),
-      .tx_buffer = out,
-      .rx_buffer = in  
+      .flags = SPI_TRANS_USE_TXDATA,
+      .length = 16,
+      .tx_data = { 0x80 | reg, val },
    };
 
-   //gpio_set_level(CONFIG_CS_GPIO, 0);
-#if SPI_TRANSMIT
-   spi_device_transmit(_spi, &t);
-#else
    spi_device_polling_transmit(_spi, &t);
-#endif
-   //gpio_set_level(CONFIG_CS_GPIO, 1);
+   if (lora_shadowed(reg)) {
+      SHADOW(reg) = val;
+      _dirty &= ~(1ULL << reg);
+   }
+}
+
+/**
+ * @brief Write a sequence of registers with queued transactions.
+ * The transfers are pipelined by the SPI driver; the function returns
+ * once they are all done, so polling transfers may follow.
+ * @param seq Registers and values, written in order.
+ * @param n Number of entries.
+ */
+void
+lora_write_reg_seq(const LoraRegWrite *seq, int n)
+{
+   while (n > 0) {
+      int batch = n < LORA_SPI_QUEUE_SIZE ? n : LORA_SPI_QUEUE_SIZE;
+      for (int i = 0; i < batch; i++) {
+         _spi_seq[i] = (spi_transaction_t){
+            .flags = SPI_TRANS_USE_TXDATA,
+            .length = 16,
+            .tx_data = { 0x80 | seq[i].reg, seq[i].val },
+         };
+         spi_device_queue_trans(_spi, &_spi_seq[i], portMAX_DELAY);
+         if (lora_shadowed(seq[i].reg)) {
+            SHADOW(seq[i].reg) = seq[i].val;
+            _dirty &= ~(1ULL << seq[i].reg);
+         }
+      }
+      for (int i = 0; i < batch; i++) {
+         spi_transaction_t *done;
+         spi_device_get_trans_result(_spi, &done, portMAX_DELAY);
+      }
+      seq += batch;
+      n -= batch;
+   }
+}
+
+/**
+ * @brief Defer the setters' register writes until lora_config_commit().
+ * Calls may nest, the outermost commit writes.
+ */
+void
+lora_config_begin(void)
+{
+   _deferred++;
+}
+
+/**
+ * @brief Write the registers changed since lora_config_begin() in one
+ * queued sequence.
+ */
+void
+lora_config_commit(void)
+{
+   if (_deferred > 0 && --_deferred > 0) return;
+   if (_modem != LORA_MODEM_LORA) return;   // Written when back in LoRa
+
+   LoraRegWrite seq[REG_SYNC_WORD + 1];
+   int n = 0;
+   for (int reg = 0; reg <= REG_SYNC_WORD; reg++) {
+      if (_dirty & (1ULL << reg)) {
+         seq[n++] = (LoraRegWrite){ reg, SHADOW(reg) };
+      }
+   }
+   lora_write_reg_seq(seq, n);
 }
 
 /**
  * @brief Write a buffer to a LoRa register.
  * @param reg Register index.
  * @param val Buffer to write.
- * @param len Number of bytes to write.
+ * @param len Number of bytes to write (at most the 256-byte FIFO).
  */
 void
 lora_write_reg_buffer(int reg, uint8_t *val, int len)
 {
-   uint8_t *out;
-   out = (uint8_t *)malloc(len+1);
-   out[0] = 0x80 | reg;
-   for (int i=0;i<len;i++) {
-      out[i+1] = val[i];
-   }
+   if (len > LORA_FIFO_SIZE) len = LORA_FIFO_SIZE;
+   _spi_tx[0] = 0x80 | reg;
+   memcpy(&_spi_tx[1], val, len);
 
    spi_transaction_t t = {
       .flags = 0,
       .length = 8 * (len+1),
-      .tx_buffer = out,
+      .tx_buffer = _spi_tx,
       .rx_buffer = NULL
    };
 
-   //gpio_set_level(CONFIG_CS_GPIO, 0);
-#if SPI_TRANSMIT
-   spi_device_transmit(_spi, &t);
-#else
    spi_device_polling_transmit(_spi, &t);
-#endif
-   //gpio_set_level(CONFIG_CS_GPIO, 1);
-   free(out);
 }
 
 /**
@@ -167,63 +403,38 @@ lora_write_reg_buffer(int reg, uint8_t *val, int len)
 int
 lora_read_reg(int reg)
 {
-   uint8_t out[2] = { reg, 0xff };
-   uint8_t in[2];
-
    spi_transaction_t t = {
-      .flags = 0,
-      .length = 8 * sizeof(out),
-      .tx_buffer = out,
-      .rx_buffer = in
+      .flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA,
+      .length = 16,
+      .tx_data = { reg, 0xff },
    };
 
-   //gpio_set_level(CONFIG_CS_GPIO, 0);
-#if SPI_TRANSMIT
-   spi_device_transmit(_spi, &t);
-#else
    spi_device_polling_transmit(_spi, &t);
-#endif
-   //gpio_set_level(CONFIG_CS_GPIO, 1);
-   return in[1];
+   return t.rx_data[1];
 }
 
 /**
  * @brief Read a buffer from a LoRa register.
  * @param reg Register index.
  * @param val Buffer to store read data.
- * @param len Number of bytes to read.
+ * @param len Number of bytes to read (at most the 256-byte FIFO).
  */
 void
 lora_read_reg_buffer(int reg, uint8_t *val, int len)
 {
-   uint8_t *out;
-   uint8_t *in;
-   out = (uint8_t *)malloc(len+1);
-   in = (uint8_t *)malloc(len+1);
-   out[0] = reg;
-   for (int i=0;i<len;i++) {
-      out[i+1] = 0xff;
-   }
+   if (len > LORA_FIFO_SIZE) len = LORA_FIFO_SIZE;
+   _spi_tx[0] = reg;
+   memset(&_spi_tx[1], 0xff, len);
 
    spi_transaction_t t = {
       .flags = 0,
       .length = 8 * (len+1),
-      .tx_buffer = out,
-      .rx_buffer = in
+      .tx_buffer = _spi_tx,
+      .rx_buffer = _spi_rx
    };
 
-   //gpio_set_level(CONFIG_CS_GPIO, 0);
-#if SPI_TRANSMIT
-   spi_device_transmit(_spi, &t);
-#else
    spi_device_polling_transmit(_spi, &t);
-#endif
-   //gpio_set_level(CONFIG_CS_GPIO, 1);
-   for (int i=0;i<len;i++) {
-      val[i] = in[i+1];
-   }
-   free(out);
-   free(in);
+   memcpy(val, &_spi_rx[1], len);
 }
 
 /**
@@ -245,7 +456,8 @@ lora_reset(void)
 void 
 lora_idle(void)
 {
-   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+   lora_send_wait(-1, NULL);
+   lora_write_reg(REG_OP_MODE, lora_op_mode(MODE_STDBY));
 }
 
 /**
@@ -255,7 +467,8 @@ lora_idle(void)
 void 
 lora_sleep(void)
 { 
-   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_SLEEP);
+   lora_send_wait(-1, NULL);
+   lora_write_reg(REG_OP_MODE, lora_op_mode(MODE_SLEEP));
 }
 
 /**
@@ -265,7 +478,15 @@ lora_sleep(void)
 void 
 lora_receive(void)
 {
-   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_CONTINUOUS);
+   lora_send_wait(-1, NULL);
+   if (_modem == LORA_MODEM_FSK) {
+      _fsk_rx_len = 0;
+      lora_write_reg(REG_IRQ_FLAGS_2, IRQ2_FIFO_OVERRUN);   // Clears the FIFO
+   }
+#if CONFIG_LORA_DIO0_IRQ
+   lora_write_reg(REG_DIO_MAPPING_1, DIO0_RX_DONE);   // PayloadReady in FSK
+#endif
+   lora_write_reg(REG_OP_MODE, lora_op_mode(MODE_RX_CONTINUOUS));
 }
 
 /**
@@ -278,7 +499,7 @@ lora_set_tx_power(int level)
    // RF9x module uses PA_BOOST pin
    if (level < 2) level = 2;
    else if (level > 17) level = 17;
-   lora_write_reg(REG_PA_CONFIG, PA_BOOST | (level - 2));
+   lora_shadow_write(REG_PA_CONFIG, PA_BOOST | (level - 2));
 }
 
 /**
@@ -288,13 +509,48 @@ lora_set_tx_power(int level)
 void 
 lora_set_frequency(long frequency)
 {
-   _frequency = frequency;
+   _shadow.frequency = frequency;
 
    uint64_t frf = ((uint64_t)frequency << 19) / 32000000;
 
-   lora_write_reg(REG_FRF_MSB, (uint8_t)(frf >> 16));
-   lora_write_reg(REG_FRF_MID, (uint8_t)(frf >> 8));
-   lora_write_reg(REG_FRF_LSB, (uint8_t)(frf >> 0));
+   lora_config_begin();
+   lora_shadow_write(REG_FRF_MSB, (uint8_t)(frf >> 16));
+   lora_shadow_write(REG_FRF_MID, (uint8_t)(frf >> 8));
+   lora_shadow_write(REG_FRF_LSB, (uint8_t)(frf >> 0));
+   lora_config_commit();
+}
+
+/**
+ * @brief Bandwidth in Hz, from the shadow.
+ */
+static uint32_t
+lora_bw_hz(void)
+{
+   static const uint32_t bw_hz[] = {
+      7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000
+   };
+   int bw = SHADOW(REG_MODEM_CONFIG_1) >> 4;
+   return bw_hz[bw < 10 ? bw : 9];
+}
+
+/**
+ * @brief Symbol time in microseconds, from the shadow.
+ */
+static uint32_t
+lora_symbol_us(void)
+{
+   return (uint32_t)((1000000ULL << (SHADOW(REG_MODEM_CONFIG_2) >> 4)) / lora_bw_hz());
+}
+
+/**
+ * @brief Set LowDataRateOptimize from the symbol time, the datasheet
+ * requires it above 16 ms (SF11 and SF12 at 125 kHz).
+ */
+static void
+lora_update_ldro(void)
+{
+   int cfg3 = SHADOW(REG_MODEM_CONFIG_3) & ~0x08;
+   lora_shadow_write(REG_MODEM_CONFIG_3, lora_symbol_us() > 16000 ? cfg3 | 0x08 : cfg3);
 }
 
 /**
@@ -307,16 +563,12 @@ lora_set_spreading_factor(int sf)
    if (sf < 6) sf = 6;
    else if (sf > 12) sf = 12;
 
-   if (sf == 6) {
-      lora_write_reg(REG_DETECTION_OPTIMIZE, 0xc5);
-      lora_write_reg(REG_DETECTION_THRESHOLD, 0x0c);
-   } else {
-      lora_write_reg(REG_DETECTION_OPTIMIZE, 0xc3);
-      lora_write_reg(REG_DETECTION_THRESHOLD, 0x0a);
-   }
-
-   lora_write_reg(REG_MODEM_CONFIG_2, (lora_read_reg(REG_MODEM_CONFIG_2) & 0x0f) | ((sf << 4) & 0xf0));
-   _sf = sf;
+   lora_config_begin();
+   lora_shadow_write(REG_DETECTION_OPTIMIZE, sf == 6 ? 0xc5 : 0xc3);
+   lora_shadow_write(REG_DETECTION_THRESHOLD, sf == 6 ? 0x0c : 0x0a);
+   lora_shadow_write(REG_MODEM_CONFIG_2, (SHADOW(REG_MODEM_CONFIG_2) & 0x0f) | ((sf << 4) & 0xf0));
+   lora_update_ldro();
+   lora_config_commit();
 }
 
 /**
@@ -326,7 +578,7 @@ lora_set_spreading_factor(int sf)
 int 
 lora_get_spreading_factor(void)
 {
-   return (lora_read_reg(REG_MODEM_CONFIG_2) >> 4);
+   return (SHADOW(REG_MODEM_CONFIG_2) >> 4);
 }
 
 /**
@@ -337,7 +589,10 @@ void
 lora_set_bandwidth(int sbw)
 {
    if (sbw < 10) {
-      lora_write_reg(REG_MODEM_CONFIG_1, (lora_read_reg(REG_MODEM_CONFIG_1) & 0x0f) | (sbw << 4));
+      lora_config_begin();
+      lora_shadow_write(REG_MODEM_CONFIG_1, (SHADOW(REG_MODEM_CONFIG_1) & 0x0f) | (sbw << 4));
+      lora_update_ldro();
+      lora_config_commit();
       _sbw = sbw;
    }
 }
@@ -354,7 +609,7 @@ lora_get_bandwidth(void)
    //ESP_LOGD(TAG, "bw=0x%02x", bw);
    //bw = bw >> 4;
    //return bw;
-   return ((lora_read_reg(REG_MODEM_CONFIG_1) & 0xf0) >> 4);
+   return ((SHADOW(REG_MODEM_CONFIG_1) & 0xf0) >> 4);
 }
 
 /**
@@ -370,8 +625,7 @@ lora_set_coding_rate(int cr)
    //int cr = denominator - 4;
    if (cr < 1) cr = 1;
    else if (cr > 4) cr = 4;
-   lora_write_reg(REG_MODEM_CONFIG_1, (lora_read_reg(REG_MODEM_CONFIG_1) & 0xf1) | (cr << 1));
-   _cr = cr;
+   lora_shadow_write(REG_MODEM_CONFIG_1, (SHADOW(REG_MODEM_CONFIG_1) & 0xf1) | (cr << 1));
 }
 
 /**
@@ -381,7 +635,108 @@ lora_set_coding_rate(int cr)
 int 
 lora_get_coding_rate(void)
 {
-   return ((lora_read_reg(REG_MODEM_CONFIG_1) & 0x0E) >> 1);
+   return ((SHADOW(REG_MODEM_CONFIG_1) & 0x0E) >> 1);
+}
+
+/**
+ * @brief Set the preamble length.
+ * @param length Preamble length in symbols (6-65535).
+ */
+void 
+lora_set_preamble_length(long length)
+{
+   if (length < 6) length = 6;
+   else if (length > 0xffff) length = 0xffff;
+   lora_config_begin();
+   lora_shadow_write(REG_PREAMBLE_MSB, (uint8_t)(length >> 8));
+   lora_shadow_write(REG_PREAMBLE_LSB, (uint8_t)(length >> 0));
+   lora_config_commit();
+}
+
+/**
+ * @brief Get the preamble length (from the register shadow, no SPI access).
+ * @return Preamble length in symbols.
+ */
+long
+lora_get_preamble_length(void)
+{
+   return ((SHADOW(REG_PREAMBLE_MSB) << 8) | SHADOW(REG_PREAMBLE_LSB));
+}
+
+/*
+ * Channel plan: the eight EU868 LoRaWAN channels, the first
+ * CONFIG_LORA_CHANNEL_COUNT are used.
+ */
+static const long _channels[LORA_CHANNEL_MAX] = {
+   868100000, 868300000, 868500000, 867100000, 867300000, 867500000, 867700000, 867900000
+};
+static int _channel;
+
+/**
+ * @brief Tune to a channel of the plan, after the end of a pending send.
+ * @param ch Channel index (0 to CONFIG_LORA_CHANNEL_COUNT - 1).
+ */
+void
+lora_set_channel(int ch)
+{
+   lora_send_wait(-1, NULL);   // Not while the previous packet is on air
+   _channel = ch % CONFIG_LORA_CHANNEL_COUNT;
+   lora_set_frequency(_channels[_channel]);
+}
+
+/**
+ * @brief Get the channel set by lora_set_channel() (no SPI access).
+ * @return Channel index.
+ */
+int
+lora_get_channel(void)
+{
+   return _channel;
+}
+
+/**
+ * @brief Pick the channel of the next packet.
+ * @param device_id Sender ID, for CONFIG_LORA_CHANNEL_BY_DEVICE.
+ */
+void
+lora_channel_hop(uint16_t device_id)
+{
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+#if CONFIG_LORA_CHANNEL_BY_DEVICE
+   lora_set_channel(device_id % CONFIG_LORA_CHANNEL_COUNT);
+#else
+   lora_set_channel(esp_random() % CONFIG_LORA_CHANNEL_COUNT);
+#endif
+#else
+   (void)device_id;
+#endif
+}
+
+/**
+ * @brief Switch to implicit header mode: no PHY header is sent, so both ends
+ * must be configured with the same payload length, coding rate and CRC setting.
+ * Required for spreading factor 6.
+ * @param size Fixed payload length (bytes).
+ * @param cr Coding Rate (1 to 4).
+ */
+void 
+lora_implicit_header_mode(int size, int cr)
+{
+   lora_config_begin();
+   lora_set_coding_rate(cr);
+   lora_shadow_write(REG_MODEM_CONFIG_1, SHADOW(REG_MODEM_CONFIG_1) | 0x01);
+   lora_shadow_write(REG_PAYLOAD_LENGTH, size);
+   lora_config_commit();
+}
+
+/**
+ * @brief Switch back to explicit header mode (default), the payload length
+ * and coding rate are sent in the PHY header of each packet.
+ */
+void 
+lora_explicit_header_mode(void)
+{
+   lora_shadow_write(REG_MODEM_CONFIG_1, SHADOW(REG_MODEM_CONFIG_1) & 0xfe);
 }
 
 /**
@@ -390,7 +745,7 @@ lora_get_coding_rate(void)
 void 
 lora_enable_crc(void)
 {
-   lora_write_reg(REG_MODEM_CONFIG_2, lora_read_reg(REG_MODEM_CONFIG_2) | 0x04);
+   lora_shadow_write(REG_MODEM_CONFIG_2, SHADOW(REG_MODEM_CONFIG_2) | 0x04);
 }
 
 /**
@@ -399,7 +754,107 @@ lora_enable_crc(void)
 void 
 lora_disable_crc(void)
 {
-   lora_write_reg(REG_MODEM_CONFIG_2, lora_read_reg(REG_MODEM_CONFIG_2) & 0xfb);
+   lora_shadow_write(REG_MODEM_CONFIG_2, SHADOW(REG_MODEM_CONFIG_2) & 0xfb);
+}
+
+/*
+ * FSK packet engine, for bulk transfers
+ */
+#define FSK_FIFO_SIZE                  64
+#define FSK_FIFO_THRESHOLD             31     // FifoLevel set from 32 bytes in the FIFO
+#define FSK_MAX_PAYLOAD                255    // Variable length, one length byte
+#define FSK_PREAMBLE_MIN               5      // Bytes, on top of one tick of preamble
+#define FSK_SYNC_BYTES                 3
+#define FSK_RX_CONFIG                  0x0e   // AGC on, receiver started by PreambleDetect
+#define FSK_RESTART_RX                 0x40   // RestartRxWithoutPllLock
+
+/**
+ * @brief RegRxBw value of the narrowest channel filter passing @p hz.
+ * @param hz Single-side bandwidth needed, frequency deviation plus half the bit rate.
+ */
+static int
+lora_fsk_rx_bw(uint32_t hz)
+{
+   // 32 MHz / (mant * 2^(exp + 2)), mant 24, 20 then 16 for each exponent: narrowest first
+   for (int e = 7; e >= 1; e--) {
+      for (int m = 2; m >= 0; m--) {
+         if (32000000u / ((16 + 4 * m) << (e + 2)) >= hz) return (m << 3) | e;
+      }
+   }
+   return 0x01;   // 250 kHz, the widest
+}
+
+/**
+ * @brief Switch between the LoRa modem and the FSK packet engine.
+ *
+ * FSK runs at CONFIG_LORA_FSK_BITRATE on CONFIG_LORA_FSK_FREQUENCY with
+ * variable-length packets up to 255 bytes, whitening and CRC. The LoRa
+ * settings stay in the shadow meanwhile: setters only update it, and the
+ * whole shadow is written back on the return to LoRa, since the FSK
+ * registers use the same addresses.
+ * @param modem LORA_MODEM_LORA or LORA_MODEM_FSK.
+ */
+void
+lora_set_modem(int modem)
+{
+   lora_send_wait(-1, NULL);
+   if (modem == _modem) return;
+
+   // LongRangeMode only changes in sleep
+   lora_write_reg(REG_OP_MODE, lora_op_mode(MODE_SLEEP));
+   if (modem == LORA_MODEM_FSK) {
+      _modem = LORA_MODEM_FSK;
+      uint32_t bitrate = 32000000 / CONFIG_LORA_FSK_BITRATE;
+      uint32_t fdev = ((uint64_t)CONFIG_LORA_FSK_FDEV_HZ << 19) / 32000000;
+      uint64_t frf = ((uint64_t)CONFIG_LORA_FSK_FREQUENCY << 19) / 32000000;
+      int rx_bw = lora_fsk_rx_bw(CONFIG_LORA_FSK_FDEV_HZ + CONFIG_LORA_FSK_BITRATE / 2);
+      // The receiver looks for a preamble once a tick, so it lasts a tick
+      _fsk_preamble = CONFIG_LORA_FSK_BITRATE / 8 * portTICK_PERIOD_MS / 1000 + FSK_PREAMBLE_MIN;
+      const LoraRegWrite fsk[] = {
+         { REG_OP_MODE, MODE_SLEEP },
+         { REG_BITRATE_MSB, bitrate >> 8 },
+         { REG_BITRATE_LSB, bitrate & 0xff },
+         { REG_FDEV_MSB, fdev >> 8 },
+         { REG_FDEV_LSB, fdev & 0xff },
+         { REG_FRF_MSB, frf >> 16 },
+         { REG_FRF_MID, frf >> 8 },
+         { REG_FRF_LSB, frf >> 0 },
+         { REG_RX_CONFIG, FSK_RX_CONFIG },
+         { REG_RX_BW, rx_bw },
+         { REG_AFC_BW, rx_bw },
+         { REG_PREAMBLE_DETECT, 0xaa },                  // On, 2 bytes, 10 chips of tolerance
+         { REG_FSK_PREAMBLE_MSB, _fsk_preamble >> 8 },
+         { REG_FSK_PREAMBLE_LSB, _fsk_preamble & 0xff },
+         { REG_SYNC_CONFIG, 0x10 | (FSK_SYNC_BYTES - 1) },   // Sync word on, no auto restart
+         { REG_SYNC_VALUE_1, 0xc1 },
+         { REG_SYNC_VALUE_1 + 1, 0x94 },
+         { REG_SYNC_VALUE_1 + 2, 0xc1 },
+         { REG_PACKET_CONFIG_1, 0xd0 },                  // Variable length, whitening, CRC
+         { REG_PACKET_CONFIG_2, 0x40 },                  // Packet mode
+         { REG_FSK_PAYLOAD_LENGTH, FSK_MAX_PAYLOAD },
+         { REG_FIFO_THRESH, 0x80 | FSK_FIFO_THRESHOLD },  // TX starts with the first byte in the FIFO
+         { REG_OP_MODE, MODE_STDBY },
+      };
+      lora_write_reg_seq(fsk, sizeof(fsk) / sizeof(fsk[0]));
+   } else {
+      lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_SLEEP);
+      _modem = LORA_MODEM_LORA;
+      lora_config_begin();
+      _dirty = SHADOW_REGS;
+      lora_config_commit();
+      lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+   }
+   ESP_LOGI(TAG, "lora_set_modem: %s", _modem == LORA_MODEM_FSK ? "FSK" : "LoRa");
+}
+
+/**
+ * @brief Get the modem in use.
+ * @return LORA_MODEM_LORA or LORA_MODEM_FSK.
+ */
+int
+lora_get_modem(void)
+{
+   return _modem;
 }
 
 /**
@@ -437,7 +892,7 @@ lora_init(void)
       .clock_speed_hz = 9000000,
       .mode = 0,
       .spics_io_num = CONFIG_CS_GPIO,
-      .queue_size = 7,
+      .queue_size = LORA_SPI_QUEUE_SIZE,
       .flags = 0,
       .pre_cb = NULL
    };
@@ -449,6 +904,7 @@ lora_init(void)
     * Perform hardware reset.
     */
    lora_reset();
+   _modem = LORA_MODEM_LORA;
 
    /*
     * Check version.
@@ -469,11 +925,42 @@ lora_init(void)
     * Default configuration.
     */
    lora_sleep();
-   lora_write_reg(REG_FIFO_RX_BASE_ADDR, 0);
-   lora_write_reg(REG_FIFO_TX_BASE_ADDR, 0);
-   lora_write_reg(REG_LNA, lora_read_reg(REG_LNA) | 0x03);
-   lora_write_reg(REG_MODEM_CONFIG_3, 0x04);
-   lora_set_tx_power(17);
+   lora_config_begin();
+   if (_shadow.magic != SHADOW_MAGIC) {
+      // Power-on: the shadow starts from the reset values
+      for (int reg = 0; reg <= REG_SYNC_WORD; reg++) {
+         if (lora_shadowed(reg)) SHADOW(reg) = lora_read_reg(reg);
+      }
+      _shadow.magic = SHADOW_MAGIC;
+      lora_shadow_write(REG_FIFO_RX_BASE_ADDR, 0);
+      lora_shadow_write(REG_FIFO_TX_BASE_ADDR, 0);
+      lora_shadow_write(REG_LNA, SHADOW(REG_LNA) | 0x03);
+      lora_shadow_write(REG_MODEM_CONFIG_3, 0x04);
+      lora_set_tx_power(17);
+   } else {
+      // After deep sleep: the reset lost the configuration, write it all back
+      _dirty = SHADOW_REGS;
+   }
+   lora_config_commit();
+
+#if CONFIG_LORA_DIO0_IRQ
+   /*
+    * TxDone / RxDone on DIO0, signalled to the waiting task.
+    */
+   gpio_config_t dio0 = {
+      .pin_bit_mask = 1ULL << CONFIG_DIO0_GPIO,
+      .mode = GPIO_MODE_INPUT,
+      .pull_down_en = GPIO_PULLDOWN_ENABLE,
+      .intr_type = GPIO_INTR_POSEDGE,
+   };
+   ret = gpio_config(&dio0);
+   assert(ret == ESP_OK);
+   ret = gpio_install_isr_service(0);
+   assert(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE);   // Already installed by another driver
+   gpio_isr_handler_remove(CONFIG_DIO0_GPIO);                 // lora_init() runs again after deep sleep or an error
+   ret = gpio_isr_handler_add(CONFIG_DIO0_GPIO, lora_dio0_isr, NULL);
+   assert(ret == ESP_OK);
+#endif
 
    lora_idle();
    return 1;
@@ -490,18 +977,621 @@ lora_packet_lost(void)
 }
 
 /**
- * @brief Send a packet.
- * @param buf Data to be sent.
+ * @brief Read a received packet from LoRa.
+ * @param buf Buffer for the data.
+ * @param size Available size in buffer (bytes).
+ * @return Number of bytes received (zero if no packet available).
+ */
+int 
+lora_receive_packet(uint8_t *buf, int size)
+{
+   int len = 0;
+
+   if (_modem == LORA_MODEM_FSK) {
+      // Already read from the FIFO by lora_wait_received()
+      len = _fsk_rx_len < size ? _fsk_rx_len : size;
+      memcpy(buf, _fsk_rx, len);
+      _fsk_rx_len = 0;
+      return len;
+   }
+
+   // An async send needs the bus to finish, let it end before taking it
+   lora_send_wait(-1, NULL);
+   // Keep the bus over the whole burst, the transfers skip the arbitration
+   spi_device_acquire_bus(_spi, portMAX_DELAY);
+
+   /*
+    * Check interrupts.
+    */
+   int irq = lora_read_reg(REG_IRQ_FLAGS);
+   lora_write_reg(REG_IRQ_FLAGS, irq);
+   if((irq & IRQ_RX_DONE_MASK) == 0 || (irq & IRQ_PAYLOAD_CRC_ERROR_MASK)) {
+      spi_device_release_bus(_spi);
+      return 0;
+   }
+
+   /*
+    * Find packet size.
+    */
+   if (SHADOW(REG_MODEM_CONFIG_1) & 0x01) len = SHADOW(REG_PAYLOAD_LENGTH);
+   else len = lora_read_reg(REG_RX_NB_BYTES);
+
+   /*
+    * Transfer data from radio.
+    */
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);   // lora_idle()
+   lora_write_reg(REG_FIFO_ADDR_PTR, lora_read_reg(REG_FIFO_RX_CURRENT_ADDR));
+   if(len > size) len = size;
+#if BUFFER_IO
+   lora_read_reg_buffer(REG_FIFO, buf, len);
+#else
+   for(int i=0; i<len; i++) 
+      *buf++ = lora_read_reg(REG_FIFO);
+#endif
+
+   spi_device_release_bus(_spi);
+   return len;
+}
+
+/**
+ * @brief Returns non-zero if there is data to read (packet received).
+ * @return 1 if a packet is received, 0 otherwise.
+ */
+int
+lora_received(void)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      return _fsk_rx_len > 0;
+   }
+#if CONFIG_LORA_DIO0_IRQ
+   // DIO0 is mapped to RxDone in receive mode, no SPI transfer needed
+   return gpio_get_level(CONFIG_DIO0_GPIO);
+#else
+   if(lora_read_reg(REG_IRQ_FLAGS) & IRQ_RX_DONE_MASK) return 1;
+   return 0;
+#endif
+}
+
+/**
+ * @brief Let other tasks run between two FIFO polls, bus released.
+ *
+ * Between two services the FIFO has at least FSK_FIFO_SIZE - FSK_FIFO_THRESHOLD - 1
+ * bytes of margin. The task sleeps a tick when they outlast two ticks on
+ * air (below 12.8 kbit/s at 100 Hz), it only yields otherwise: a tick
+ * would overrun the FIFO.
+ */
+static void
+lora_fsk_pause(void)
+{
+   spi_device_release_bus(_spi);
+   if ((FSK_FIFO_SIZE - FSK_FIFO_THRESHOLD - 1) * 8000 / CONFIG_LORA_FSK_BITRATE > 2 * portTICK_PERIOD_MS) {
+      vTaskDelay(1);
+   } else {
+      taskYIELD();
+   }
+   spi_device_acquire_bus(_spi, portMAX_DELAY);
+}
+
+#if CONFIG_LORA_DIO0_IRQ
+/**
+ * @brief Sleep on DIO0 (PayloadReady or PacketSent) until the end of the
+ * FSK packet, once the rest of it fits in the FIFO.
+ * @param end Deadline (esp_timer).
+ * @return 1 if DIO0 rose before the deadline.
+ */
+static int
+lora_fsk_wait_dio0(int64_t end)
+{
+   int64_t left_us = end - esp_timer_get_time();
+   int done = 0;
+   if (left_us > 0) {
+      spi_device_release_bus(_spi);
+      lora_dio0_arm();
+      done = lora_dio0_wait(pdMS_TO_TICKS(left_us / 1000) + 1);
+      spi_device_acquire_bus(_spi, portMAX_DELAY);
+   }
+   return done;
+}
+#endif
+
+/**
+ * @brief Read the FSK packet being received into _fsk_rx.
+ * The FIFO holds 64 bytes: it is emptied each time FifoLevel rises, and
+ * the rest is read on PayloadReady. The bus and the CPU are given back
+ * between polls (lora_fsk_pause()), and with CONFIG_LORA_DIO0_IRQ the task
+ * sleeps through the last 64 bytes.
+ * @return Payload length, 0 if no valid packet came before the deadline.
+ */
+static int
+lora_fsk_drain(void)
+{
+   // From the preamble to the end of the longest packet
+   const int64_t end = esp_timer_get_time() + lora_time_on_air_us(FSK_MAX_PAYLOAD)
+                       + portTICK_PERIOD_MS * 1000;
+   int len = -1;
+   int got = 0;
+
+   spi_device_acquire_bus(_spi, portMAX_DELAY);
+   while (esp_timer_get_time() < end) {
+      int irq1 = lora_read_reg(REG_IRQ_FLAGS_1);
+      int irq2 = lora_read_reg(REG_IRQ_FLAGS_2);
+      if (irq2 & IRQ2_FIFO_OVERRUN) {
+         break;   // Drained too late, the packet is lost
+      }
+      if (len < 0) {
+         if (!(irq2 & IRQ2_FIFO_EMPTY)) {
+            // The length byte comes first, RSSI is sampled after the sync word
+            _fsk_rssi = -lora_read_reg(REG_RSSI_VALUE) / 2;
+            len = lora_read_reg(REG_FIFO);
+            if (len == 0 || !(irq1 & IRQ1_SYNC_ADDRESS_MATCH)) break;
+         }
+         lora_fsk_pause();
+         continue;
+      }
+#if CONFIG_LORA_DIO0_IRQ
+      if (!(irq2 & IRQ2_PAYLOAD_READY) && len - got < FSK_FIFO_SIZE && lora_fsk_wait_dio0(end)) {
+         irq2 = lora_read_reg(REG_IRQ_FLAGS_2);   // The rest fits in the FIFO, no overrun
+      }
+#endif
+      if (irq2 & IRQ2_PAYLOAD_READY) {
+         lora_read_reg_buffer(REG_FIFO, _fsk_rx + got, len - got);
+         lora_write_reg(REG_OP_MODE, MODE_STDBY);
+         spi_device_release_bus(_spi);
+         return len;
+      }
+      if (irq2 & IRQ2_FIFO_LEVEL) {
+         // More than the threshold is in, the payload may end in this chunk
+         int n = len - got < FSK_FIFO_THRESHOLD ? len - got : FSK_FIFO_THRESHOLD;
+         lora_read_reg_buffer(REG_FIFO, _fsk_rx + got, n);
+         got += n;
+      }
+      lora_fsk_pause();
+   }
+   spi_device_release_bus(_spi);
+   return 0;
+}
+
+/**
+ * @brief Wait for an FSK packet.
+ *
+ * Only DIO0 is wired and it cannot signal FifoLevel, so the flags are read
+ * over SPI: PreambleDetect once a tick, which the preamble outlasts, then
+ * the FIFO is drained until the end of the packet. A bad CRC makes the
+ * radio drop the packet; it is then left at the deadline.
+ * @param timeout_ms Timeout in milliseconds.
+ * @return 1 if a packet is received, 0 on timeout.
+ */
+static int
+lora_fsk_wait_received(int timeout_ms)
+{
+   const int64_t end = esp_timer_get_time() + timeout_ms * 1000LL;
+   _fsk_rx_len = 0;
+   while (1) {
+      if (lora_read_reg(REG_IRQ_FLAGS_1) & (IRQ1_PREAMBLE_DETECT | IRQ1_SYNC_ADDRESS_MATCH)) {
+         _fsk_rx_len = lora_fsk_drain();
+         if (_fsk_rx_len > 0) {
+            return 1;
+         }
+         // Noise, a bad CRC or an overrun: listen again with an empty FIFO
+         lora_write_reg(REG_IRQ_FLAGS_2, IRQ2_FIFO_OVERRUN);
+         lora_write_reg(REG_OP_MODE, MODE_RX_CONTINUOUS);
+         lora_write_reg(REG_RX_CONFIG, FSK_RX_CONFIG | FSK_RESTART_RX);
+      }
+      if (esp_timer_get_time() >= end) {
+         return 0;
+      }
+      vTaskDelay(1);
+   }
+}
+
+/**
+ * @brief Wait in receive mode until a packet is received or the timeout expires.
+ * With CONFIG_LORA_DIO0_IRQ the task sleeps until the RxDone interrupt,
+ * otherwise RegIrqFlags is polled every tick. FSK packets are read here.
+ * @param timeout_ms Timeout in milliseconds.
+ * @return 1 if a packet is received, 0 on timeout.
+ */
+int
+lora_wait_received(int timeout_ms)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      return lora_fsk_wait_received(timeout_ms);
+   }
+#if CONFIG_LORA_DIO0_IRQ
+   lora_dio0_arm();
+   return lora_dio0_wait(pdMS_TO_TICKS(timeout_ms));
+#else
+   TickType_t start = xTaskGetTickCount();
+   while (!lora_received()) {
+      if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) return 0;
+      vTaskDelay(1);
+   }
+   return 1;
+#endif
+}
+
+// Airtime used against the duty cycle, kept through deep sleep (all zero until first use)
+static RTC_DATA_ATTR LoraAirtimeBudget _budget;
+
+/**
+ * @brief Airtime budget refilled up to now.
+ * Uses the RTC clock, which keeps running in deep sleep.
+ */
+static LoraAirtimeBudget *
+lora_budget(int64_t *now_us)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   *now_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+   if (_budget.capacity_ns == 0) {
+      lora_budget_reset(&_budget, CONFIG_LORA_DUTY_CYCLE_PERMILLE, CONFIG_LORA_DUTY_CYCLE_WINDOW_S, *now_us);
+   }
+   return &_budget;
+}
+
+/**
+ * @brief Time on air of a packet with the current settings.
+ * @param size Payload length (bytes).
+ * @return Time on air in microseconds.
+ */
+uint32_t
+lora_time_on_air_us(int size)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      return lora_fsk_airtime_us(CONFIG_LORA_FSK_BITRATE, _fsk_preamble, FSK_SYNC_BYTES, size);
+   }
+   LoraModem m = {
+      .sf = SHADOW(REG_MODEM_CONFIG_2) >> 4,
+      .bw_hz = lora_bw_hz(),
+      .cr = (SHADOW(REG_MODEM_CONFIG_1) >> 1) & 0x07,
+      .preamble = lora_get_preamble_length(),
+      .implicit = SHADOW(REG_MODEM_CONFIG_1) & 0x01,
+      .crc = SHADOW(REG_MODEM_CONFIG_2) & 0x04,
+      .ldro = SHADOW(REG_MODEM_CONFIG_3) & 0x08,
+   };
+   return lora_airtime_us(&m, size);
+}
+
+/**
+ * @brief Run one Channel Activity Detection, no packet on air.
+ */
+static int
+lora_cad_run(void)
+{
+   // CAD lasts about two symbols, allow four and two ticks
+   TickType_t ticks = pdMS_TO_TICKS(4 * lora_symbol_us() / 1000) + 2;
+   int done;
+
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+   lora_write_reg(REG_IRQ_FLAGS, IRQ_CAD_DONE_MASK | IRQ_CAD_DETECTED_MASK);
+#if CONFIG_LORA_DIO0_IRQ
+   lora_write_reg(REG_DIO_MAPPING_1, DIO0_CAD_DONE);
+   lora_dio0_arm();
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_CAD);
+   done = lora_dio0_wait(ticks);
+#else
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_CAD);
+   TickType_t start = xTaskGetTickCount();
+   while (!(done = lora_read_reg(REG_IRQ_FLAGS) & IRQ_CAD_DONE_MASK) && xTaskGetTickCount() - start < ticks) {
+      vTaskDelay(1);
+   }
+#endif
+   int irq = lora_read_reg(REG_IRQ_FLAGS);
+   lora_write_reg(REG_IRQ_FLAGS, IRQ_CAD_DONE_MASK | IRQ_CAD_DETECTED_MASK);
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+   if (!done) {
+      ESP_LOGW(TAG, "lora_cad: no CadDone");
+      return -1;
+   }
+   return (irq & IRQ_CAD_DETECTED_MASK) ? 1 : 0;
+}
+
+/**
+ * @brief Run one Channel Activity Detection.
+ * The radio is left in standby.
+ * @return 1 if a LoRa preamble was detected, 0 if the channel is free, -1 if CadDone never came.
+ */
+int
+lora_cad(void)
+{
+   lora_send_wait(-1, NULL);
+   _lbt.cad++;
+   return lora_cad_run();
+}
+
+/**
+ * @brief Return the listen-before-talk counters.
+ * @return Counters, kept across deep sleep.
+ */
+const LoraLbtStats *
+lora_lbt_stats(void)
+{
+   return &_lbt;
+}
+
+#if CONFIG_LORA_LBT_ENABLE
+/**
+ * @brief Listen before talk: wait for a free channel.
+ *
+ * Each busy CAD defers the packet by a random time in a window that
+ * doubles, so nodes that heard the same transmission spread out. After
+ * CONFIG_LORA_LBT_MAX_TRIES busy CADs the packet goes anyway.
+ */
+static void
+lora_lbt(void)
+{
+   uint32_t window_ms = CONFIG_LORA_LBT_BACKOFF_MS;
+   for (int i = 0; i < CONFIG_LORA_LBT_MAX_TRIES; i++) {
+      _lbt.cad++;
+      if (lora_cad_run() != 1) {
+         return;   // Free, or no answer from the radio: do not hold the packet
+      }
+      _lbt.busy++;
+      uint32_t delay_ms = 1 + esp_random() % window_ms;
+      _lbt.deferred_ms += delay_ms;
+      BINLOG(BL_LORA_LBT_BUSY, i + 1, (int)delay_ms);
+      vTaskDelay(pdMS_TO_TICKS(delay_ms) + 1);
+      window_ms *= 2;
+   }
+   _lbt.forced++;
+   ESP_LOGW(TAG, "lora_lbt: channel still busy after %d CADs, sending", CONFIG_LORA_LBT_MAX_TRIES);
+}
+#endif
+
+/*
+ * CAD receive: a CAD on each channel, then sleep for the period. The senders'
+ * preamble is longer than the period and the round, so a CAD always falls in it.
+ */
+#define SNIFF_LOCK_SYMBOLS      8       // CAD and RX lock, on top of the sleep gap
+#define SNIFF_SWITCH_US         500     // Retuning and starting a CAD on the next channel
+#define SNIFF_RX_TIMEOUT_SYMB   16      // RX single gives up without a preamble
+#define LORA_RX_CURRENT_UA      10800   // SX1276 RX and CAD, 868 MHz, 125 kHz (datasheet)
+#define LORA_SLEEP_CURRENT_NA   200     // SX1276 sleep
+
+static int _sniff_period_ms;
+
+/**
+ * @brief Set the preamble length and RX timeout for CAD receive.
+ * @param period_ms Sleep between CAD rounds of the receiver, 0 to scan without sleeping.
+ */
+void
+lora_sniff_config(int period_ms)
+{
+   // The receiver may wake up to a tick late, then checks the other channels first
+   long cad_us = 2 * lora_symbol_us() + SNIFF_SWITCH_US;
+#if !CONFIG_LORA_DIO0_IRQ
+   cad_us += portTICK_PERIOD_MS * 1000L;   // CadDone is polled every tick
+#endif
+   long gap_us = (period_ms ? (period_ms + portTICK_PERIOD_MS) * 1000L : 0)
+                 + (CONFIG_LORA_CHANNEL_COUNT - 1) * cad_us;
+   long symbols = (gap_us + lora_symbol_us() - 1) / lora_symbol_us() + SNIFF_LOCK_SYMBOLS;
+   _sniff_period_ms = period_ms;
+   lora_config_begin();
+   lora_set_preamble_length(symbols);
+   lora_shadow_write(REG_SYMB_TIMEOUT_LSB, SNIFF_RX_TIMEOUT_SYMB);
+   lora_config_commit();
+}
+
+/**
+ * @brief Receive the packet whose preamble a CAD detected.
+ * @return 1 on RxDone, 0 on RxTimeout (false detection) or timeout.
+ */
+static int
+lora_sniff_rx(void)
+{
+   // Rest of the preamble and the longest packet, the RX timeout normally comes first
+   int64_t end = esp_timer_get_time() + (int64_t)lora_get_preamble_length() * lora_symbol_us()
+                 + lora_time_on_air_us(255);
+#if CONFIG_LORA_DIO0_IRQ
+   lora_write_reg(REG_DIO_MAPPING_1, DIO0_RX_DONE);
+#endif
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_SINGLE);
+   while (1) {
+#if CONFIG_LORA_DIO0_IRQ
+      lora_dio0_arm();
+      if (lora_dio0_wait(1)) {
+         return 1;
+      }
+#else
+      vTaskDelay(1);
+#endif
+      int irq = lora_read_reg(REG_IRQ_FLAGS);
+      if (irq & IRQ_RX_DONE_MASK) {
+         return 1;
+      }
+      if ((irq & IRQ_RX_TIMEOUT_MASK) || esp_timer_get_time() >= end) {
+         lora_write_reg(REG_IRQ_FLAGS, IRQ_RX_TIMEOUT_MASK);
+         lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+         return 0;
+      }
+   }
+}
+
+/**
+ * @brief Wait for a packet in CAD receive, duty-cycled and/or scanning.
+ * Needs lora_sniff_config() on both ends.
+ * @param timeout_ms Timeout in milliseconds.
+ * @return 1 if a packet is received, 0 on timeout.
+ */
+int
+lora_sniff_wait(int timeout_ms)
+{
+   lora_send_wait(-1, NULL);
+   const int64_t end = esp_timer_get_time() + timeout_ms * 1000LL;
+   while (1) {
+      int64_t t0 = esp_timer_get_time();
+      int found = 0;
+      // One CAD per channel of the plan, starting with the current one
+      for (int i = 0; i < CONFIG_LORA_CHANNEL_COUNT && !found; i++) {
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+         lora_set_channel(_channel + (i > 0));
+#endif
+         _sniff.cad++;
+         if (lora_cad_run() != 1) {
+            continue;
+         }
+         _sniff.detected++;
+         found = lora_sniff_rx();
+         if (found) {
+            _sniff.received++;
+            _sniff.channel_received[_channel]++;
+         } else {
+            _sniff.false_wakes++;
+         }
+      }
+      int64_t t1 = esp_timer_get_time();
+      _sniff.active_us += t1 - t0;
+      if (found) {
+         return 1;
+      }
+      if (t1 >= end) {
+         return 0;
+      }
+      if (_sniff_period_ms == 0) {
+         continue;   // Scanning only, each CAD already blocks until CadDone
+      }
+      lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_SLEEP);
+      int64_t sleep_ms = (end - t1) / 1000 < _sniff_period_ms ? (end - t1) / 1000 : _sniff_period_ms;
+      vTaskDelay(pdMS_TO_TICKS(sleep_ms) + 1);
+      _sniff.sleep_us += esp_timer_get_time() - t1;
+   }
+}
+
+/**
+ * @brief Return the duty-cycled receive counters.
+ * @return Counters since boot.
+ */
+const LoraSniffStats *
+lora_sniff_stats(void)
+{
+   return &_sniff;
+}
+
+/**
+ * @brief Average radio current in duty-cycled receive.
+ * Estimated from the time spent in CAD/RX and in sleep, datasheet currents.
+ * @return Current in microamperes.
+ */
+int
+lora_sniff_current_ua(void)
+{
+   int64_t total_us = _sniff.active_us + _sniff.sleep_us;
+   if (total_us == 0) {
+      return LORA_RX_CURRENT_UA;
+   }
+   return (int)((_sniff.active_us * LORA_RX_CURRENT_UA
+                 + _sniff.sleep_us * LORA_SLEEP_CURRENT_NA / 1000) / total_us);
+}
+
+/**
+ * @brief Airtime left in the duty-cycle budget.
+ * @return Airtime in microseconds.
+ */
+int64_t
+lora_airtime_left_us(void)
+{
+   int64_t now_us;
+   LoraAirtimeBudget *b = lora_budget(&now_us);
+   return lora_budget_left_us(b, now_us);
+}
+
+/**
+ * @brief Time until a packet fits in the duty-cycle budget.
+ * @param size Payload length (bytes).
+ * @return 0 if it can be sent now, the wait in ms, or -1 if it never fits.
+ */
+int
+lora_airtime_wait_ms(int size)
+{
+   int64_t now_us;
+   LoraAirtimeBudget *b = lora_budget(&now_us);
+   int64_t wait_us = lora_budget_wait_us(b, lora_time_on_air_us(size), now_us);
+   return wait_us <= 0 ? (int)wait_us : (int)((wait_us + 999) / 1000);
+}
+
+/**
+ * @brief Return the number of packets refused by the duty-cycle budget.
+ * @return Number of refused packets.
+ */
+int
+lora_packet_refused(void)
+{
+   return (_send_packet_refused);
+}
+
+#if CONFIG_LORA_DUTY_CYCLE_ENFORCE
+#define LORA_TX_MAX_WAIT_MS CONFIG_LORA_DUTY_CYCLE_MAX_WAIT_MS
+#else
+#define LORA_TX_MAX_WAIT_MS 0
+#endif
+
+// Packet on air, from its start until lora_tx_finish()
+static uint32_t _tx_airtime_us;
+static int64_t _tx_start_us;
+static int _tx_max_retry;
+
+/**
+ * @brief Check a packet against the implicit length and the duty-cycle budget.
  * @param size Size of data.
+ * @param max_wait_ms Longest wait for airtime.
+ * @return 0 if it can be sent now, -1 if refused.
  */
-void 
-lora_send_packet(uint8_t *buf, int size)
+static int
+lora_tx_admit(int size, int max_wait_ms)
 {
+   if (_modem == LORA_MODEM_LORA && (SHADOW(REG_MODEM_CONFIG_1) & 0x01) && size != SHADOW(REG_PAYLOAD_LENGTH)) {
+      // The other end reads a fixed length, never send another size
+      ESP_LOGE(TAG, "lora_send_packet: %d bytes in implicit mode (fixed %d)", size, SHADOW(REG_PAYLOAD_LENGTH));
+      return -1;
+   }
+
    /*
-    * Transfer data to radio.
+    * Check the duty-cycle budget, wait a little for airtime or refuse.
     */
-   lora_idle();
-   lora_write_reg(REG_FIFO_ADDR_PTR, 0);
+   int64_t now_us;
+   LoraAirtimeBudget *budget = lora_budget(&now_us);
+   uint32_t airtime_us = lora_time_on_air_us(size);
+   int64_t wait_us = lora_budget_wait_us(budget, airtime_us, now_us);
+#if CONFIG_LORA_DUTY_CYCLE_ENFORCE
+   if (wait_us > 0 && wait_us <= max_wait_ms * 1000LL) {
+      vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+      budget = lora_budget(&now_us);
+      wait_us = lora_budget_wait_us(budget, airtime_us, now_us);
+   }
+   if (wait_us != 0) {
+      _send_packet_refused++;
+      ESP_LOGW(TAG, "lora_send_packet: %d bytes refused, duty cycle (%lld ms to wait)", size, wait_us / 1000);
+      BINLOG(BL_LORA_DUTY_REFUSED, size, (int)(wait_us / 1000));
+      return -1;
+   }
+#else
+   (void)max_wait_ms;
+   if (wait_us != 0) {
+      ESP_LOGW(TAG, "lora_send_packet: %d bytes over the duty-cycle budget", size);
+   }
+#endif
+   _tx_airtime_us = airtime_us;
+   return 0;
+}
+
+/**
+ * @brief Load the FIFO and start the transmission.
+ * @param buf Data to be sent, no longer needed on return.
+ * @param size Size of data.
+ * @param waiter Task woken by TxDone on DIO0 (with CONFIG_LORA_DIO0_IRQ).
+ */
+static void
+lora_tx_start(uint8_t *buf, int size, TaskHandle_t waiter)
+{
+   /*
+    * Transfer data to radio, the bus is held until the transmission starts.
+    */
+   spi_device_acquire_bus(_spi, portMAX_DELAY);
+   const LoraRegWrite load[] = {
+      { REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY },   // lora_idle()
+      { REG_FIFO_ADDR_PTR, 0 },
+   };
+   lora_write_reg_seq(load, 2);
 
 #if BUFFER_IO
    lora_write_reg_buffer(REG_FIFO, buf, size);
@@ -510,43 +1600,302 @@ lora_send_packet(uint8_t *buf, int size)
       lora_write_reg(REG_FIFO, *buf++);
 #endif
    
-   lora_write_reg(REG_PAYLOAD_LENGTH, size);
+   if (SHADOW(REG_PAYLOAD_LENGTH) != size) {
+      lora_write_reg(REG_PAYLOAD_LENGTH, size);
+   }
    
    /*
-    * Start transmission and wait for conclusion.
+    * Start transmission.
     */
-   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_TX);
-#if 0
-   while((lora_read_reg(REG_IRQ_FLAGS) & IRQ_TX_DONE_MASK) == 0)
-      vTaskDelay(2);
-#endif
-   int loop = 0;
-   int max_retry;
    if (_sbw < 2) {
-      max_retry = 500;
+      _tx_max_retry = 500;
    } else if (_sbw < 4) {
-      max_retry = 250;
+      _tx_max_retry = 250;
    } else if (_sbw < 6) {
-      max_retry = 125;
+      _tx_max_retry = 125;
    } else if (_sbw < 8) {
-      max_retry = 60;
+      _tx_max_retry = 60;
    } else {
-      max_retry = 30;
+      _tx_max_retry = 30;
+   }
+   ESP_LOGD(TAG, "_sbw=%d max_retry=%d", _sbw, _tx_max_retry);
+#if CONFIG_LORA_DIO0_IRQ
+   // TxDone raises DIO0 and wakes the waiter, nothing is read while the packet is on air
+   lora_write_reg(REG_DIO_MAPPING_1, DIO0_TX_DONE);
+   _dio0_waiter = waiter;
+#else
+   (void)waiter;
+#endif
+   // Airtime taken now, in the caller's task, so the next admission already sees it
+   int64_t now_us;
+   lora_budget_consume(lora_budget(&now_us), _tx_airtime_us);
+   _tx_start_us = esp_timer_get_time();
+   lora_write_reg(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_TX);
+   spi_device_release_bus(_spi);
+}
+
+/**
+ * @brief Wait for the end of the transmission started by lora_tx_start().
+ * @param done_us Time of TxDone (esp_timer), or of the timeout.
+ * @return LORA_TX_OK, or LORA_TX_TIMEOUT if TxDone never came.
+ */
+static int
+lora_tx_finish(int64_t *done_us)
+{
+   int loop = 0;
+   trace_begin(TRACE_LORA_TX_WAIT);
+#if CONFIG_LORA_DIO0_IRQ
+   if (!lora_dio0_wait(_tx_max_retry * 2)) {
+      loop = _tx_max_retry;   // Same bound as the polling loop
    }
-   ESP_LOGD(TAG, "_sbw=%d max_retry=%d", _sbw, max_retry);
+   *done_us = loop ? esp_timer_get_time() : _dio0_us;
+   BINLOG(BL_LORA_TX_IRQ, lora_read_reg(REG_IRQ_FLAGS));
+#else
+#if 0
+   while((lora_read_reg(REG_IRQ_FLAGS) & IRQ_TX_DONE_MASK) == 0)
+      vTaskDelay(2);
+#endif
    while(1) {
       int irq = lora_read_reg(REG_IRQ_FLAGS);
-      ESP_LOGD(TAG, "lora_read_reg=0x%x", irq);
+      BINLOG(BL_LORA_TX_IRQ, irq);
       if ((irq & IRQ_TX_DONE_MASK) == IRQ_TX_DONE_MASK) break;
       loop++;
-      if (loop == max_retry) break;
+      if (loop == _tx_max_retry) break;
       vTaskDelay(2);
    }
-   if (loop == max_retry) {
+   *done_us = esp_timer_get_time();
+#endif
+   trace_end(TRACE_LORA_TX_WAIT);
+   if (loop == _tx_max_retry) {
       _send_packet_lost++;
       ESP_LOGE(TAG, "lora_send_packet Fail");
    }
    lora_write_reg(REG_IRQ_FLAGS, IRQ_TX_DONE_MASK);
+   return loop == _tx_max_retry ? LORA_TX_TIMEOUT : LORA_TX_OK;
+}
+
+/**
+ * @brief Send an FSK packet, the FIFO is refilled as it empties.
+ * The transmission starts with the first byte in the FIFO. The bus and the
+ * CPU are given back between polls, and with CONFIG_LORA_DIO0_IRQ the task
+ * sleeps from the last refill to PacketSent.
+ * @param buf Data to be sent.
+ * @param size Size of data (at most 255 bytes).
+ * @return LORA_TX_OK, or LORA_TX_TIMEOUT if PacketSent never came.
+ */
+static int
+lora_fsk_send(uint8_t *buf, int size)
+{
+   uint8_t len = size;
+   int sent = size < FSK_FIFO_SIZE - 1 ? size : FSK_FIFO_SIZE - 1;
+   int irq = 0;
+
+   spi_device_acquire_bus(_spi, portMAX_DELAY);
+   lora_write_reg(REG_OP_MODE, MODE_STDBY);
+   lora_write_reg(REG_IRQ_FLAGS_2, IRQ2_FIFO_OVERRUN);   // Clears the FIFO
+   lora_write_reg_buffer(REG_FIFO, &len, 1);
+   lora_write_reg_buffer(REG_FIFO, buf, sent);
+
+   int64_t now_us;
+   lora_budget_consume(lora_budget(&now_us), _tx_airtime_us);
+   _tx_start_us = esp_timer_get_time();
+   const int64_t end = _tx_start_us + _tx_airtime_us + portTICK_PERIOD_MS * 1000;
+#if CONFIG_LORA_DIO0_IRQ
+   lora_write_reg(REG_DIO_MAPPING_1, DIO0_RX_DONE);   // PacketSent in FSK
+#endif
+   lora_write_reg(REG_OP_MODE, MODE_TX);
+   while (!(irq & IRQ2_PACKET_SENT) && esp_timer_get_time() < end) {
+#if CONFIG_LORA_DIO0_IRQ
+      if (sent == size) {
+         lora_fsk_wait_dio0(end);
+         irq = lora_read_reg(REG_IRQ_FLAGS_2);
+         break;
+      }
+#endif
+      irq = lora_read_reg(REG_IRQ_FLAGS_2);
+      if (sent < size && !(irq & IRQ2_FIFO_LEVEL)) {
+         // Down to the threshold: the rest of the FIFO is free
+         int n = size - sent < FSK_FIFO_SIZE - FSK_FIFO_THRESHOLD - 1
+                 ? size - sent : FSK_FIFO_SIZE - FSK_FIFO_THRESHOLD - 1;
+         lora_write_reg_buffer(REG_FIFO, buf + sent, n);
+         sent += n;
+      }
+      if (!(irq & IRQ2_PACKET_SENT)) {
+         lora_fsk_pause();
+      }
+   }
+   lora_write_reg(REG_OP_MODE, MODE_STDBY);
+   spi_device_release_bus(_spi);
+   if (!(irq & IRQ2_PACKET_SENT)) {
+      _send_packet_lost++;
+      ESP_LOGE(TAG, "lora_send_packet Fail (FSK)");
+      return LORA_TX_TIMEOUT;
+   }
+   return LORA_TX_OK;
+}
+
+/*
+ * Asynchronous send: lora_send_packet_async() starts the transmission and
+ * _tx_task finishes it. _tx_slot is taken while a packet is on air.
+ */
+#define LORA_TX_TASK_STACK 3072
+static TaskHandle_t _tx_task;
+static StaticTask_t _tx_task_tcb;
+static StackType_t _tx_task_stack[LORA_TX_TASK_STACK];
+static SemaphoreHandle_t _tx_slot;
+static StaticSemaphore_t _tx_slot_buf;
+static LoraTxCallback _tx_cb;
+static void *_tx_cb_arg;
+static LoraTxResult _tx_result;
+
+/**
+ * @brief Finish each asynchronous send and report it.
+ */
+static void
+lora_tx_task(void *arg)
+{
+   while (1) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // Also drops a TxDone that came first, DIO0 stays high
+      LoraTxResult res = { .start_us = _tx_start_us, .airtime_us = _tx_airtime_us };
+      res.status = lora_tx_finish(&res.done_us);
+      LoraTxCallback cb = _tx_cb;
+      void *cb_arg = _tx_cb_arg;
+      _tx_result = res;
+      xSemaphoreGive(_tx_slot);   // The callback may send the next packet
+      if (cb) {
+         cb(&res, cb_arg);
+      }
+   }
+}
+
+/**
+ * @brief Wait for the end of an asynchronous send.
+ * @param timeout_ms Longest wait, -1 for no limit.
+ * @param res Result of the last asynchronous send, or NULL.
+ * @return 1 if no packet is on air, 0 on timeout.
+ */
+int
+lora_send_wait(int timeout_ms, LoraTxResult *res)
+{
+   if (_tx_slot != NULL) {
+      TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+      if (xSemaphoreTake(_tx_slot, ticks) != pdTRUE) {
+         return 0;
+      }
+      xSemaphoreGive(_tx_slot);
+   }
+   if (res) {
+      *res = _tx_result;
+   }
+   return 1;
+}
+
+/**
+ * @brief Start sending a packet and return.
+ * @param buf Data to be sent, copied to the radio before return.
+ * @param size Size of data.
+ * @param cb Called from the LoRa TX task at the end of the transmission, or NULL.
+ * @param arg Passed to @p cb.
+ * @return 0 if the transmission started, -1 if the packet was refused.
+ */
+int
+lora_send_packet_async(uint8_t *buf, int size, LoraTxCallback cb, void *arg)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      // The FIFO is refilled by the sending task: sent before return
+      lora_send_wait(-1, NULL);
+      if (lora_tx_admit(size, 0) != 0) {
+         return -1;
+      }
+      LoraTxResult res = { .airtime_us = _tx_airtime_us };
+      res.status = lora_fsk_send(buf, size);
+      res.start_us = _tx_start_us;
+      res.done_us = esp_timer_get_time();
+      _tx_result = res;
+      if (cb) {
+         cb(&res, arg);
+      }
+      return 0;
+   }
+   if (_tx_task == NULL) {
+      _tx_slot = xSemaphoreCreateBinaryStatic(&_tx_slot_buf);
+      xSemaphoreGive(_tx_slot);
+      _tx_task = xTaskCreateStatic(lora_tx_task, "LoraTx", LORA_TX_TASK_STACK, NULL,
+                                   uxTaskPriorityGet(NULL), _tx_task_stack, &_tx_task_tcb);
+   }
+   xSemaphoreTake(_tx_slot, portMAX_DELAY);   // Previous packet still on air
+   if (lora_tx_admit(size, 0) != 0) {
+      xSemaphoreGive(_tx_slot);
+      return -1;
+   }
+#if CONFIG_LORA_LBT_ENABLE
+   lora_lbt();
+#endif
+   _tx_cb = cb;
+   _tx_cb_arg = arg;
+   lora_tx_start(buf, size, _tx_task);
+   xTaskNotifyGive(_tx_task);
+   return 0;
+}
+
+/**
+ * @brief Send a packet.
+ * @param buf Data to be sent.
+ * @param size Size of data.
+ * @return 0 once sent, -1 if refused (duty-cycle budget, implicit header length).
+ */
+int 
+lora_send_packet(uint8_t *buf, int size)
+{
+   lora_send_wait(-1, NULL);
+   if (lora_tx_admit(size, LORA_TX_MAX_WAIT_MS) != 0) {
+      return -1;
+   }
+   trace_begin(TRACE_LORA_SEND);
+   if (_modem == LORA_MODEM_FSK) {
+      lora_fsk_send(buf, size);   // No LBT, CAD only detects LoRa preambles
+      trace_end(TRACE_LORA_SEND);
+      return 0;
+   }
+#if CONFIG_LORA_LBT_ENABLE
+   lora_lbt();
+#endif
+#if CONFIG_LORA_DIO0_IRQ
+   lora_dio0_arm();
+#endif
+   lora_tx_start(buf, size, xTaskGetCurrentTaskHandle());
+   int64_t done_us;
+   lora_tx_finish(&done_us);
+   trace_end(TRACE_LORA_SEND);
+   return 0;
+}
+
+/**
+ * @brief Return last packet's RSSI.
+ * @return RSSI value.
+ */
+int 
+lora_packet_rssi(void)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      return _fsk_rssi;
+   }
+   // Offset of the RF port: LF below 525 MHz, HF for the whole EU868 band
+   return (lora_read_reg(REG_PKT_RSSI_VALUE) - (_shadow.frequency < 525E6 ? 164 : 157));
+}
+
+
+/**
+ * @brief Return last packet's SNR (signal to noise ratio).
+ * @return SNR value.
+ */
+float 
+lora_packet_snr(void)
+{
+   if (_modem == LORA_MODEM_FSK) {
+      return 0;   // Not measured in FSK
+   }
+   return ((int8_t)lora_read_reg(REG_PKT_SNR_VALUE)) * 0.25;
 }
 
 /**
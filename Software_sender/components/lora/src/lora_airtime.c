@@ -0,0 +1,80 @@
+/**
+ * @file lora_airtime.c
+ * @brief Time on air and duty-cycle airtime budget.
+ */
+
+#include "lora_airtime.h"
+
+uint32_t lora_airtime_us(const LoraModem *m, int size)
+{
+    int sf = m->sf;
+    int de = m->ldro ? 1 : 0;
+    int num = 8 * size - 4 * sf + 28 + 16 * (m->crc ? 1 : 0) - 20 * (m->implicit ? 1 : 0);
+    int den = 4 * (sf - 2 * de);
+    int payload = 8;
+    if (num > 0) {
+        payload += (num + den - 1) / den * (m->cr + 4);
+    }
+    // Quarter symbols, the preamble adds 4.25 symbols
+    uint64_t quarters = 4ULL * (m->preamble + payload) + 17;
+    return (uint32_t)(quarters * (1ULL << sf) * 1000000ULL / (4ULL * m->bw_hz));
+}
+
+uint32_t lora_fsk_airtime_us(uint32_t bitrate, int preamble, int sync, int size)
+{
+    uint64_t bits = 8ULL * (preamble + sync + 1 + size + 2);
+    return (uint32_t)((bits * 1000000 + bitrate - 1) / bitrate);
+}
+
+void lora_budget_reset(LoraAirtimeBudget *b, int permille, uint32_t window_s, int64_t now_us)
+{
+    b->permille = permille;
+    b->capacity_ns = (int64_t)window_s * 1000000 * permille;   // window_s * permille/1000, in ns
+    b->credit_ns = b->capacity_ns;
+    b->updated_us = now_us;
+}
+
+/**
+ * @brief Add the airtime earned since the last refill.
+ */
+static void lora_budget_refill(LoraAirtimeBudget *b, int64_t now_us)
+{
+    int64_t elapsed = now_us - b->updated_us;
+    b->updated_us = now_us;
+    if (elapsed <= 0) {
+        return;   // Clock set backwards, earn nothing
+    }
+    // Cap before multiplying, a clock jump must not overflow
+    if (elapsed > b->capacity_ns / b->permille) {
+        b->credit_ns = b->capacity_ns;
+        return;
+    }
+    b->credit_ns += elapsed * b->permille;
+    if (b->credit_ns > b->capacity_ns) {
+        b->credit_ns = b->capacity_ns;
+    }
+}
+
+int64_t lora_budget_left_us(LoraAirtimeBudget *b, int64_t now_us)
+{
+    lora_budget_refill(b, now_us);
+    return b->credit_ns > 0 ? b->credit_ns / 1000 : 0;
+}
+
+int64_t lora_budget_wait_us(LoraAirtimeBudget *b, uint32_t airtime_us, int64_t now_us)
+{
+    int64_t need = (int64_t)airtime_us * 1000;
+    if (need > b->capacity_ns) {
+        return -1;
+    }
+    lora_budget_refill(b, now_us);
+    if (b->credit_ns >= need) {
+        return 0;
+    }
+    return (need - b->credit_ns + b->permille - 1) / b->permille;
+}
+
+void lora_budget_consume(LoraAirtimeBudget *b, uint32_t airtime_us)
+{
+    b->credit_ns -= (int64_t)airtime_us * 1000;
+}
@@ -32,14 +32,34 @@ void mic_stop(void);
 
 /**
  * @brief Read the current SPL (Sound Pressure Level) in dB SPL.
- * @return The SPL value in dB SPL (float).
+ * @return The SPL value in dB SPL (float), NAN if the read failed.
  */
 float sound_read_spl(void);
 
 /**
- * @brief FreeRTOS task for sound acquisition and averaging.
+ * @brief Compute the SPL of a block of raw I2S samples.
+ * @param samples Raw 32-bit I2S samples.
+ * @param count Number of samples.
+ * @return The SPL value in dB SPL, or NAN if @p count is 0.
+ */
+float sound_compute_spl(const int32_t *samples, size_t count);
+
+/**
+ * @brief Create the queue and buffers linking sound_task to sound_dsp_task.
+ * @return ESP_OK on success, error code otherwise.
+ */
+esp_err_t sound_pipeline_init(void);
+
+/**
+ * @brief FreeRTOS task reading one I2S block per sampling slot (acquisition core).
  * @param pvParameters Pointer to CapteurContext.
  */
 void sound_task(void *pvParameters);
 
+/**
+ * @brief FreeRTOS task computing SPL values and the average (processing core).
+ * @param pvParameters Pointer to the same CapteurContext as sound_task.
+ */
+void sound_dsp_task(void *pvParameters);
+
 #endif
\ No newline at end of file
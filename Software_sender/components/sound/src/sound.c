@@ -10,7 +10,9 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "driver/i2s_std.h" 
+#include "trace.h"
 #include <math.h>
 
 
@@ -19,11 +21,25 @@
 #define I2S_DATA_IN_IO    14   ///< GPIO pin for I2S data input
 #define SAMPLE_RATE       16000 ///< Audio sample rate (Hz)
 #define MIC_DBFS_BUFFER_SIZE 1024 ///< Buffer size for SPL calculation
+#define MIC_READ_TIMEOUT_MS  200  ///< Bound on one block read (a block lasts 64 ms)
 
 static const char* TAG = "sound";
 static i2s_chan_handle_t rx_handle = NULL;
 int32_t buffer[MIC_DBFS_BUFFER_SIZE];
 
+/**
+ * @brief One I2S block handed from the consumer to the SPL processing task.
+ */
+typedef struct {
+    int slot;        ///< Sample index in the window, -1 ends the window
+    int block;       ///< Index in s_blocks
+    size_t samples;  ///< Valid samples, 0 on read error
+} SoundBlock;
+
+static int32_t s_blocks[2][MIC_DBFS_BUFFER_SIZE];   ///< Double buffer between the two tasks
+static QueueHandle_t s_dsp_queue;                     ///< Filled blocks, consumer to DSP
+static SemaphoreHandle_t s_free_blocks;               ///< Blocks the consumer may fill
+
 /**
  * @brief Initialize the SPH0645 microphone (I2S).
  *
@@ -86,26 +102,40 @@ esp_err_t mic_read(int32_t *buffer, size_t buffer_size, size_t *bytes_read)
         return ESP_ERR_INVALID_STATE;
     }
     
-    return i2s_channel_read(rx_handle, buffer, buffer_size, bytes_read, portMAX_DELAY);
+    return i2s_channel_read(rx_handle, buffer, buffer_size, bytes_read, pdMS_TO_TICKS(MIC_READ_TIMEOUT_MS));
 }
 
 /**
  * @brief Read and return the current SPL (Sound Pressure Level) value.
  *
- * @return The SPL value in dB SPL, or -1.0f on error.
+ * @return The SPL value in dB SPL, or NAN on error.
  */
 float sound_read_spl(void) {
     size_t bytes_read = 0;
-    if (mic_read(buffer, sizeof(buffer), &bytes_read) != ESP_OK) {
-        return -1.0f;
+    trace_begin(TRACE_SOUND_READ);
+    esp_err_t err = mic_read(buffer, sizeof(buffer), &bytes_read);
+    trace_end(TRACE_SOUND_READ);
+    if (err != ESP_OK) {
+        return NAN;
     }
-    size_t samples = bytes_read / sizeof(int32_t);
-    if (samples == 0) {
-        return -1.0f;
+    return sound_compute_spl(buffer, bytes_read / sizeof(int32_t));
+}
+
+/**
+ * @brief Compute the SPL of a block of raw I2S samples.
+ *
+ * @param samples Raw 32-bit I2S samples.
+ * @param count Number of samples.
+ * @return The SPL value in dB SPL, or NAN if @p count is 0.
+ */
+float sound_compute_spl(const int32_t *samples, size_t count)
+{
+    if (count == 0) {
+        return NAN;
     }
     double max = 0;
-    for (size_t i = 0; i < samples; i++) {
-        int32_t sample = buffer[i] >> 14;
+    for (size_t i = 0; i < count; i++) {
+        int32_t sample = samples[i] >> 14;
         if (fabs(sample) > max) max = fabs(sample);
     }
     double db_peak = 20.0 * log10(max / 131071.0);
@@ -114,10 +144,27 @@ float sound_read_spl(void) {
 }
 
 /**
- * @brief FreeRTOS task for SPL acquisition and averaging.
+ * @brief Create the queue and double buffer shared by sound_task and sound_dsp_task.
  *
- * This task waits for a start signal, acquires SPL values at 1 Hz for the specified sample count,
- * computes the average, and signals completion via a semaphore.
+ * @return ESP_OK on success, ESP_ERR_NO_MEM otherwise.
+ */
+esp_err_t sound_pipeline_init(void)
+{
+    static StaticQueue_t queue_storage;
+    static uint8_t queue_items[2 * sizeof(SoundBlock)];
+    static StaticSemaphore_t sem_storage;
+
+    s_dsp_queue = xQueueCreateStatic(2, sizeof(SoundBlock), queue_items, &queue_storage);
+    s_free_blocks = xSemaphoreCreateCountingStatic(2, 2, &sem_storage);
+    return (s_dsp_queue && s_free_blocks) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief FreeRTOS task consuming I2S blocks (acquisition side).
+ *
+ * This task waits for a start signal, reads one I2S block per sampling clock slot for the
+ * specified sample count and hands each block to sound_dsp_task, which computes the SPL
+ * values, the average and signals completion.
  *
  * @param pvParameters Pointer to a CapteurContext structure.
  */
@@ -126,15 +173,44 @@ void sound_task(void *pvParameters) {
     while (1) {
         // Wait for start signal
         xSemaphoreTake(ctx->start_signal, portMAX_DELAY);
-        float sum = 0;
         for (int i = 0; i < ctx->sample_count; i++) {
-            float spl = sound_read_spl();
-            ctx->buffer[i] = spl;
-            sum += spl;
-            vTaskDelay(pdMS_TO_TICKS(1000));
+            ctx->timestamps[i] = sampling_wait_slot();
+            xSemaphoreTake(s_free_blocks, portMAX_DELAY);
+            SoundBlock blk = { .slot = i, .block = i & 1 };
+            size_t bytes_read = 0;
+            trace_begin(TRACE_SOUND_READ);
+            if (mic_read(s_blocks[blk.block], sizeof(s_blocks[0]), &bytes_read) == ESP_OK) {
+                blk.samples = bytes_read / sizeof(int32_t);
+            }
+            trace_end(TRACE_SOUND_READ);
+            xQueueSend(s_dsp_queue, &blk, portMAX_DELAY);
         }
-        ctx->average = sum / ctx->sample_count;
-        xSemaphoreGive(ctx->done_semaphore);
+        sampling_compute_stats(ctx->clock, ctx->timestamps, ctx->sample_count, &ctx->stats);
+        SoundBlock end = { .slot = -1 };
+        xQueueSend(s_dsp_queue, &end, portMAX_DELAY);
         vTaskSuspend(NULL); // Suspend task until next cycle
     }
+}
+
+/**
+ * @brief FreeRTOS task computing SPL values from I2S blocks (processing side).
+ *
+ * Runs on the processing core so the SPL math never delays the I2S consumer. When the
+ * end-of-window marker arrives, it computes the average and gives the done semaphore.
+ *
+ * @param pvParameters Pointer to the same CapteurContext as sound_task.
+ */
+void sound_dsp_task(void *pvParameters) {
+    CapteurContext *ctx = (CapteurContext *)pvParameters;
+    SoundBlock blk;
+    while (1) {
+        xQueueReceive(s_dsp_queue, &blk, portMAX_DELAY);
+        if (blk.slot >= 0) {
+            ctx->buffer[blk.slot] = sound_compute_spl(s_blocks[blk.block], blk.samples);
+            xSemaphoreGive(s_free_blocks);
+            continue;
+        }
+        capteur_average(ctx);
+        xSemaphoreGive(ctx->done_semaphore);
+    }
 }
\ No newline at end of file
@@ -20,7 +20,7 @@ void temperature_init(void);
 /**
  * @brief Reads and compensates the temperature from the BME280 sensor.
  * 
- * @return float The temperature in degrees Celsius (°C).
+ * @return float The temperature in degrees Celsius (°C), NAN if the read failed.
  * 
  * This function retrieves the raw temperature data from the BME280 sensor,
  * applies compensation algorithms, and returns the temperature in °C.
@@ -30,7 +30,7 @@ float temperature_get(void);
 /**
  * @brief Reads and compensates the atmospheric pressure from the BME280 sensor.
  * 
- * @return float The pressure in hectopascals (hPa).
+ * @return float The pressure in hectopascals (hPa), NAN if the read failed.
  * 
  * This function retrieves the raw pressure data from the BME280 sensor,
  * applies compensation algorithms, and returns the pressure in hPa.
@@ -40,7 +40,7 @@ float pressure_get(void);
 /**
  * @brief Reads and compensates the humidity from the BME280 sensor.
  * 
- * @return float The humidity in percentage (%).
+ * @return float The humidity in percentage (%), NAN if the read failed.
  * 
  * This function retrieves the raw humidity data from the BME280 sensor,
  * applies compensation algorithms, and returns the humidity in %.
@@ -2,9 +2,11 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include <stdint.h> // Include standard integer types
+#include <math.h>
 #include "temperature.h"
 #include "driver/i2c.h"
 #include "esp_log.h"
+#include "trace.h"
 
 // I²C configuration
 #define I2C_MASTER_NUM           I2C_NUM_0 // I²C bus number
@@ -177,10 +179,12 @@ float temperature_get(void)
 {
     uint8_t data[6];
     // Read 6 bytes starting from the start register (pressure and temperature)
+    trace_begin(TRACE_TEMP_READ);
     esp_err_t err = bme280_read_reg(REG_DATA_START, data, 6);
+    trace_end(TRACE_TEMP_READ);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Échec de la lecture des données du capteur");
-        return 0.0;
+        return NAN;
     }
     
     // Bytes [3,4,5] contain the raw temperature
@@ -209,10 +213,12 @@ float pressure_get(void)
 {
     uint8_t data[6];
     // Read 6 bytes
+    trace_begin(TRACE_PRESS_READ);
     esp_err_t err = bme280_read_reg(REG_DATA_START, data, 6);
+    trace_end(TRACE_PRESS_READ);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Échec de la lecture des données du capteur");
-        return 0.0;
+        return NAN;
     }
     
     // Bytes [0,1,2] contain the raw pressure
@@ -252,10 +258,12 @@ float humidity_get(void)
 {
     uint8_t data[8];
     // Read 8 bytes starting from the start register (humidity, pressure, and temperature)
+    trace_begin(TRACE_HUM_READ);
     esp_err_t err = bme280_read_reg(REG_DATA_START, data, 8);
+    trace_end(TRACE_HUM_READ);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Échec de la lecture des données du capteur");
-        return 0.0;
+        return NAN;
     }
 
     // Bytes [6,7] contain the raw humidity
@@ -278,14 +286,11 @@ void temperature_task(void *pvParameters) {
     while (1) {
         xSemaphoreTake(ctx->start_signal, portMAX_DELAY);
         for (int i = 0; i < ctx->sample_count; i++) {
+            ctx->timestamps[i] = sampling_wait_slot();
             ctx->buffer[i] = temperature_get();
-            vTaskDelay(pdMS_TO_TICKS(1000));
         }
-        ctx->average = 0.0;
-        for (int i = 0; i < ctx->sample_count; i++) {
-            ctx->average += ctx->buffer[i];
-        }
-        ctx->average /= ctx->sample_count;
+        capteur_average(ctx);
+        sampling_compute_stats(ctx->clock, ctx->timestamps, ctx->sample_count, &ctx->stats);
         xSemaphoreGive(ctx->done_semaphore);
         vTaskSuspend(NULL);
     }
@@ -296,14 +301,11 @@ void pressure_task(void *pvParameters) {
     while (1) {
         xSemaphoreTake(ctx->start_signal, portMAX_DELAY);
         for (int i = 0; i < ctx->sample_count; i++) {
+            ctx->timestamps[i] = sampling_wait_slot();
             ctx->buffer[i] = pressure_get();
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
-        ctx->average = 0.0;
-        for (int i = 0; i < ctx->sample_count; i++) {
-            ctx->average += ctx->buffer[i];
         }
-        ctx->average /= ctx->sample_count;
+        capteur_average(ctx);
+        sampling_compute_stats(ctx->clock, ctx->timestamps, ctx->sample_count, &ctx->stats);
         xSemaphoreGive(ctx->done_semaphore);
         vTaskSuspend(NULL);
     }
@@ -314,14 +316,11 @@ void humidity_task(void *pvParameters) {
     while (1) {
         xSemaphoreTake(ctx->start_signal, portMAX_DELAY);
         for (int i = 0; i < ctx->sample_count; i++) {
+            ctx->timestamps[i] = sampling_wait_slot();
             ctx->buffer[i] = humidity_get();
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
-        ctx->average = 0.0;
-        for (int i = 0; i < ctx->sample_count; i++) {
-            ctx->average += ctx->buffer[i];
         }
-        ctx->average /= ctx->sample_count;
+        capteur_average(ctx);
+        sampling_compute_stats(ctx->clock, ctx->timestamps, ctx->sample_count, &ctx->stats);
         xSemaphoreGive(ctx->done_semaphore);
         vTaskSuspend(NULL);
     }
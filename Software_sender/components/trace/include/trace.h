@@ -0,0 +1,73 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/**
+ * @file trace.h
+ * @brief Lightweight wake-cycle tracepoints stored in RTC memory.
+ *
+ * Each tracepoint records an esp_timer timestamp into a fixed ring that
+ * survives deep sleep. The ring is dumped over serial and converted to a
+ * Chrome/Perfetto trace by tools/trace2chrome.py.
+ */
+
+/**
+ * @enum TraceId
+ * @brief Traced phases, names are printed by trace_dump().
+ */
+typedef enum {
+    TRACE_STATE_INIT,           ///< State machine: INIT
+    TRACE_STATE_ACQUISITION,    ///< State machine: ACQUISITION
+    TRACE_STATE_TRANSMISSION,   ///< State machine: TRANSMISSION
+    TRACE_STATE_SLEEPMODE,      ///< State machine: SLEEPMODE
+    TRACE_LORA_SEND,            ///< lora_send_packet(), whole call
+    TRACE_LORA_TX_WAIT,         ///< lora_send_packet(), waiting for TX done
+    TRACE_TEMP_READ,            ///< temperature_get()
+    TRACE_PRESS_READ,           ///< pressure_get()
+    TRACE_HUM_READ,             ///< humidity_get()
+    TRACE_SOUND_READ,           ///< sound_read_spl()
+    TRACE_ID_COUNT
+} TraceId;
+
+#if CONFIG_TRACE_ENABLE
+
+/**
+ * @brief Start a new wake cycle, call once at boot.
+ */
+void trace_cycle_start(void);
+
+/**
+ * @brief Mark the beginning of a traced phase.
+ * @param id Phase identifier.
+ */
+void trace_begin(TraceId id);
+
+/**
+ * @brief Mark the end of a traced phase.
+ * @param id Phase identifier.
+ */
+void trace_end(TraceId id);
+
+/**
+ * @brief Print every record in the ring over serial, then clear it.
+ */
+void trace_dump(void);
+
+/**
+ * @brief Dump the ring if the configured dump period has elapsed.
+ */
+void trace_dump_periodic(void);
+
+#else
+
+static inline void trace_cycle_start(void) {}
+static inline void trace_begin(TraceId id) { (void)id; }
+static inline void trace_end(TraceId id) { (void)id; }
+static inline void trace_dump(void) {}
+static inline void trace_dump_periodic(void) {}
+
+#endif // CONFIG_TRACE_ENABLE
+
+#endif // TRACE_H
@@ -0,0 +1,114 @@
+/**
+ * @file trace.c
+ * @brief Tracepoint ring buffer kept in RTC slow memory.
+ *
+ * Records are 8 bytes: a 32-bit esp_timer timestamp, the wake cycle number,
+ * the phase identifier and a begin/end marker. esp_timer restarts at every
+ * boot, so timestamps are relative to the start of their own wake cycle.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#if CONFIG_TRACE_ENABLE
+
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END   'E'
+
+typedef struct {
+    uint32_t ts_us;   ///< esp_timer time since boot (µs)
+    uint16_t cycle;   ///< Wake cycle number
+    uint8_t id;       ///< TraceId
+    uint8_t phase;    ///< TRACE_PHASE_BEGIN or TRACE_PHASE_END
+} TraceRecord;
+
+// RTC_DATA_ATTR is zeroed on power-on and kept across deep sleep
+static RTC_DATA_ATTR TraceRecord s_ring[CONFIG_TRACE_RING_SIZE];
+static RTC_DATA_ATTR uint32_t s_head;    ///< Next write index
+static RTC_DATA_ATTR uint32_t s_count;   ///< Valid records, saturates at ring size
+static RTC_DATA_ATTR uint16_t s_cycle;   ///< Current wake cycle
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *s_names[TRACE_ID_COUNT] = {
+    [TRACE_STATE_INIT]         = "INIT",
+    [TRACE_STATE_ACQUISITION]  = "ACQUISITION",
+    [TRACE_STATE_TRANSMISSION] = "TRANSMISSION",
+    [TRACE_STATE_SLEEPMODE]    = "SLEEPMODE",
+    [TRACE_LORA_SEND]          = "lora_send",
+    [TRACE_LORA_TX_WAIT]       = "lora_tx_wait",
+    [TRACE_TEMP_READ]          = "temp_read",
+    [TRACE_PRESS_READ]         = "press_read",
+    [TRACE_HUM_READ]           = "hum_read",
+    [TRACE_SOUND_READ]         = "sound_read",
+};
+
+/**
+ * @brief Append one record to the ring, overwriting the oldest when full.
+ * @param id Phase identifier.
+ * @param phase TRACE_PHASE_BEGIN or TRACE_PHASE_END.
+ */
+static void trace_record(TraceId id, uint8_t phase)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    TraceRecord *r = &s_ring[s_head];
+    r->ts_us = now;
+    r->cycle = s_cycle;
+    r->id = (uint8_t)id;
+    r->phase = phase;
+    s_head = (s_head + 1) % CONFIG_TRACE_RING_SIZE;
+    if (s_count < CONFIG_TRACE_RING_SIZE) {
+        s_count++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void trace_cycle_start(void)
+{
+    s_cycle++;
+}
+
+void trace_begin(TraceId id)
+{
+    trace_record(id, TRACE_PHASE_BEGIN);
+}
+
+void trace_end(TraceId id)
+{
+    trace_record(id, TRACE_PHASE_END);
+}
+
+void trace_dump(void)
+{
+    uint32_t start = (s_head + CONFIG_TRACE_RING_SIZE - s_count) % CONFIG_TRACE_RING_SIZE;
+
+    // One record per line, parsed by tools/trace2chrome.py
+    printf("TRACE-BEGIN %u\n", (unsigned)s_count);
+    for (uint32_t i = 0; i < s_count; i++) {
+        const TraceRecord *r = &s_ring[(start + i) % CONFIG_TRACE_RING_SIZE];
+        const char *name = r->id < TRACE_ID_COUNT ? s_names[r->id] : "?";
+        printf("TRACE %u %u %c %s\n", (unsigned)r->cycle, (unsigned)r->ts_us, r->phase, name);
+    }
+    printf("TRACE-END\n");
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_count = 0;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void trace_dump_periodic(void)
+{
+#if CONFIG_TRACE_DUMP_PERIOD > 0
+    if (s_cycle % CONFIG_TRACE_DUMP_PERIOD == 0) {
+        trace_dump();
+    }
+#endif
+}
+
+#endif // CONFIG_TRACE_ENABLE
@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -17,6 +18,347 @@
 #include "esp_sleep.h"
 #include "esp_system.h"
 #include "sound.h"
+#include "sampling.h"
+#include "task_plan.h"
+#include "trace.h"
+#include "diag.h"
+#include "binlog.h"
+#include "sensor_health.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "frame.h"
+#include "frag.h"
+#include "link.h"
+#include "node_config.h"
+#include "tdma.h"
+#include "bulk.h"
+
+#define SENSOR_COUNT 4   ///< Channels: 0 temp, 1 press, 2 hum, 3 sound
+
+/**
+ * @enum LoRaState
+ * @brief State machine for LoRa sender logic.
+ */
+enum LoRaState {
+    INIT,           ///< Initialization state
+    ACQUISITION,    ///< Sensor acquisition state
+    TRANSMISSION,   ///< LoRa transmission state
+    SLEEPMODE,      ///< Deep sleep state
+    WAKEUP,         ///< Wakeup state
+    ERROR           ///< Error state
+};
+
+// Sleep interval, sampling and radio settings, changed by downlink commands (node_config.h)
+static RTC_DATA_ATTR NodeConfig node_cfg;
+static RTC_DATA_ATTR bool node_cfg_loaded = false;
+
+// Longest sampling window a downlink may set: half the ceiling is left for init, deadlines and TX
+#define NODE_WINDOW_MAX_MS (CONFIG_AWAKE_CEILING_MS / 2)
+
+#if CONFIG_TDMA_ENABLE
+// Beacon tracking and wake-up planning, kept across deep sleep (tdma.h)
+static RTC_DATA_ATTR TdmaSync tdma;
+static RTC_DATA_ATTR int64_t tdma_wake_us;   // Planned wake-up, 0 when not planned
+static RTC_DATA_ATTR int64_t tdma_lead_us;   // Wake-up to the beacon window, last cycle
+static const TdmaParams tdma_params = {
+    .guard_ms = CONFIG_TDMA_GUARD_MS,
+    .drift_ppm = CONFIG_TDMA_DRIFT_PPM,
+    .max_missed = CONFIG_TDMA_MAX_MISSED,
+};
+
+#define TDMA_SEARCH_MARGIN_MS 1000   // Awake time kept after a beacon search or a slot, for the sleep entry
+#endif
+
+/**
+ * @brief Awake time ceiling reached: sleep now, whatever the node is doing.
+ * @param arg Pointer to the RTC state, reset so the next cycle starts at INIT.
+ */
+static void awake_ceiling_cb(void *arg)
+{
+    *(enum LoRaState *)arg = INIT;
+    ESP_LOGE("MAIN", "Awake time ceiling reached, forcing deep sleep");
+#if CONFIG_TDMA_ENABLE
+    tdma_wake_us = 0;   // Not a planned wake-up, the next lead is not measured from it
+#endif
+    esp_sleep_enable_timer_wakeup(node_cfg.sleep_s * 1000000ULL);
+    binlog_flush();
+    esp_deep_sleep_start();
+}
+
+/**
+ * @brief Send a message, in fragments when it is longer than CONFIG_FRAME_FRAG_LEN.
+ *
+ * Frames and fragments are acknowledged by the receiver (link.h).
+ * @param msg Frame or JSON packet.
+ * @param len Message length.
+ * @param device_id Sender ID for the fragment headers.
+ * @param seq Frame sequence counter, one number per fragment.
+ * @return 1 if the message, or each of its fragments, was acknowledged.
+ *         LINK_REFUSED if the duty-cycle budget refused one, the next
+ *         fragments are then not sent.
+ */
+static int uplink_send(uint8_t *msg, int len, uint16_t device_id, uint8_t *seq)
+{
+    static RTC_DATA_ATTR uint8_t msg_id = 0;
+
+    if (len <= CONFIG_FRAME_FRAG_LEN) {
+        return link_send(msg, len);
+    }
+    int count = frag_count(len, CONFIG_FRAME_FRAG_LEN);
+    if (count < 0) {
+        ESP_LOGE("MAIN", "Message of %d bytes too long to fragment", len);
+        return 0;
+    }
+    int acked = 1;
+    uint8_t packet[CONFIG_FRAME_FRAG_LEN];
+    FrameHeader hdr = { .device_id = device_id };
+    for (int i = 0; i < count; i++) {
+        hdr.seq = (*seq)++;
+        int n = frag_encode(&hdr, msg_id, msg, len, CONFIG_FRAME_FRAG_LEN, i, packet, sizeof(packet));
+        int ret = link_send(packet, n);   // Each fragment is acknowledged and retried on its own
+        if (ret == LINK_REFUSED) {
+            acked = LINK_REFUSED;   // The receiver cannot rebuild the message anyway
+            break;
+        }
+        acked &= ret;
+    }
+    BINLOG(BL_MESSAGE_FRAGMENTED, msg_id, count, len);
+    msg_id++;
+    return acked;
+}
+
+#if CONFIG_TDMA_ENABLE || CONFIG_LINK_BULK_ENABLE
+/**
+ * @brief Time on the RTC clock, which keeps running in deep sleep.
+ */
+static int64_t rtc_time_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+#endif
+
+#if CONFIG_TDMA_ENABLE
+/**
+ * @brief Listen for the beacon of this cycle and correct the clock drift.
+ *
+ * The window opens a guard time before the predicted beacon. A node that
+ * comes too late for it takes the prediction, as for a missed beacon.
+ * Also measures the time from wake-up to the window.
+ */
+static void tdma_sync(void)
+{
+    if (!tdma.synced) {
+        return;
+    }
+    int64_t now = rtc_time_us();
+    // Wake-up to here, the next wake-up comes this much before its beacon
+    tdma_lead_us = tdma_wake_us ? now - tdma_wake_us : esp_timer_get_time();
+
+    const int64_t period_us = tdma.sched.period_s * 1000000LL;
+    int64_t beacon = tdma_beacon_after(&tdma, now - tdma_params.guard_ms * 1000LL);
+    int64_t guard = tdma_guard_us(&tdma, beacon, &tdma_params);
+    BeaconSchedule sched;
+    int64_t start_us;
+    if (beacon - now > period_us / 2) {
+        // Too late for the beacon of this period, its slots are still ahead
+        beacon = tdma_beacon_after(&tdma, now - period_us);
+    } else {
+        int64_t wait_us = beacon - guard - now;
+        if (wait_us > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+        }
+        int window_ms = (beacon + guard - rtc_time_us() + lora_time_on_air_us(BEACON_LEN)) / 1000 + 1;
+        if (link_wait_beacon(window_ms, &sched, &start_us)) {
+            // Beacon start on the RTC clock
+            int64_t heard = rtc_time_us() - (esp_timer_get_time() - start_us);
+            int64_t error = tdma_heard(&tdma, &sched, heard, &tdma_params);
+            BINLOG(BL_TDMA_SYNC, (int32_t)error, tdma.drift_ppm, (int32_t)(guard / 1000));
+            return;
+        }
+    }
+    if (tdma_missed(&tdma, beacon, &tdma_params)) {
+        BINLOG(BL_TDMA_MISSED, tdma.missed);
+    } else {
+        BINLOG(BL_TDMA_LOST, tdma.missed);
+    }
+}
+
+/**
+ * @brief Wait for this node's slot, radio asleep. A slot too late for the
+ * message to be sent within the awake time ceiling is skipped, the message
+ * goes at once.
+ * @param device_id Sender ID, gives the slot.
+ * @param len Length of the message to send.
+ */
+static void tdma_wait_slot(uint16_t device_id, int len)
+{
+    if (!tdma.synced) {
+        return;   // ALOHA until a beacon is heard
+    }
+    int64_t wait_us = tdma_slot_us(&tdma, device_id) - rtc_time_us();
+
+    // Longest send: every packet of the message, each with all its attempts and ACK windows
+    int packets = len > CONFIG_FRAME_FRAG_LEN ? frag_count(len, CONFIG_FRAME_FRAG_LEN) : 1;
+    int64_t send_ms = lora_time_on_air_us(len > CONFIG_FRAME_FRAG_LEN ? CONFIG_FRAME_FRAG_LEN : len) / 1000 + 1;
+#if CONFIG_LINK_ACK_ENABLE
+    send_ms = (CONFIG_LINK_ACK_RETRIES + 1) * (send_ms + CONFIG_LINK_ACK_TIMEOUT_MS);
+#endif
+    int64_t left_ms = CONFIG_AWAKE_CEILING_MS - esp_timer_get_time() / 1000 - TDMA_SEARCH_MARGIN_MS;
+    if (wait_us / 1000 + packets * send_ms > left_ms) {
+        BINLOG(BL_TDMA_LATE, (int)(wait_us / 1000));
+        return;
+    }
+    if (wait_us > 0) {
+        lora_sleep();
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+    }
+}
+
+/**
+ * @brief Not synchronized: listen for a beacon after sending, for at most
+ * a period and within the awake time ceiling.
+ */
+static void tdma_search(void)
+{
+    if (tdma.synced || !tdma_search_due(&tdma)) {
+        return;
+    }
+    int64_t left_ms = CONFIG_AWAKE_CEILING_MS - esp_timer_get_time() / 1000 - TDMA_SEARCH_MARGIN_MS;
+    int window_ms = left_ms < CONFIG_TDMA_PERIOD_S * 1000 ? left_ms : CONFIG_TDMA_PERIOD_S * 1000;
+    BeaconSchedule sched;
+    int64_t start_us;
+    if (window_ms > 0 && link_wait_beacon(window_ms, &sched, &start_us)) {
+        tdma_heard(&tdma, &sched, rtc_time_us() - (esp_timer_get_time() - start_us), &tdma_params);
+        BINLOG(BL_TDMA_SYNC, 0, tdma.drift_ppm, CONFIG_TDMA_GUARD_MS);
+    } else {
+        tdma_search_failed(&tdma);
+        BINLOG(BL_TDMA_SEARCH, tdma.search_skip);
+    }
+}
+
+/**
+ * @brief Deep sleep of this cycle: synchronized, up to just before the
+ * beacon that starts the period of the next transmission.
+ * @return Sleep duration in microseconds.
+ */
+static uint64_t tdma_sleep_us(void)
+{
+    tdma_wake_us = 0;
+    if (!tdma.synced) {
+        return node_cfg.sleep_s * 1000000ULL;
+    }
+    const int64_t now = rtc_time_us();
+    const int64_t period_us = tdma.sched.period_s * 1000000LL;
+    // Whole periods closest to the sleep interval, at least one
+    int64_t periods = (node_cfg.sleep_s * 1000000LL + period_us / 2) / period_us;
+    if (periods < 1) {
+        periods = 1;
+    }
+    int64_t beacon = tdma_beacon_after(&tdma, tdma.anchor_us + periods * period_us - period_us / 2);
+    int64_t wake = beacon - tdma_guard_us(&tdma, beacon, &tdma_params) - tdma_lead_us;
+    if (wake <= now) {
+        // Sampling takes longer than the time left: the first beacon it can make
+        beacon = tdma_beacon_after(&tdma, now + tdma_lead_us + tdma_guard_us(&tdma, beacon, &tdma_params));
+        wake = beacon - tdma_guard_us(&tdma, beacon, &tdma_params) - tdma_lead_us;
+    }
+    tdma_wake_us = wake;
+    return wake - now;
+}
+#endif
+
+#if CONFIG_LINK_BULK_ENABLE
+// Samples of unacknowledged frames, oldest first, with their RTC time in seconds
+static RTC_DATA_ATTR FrameSample backlog[CONFIG_LINK_BULK_BACKLOG];
+static RTC_DATA_ATTR uint32_t backlog_s[CONFIG_LINK_BULK_BACKLOG];
+static RTC_DATA_ATTR int backlog_count = 0;
+
+/**
+ * @brief Keep samples whose frame was not acknowledged, the oldest go when full.
+ * @param s Samples, oldest first.
+ * @param n Number of samples.
+ * @param first_us RTC time of the first sample.
+ * @param interval_s Interval between samples.
+ */
+static void backlog_push(const FrameSample *s, int n, int64_t first_us, uint16_t interval_s)
+{
+    int dropped = 0;
+    for (int i = 0; i < n; i++) {
+        if (backlog_count == CONFIG_LINK_BULK_BACKLOG) {
+            memmove(backlog, backlog + 1, (backlog_count - 1) * sizeof(backlog[0]));
+            memmove(backlog_s, backlog_s + 1, (backlog_count - 1) * sizeof(backlog_s[0]));
+            backlog_count--;
+            dropped++;
+        }
+        backlog[backlog_count] = s[i];
+        backlog_s[backlog_count] = first_us / 1000000 + (uint32_t)i * interval_s;
+        backlog_count++;
+    }
+    BINLOG(BL_BULK_BACKLOG, backlog_count, dropped);
+}
+
+/**
+ * @brief Encode the backlog from @p from in one batch frame.
+ * The interval is the mean one, the samples are one per unacknowledged cycle.
+ * @param from First sample.
+ * @param hdr Header of the frame.
+ * @param buf Output buffer, BULK_DATA_MAX bytes.
+ * @param encoded Output number of samples in the frame.
+ * @return Frame length, or -1 on error.
+ */
+static int backlog_encode(int from, const FrameHeader *hdr, uint8_t *buf, int *encoded)
+{
+    int n = backlog_count - from;
+    uint16_t interval_s = n > 1 ? (backlog_s[backlog_count - 1] - backlog_s[from]) / (n - 1) : 0;
+    return frame_encode_batch(hdr, interval_s, backlog + from, n, buf, BULK_DATA_MAX, encoded);
+}
+
+/**
+ * @brief Send the backlog in an FSK burst (bulk.h).
+ * Samples leave the backlog as their frames are acknowledged, the rest wait
+ * for the next transfer.
+ * @param device_id Sender ID.
+ * @param seq Frame sequence counter.
+ */
+static void backlog_send(uint16_t device_id, uint8_t *seq)
+{
+    uint8_t frame[BULK_DATA_MAX];
+    FrameHeader hdr = { .device_id = device_id };
+    int frames = 0;
+    int encoded;
+    for (int from = 0; from < backlog_count; from += encoded) {
+        if (backlog_encode(from, &hdr, frame, &encoded) < 0) {
+            return;
+        }
+        frames++;
+    }
+
+    int granted = link_bulk_begin(device_id, seq, frames);
+    if (granted == 0) {
+        BINLOG(BL_BULK_REFUSED, frames);
+        return;
+    }
+    int sent = 0;
+    int samples = 0;
+    while (sent < granted && backlog_count > 0) {
+        hdr.seq = *seq;
+        int len = backlog_encode(0, &hdr, frame, &encoded);
+        uint32_t age_s = rtc_time_us() / 1000000 - backlog_s[encoded - 1];
+        (*seq)++;
+        if (len < 0 || !link_bulk_send(frame, len, age_s)) {
+            break;   // Lost the receiver, the rest waits for the next transfer
+        }
+        memmove(backlog, backlog + encoded, (backlog_count - encoded) * sizeof(backlog[0]));
+        memmove(backlog_s, backlog_s + encoded, (backlog_count - encoded) * sizeof(backlog_s[0]));
+        backlog_count -= encoded;
+        samples += encoded;
+        sent++;
+    }
+    link_bulk_end(device_id, seq);
+    BINLOG(BL_BULK_DONE, sent, granted, samples, backlog_count);
+}
+#endif
 
 /**
  * @brief Main application entry point.
@@ -24,23 +366,61 @@
  * Implements a state machine for sensor acquisition, LoRa transmission, and sleep management.
  */
 void app_main(void) {
-    /**
-     * @enum LoRaState
-     * @brief State machine for LoRa sender logic.
-     */
-    enum LoRaState {
-        INIT,           ///< Initialization state
-        ACQUISITION,    ///< Sensor acquisition state
-        TRANSMISSION,   ///< LoRa transmission state
-        SLEEPMODE,      ///< Deep sleep state
-        WAKEUP,         ///< Wakeup state
-        ERROR           ///< Error state
+    static RTC_DATA_ATTR enum LoRaState state = INIT;
+    static RTC_DATA_ATTR uint32_t cycle_count = 0;
+    // Consecutive failures and retry backoff per sensor, kept across deep sleep
+    static RTC_DATA_ATTR SensorHealth sensor_health[SENSOR_COUNT];
+    static RTC_DATA_ATTR uint8_t frame_seq = 0;
+#if CONFIG_BATCH_CYCLES > 1
+    // Quantized measurements not sent yet, oldest first
+    static RTC_DATA_ATTR FrameSample batch[CONFIG_BATCH_CYCLES];
+    static RTC_DATA_ATTR int batch_count = 0;
+    static RTC_DATA_ATTR int64_t batch_first_us = 0;
+#endif
+
+    // Frames are tagged with the low bytes of the MAC address
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    const uint16_t device_id = (mac[4] << 8) | mac[5];
+
+    // Every boot (power-on or deep sleep wake-up) is a new traced cycle
+    trace_cycle_start();
+    cycle_count++;
+
+    // NVS is only read on power-on, RTC memory keeps the settings across deep sleep
+    if (!node_cfg_loaded) {
+        if (node_config_load(&node_cfg) != ESP_OK) {
+            ESP_LOGW("MAIN", "Settings not read from NVS, using the defaults");
+        }
+        node_cfg_loaded = true;
+    }
+
+    // Hard ceiling on the time spent awake in one cycle
+    esp_timer_handle_t awake_timer;
+    const esp_timer_create_args_t awake_timer_args = {
+        .callback = awake_ceiling_cb,
+        .arg = &state,
+        .name = "awake_ceiling",
     };
+    if (esp_timer_create(&awake_timer_args, &awake_timer) == ESP_OK) {
+        esp_timer_start_once(awake_timer, CONFIG_AWAKE_CEILING_MS * 1000LL);
+    }
 
-    static RTC_DATA_ATTR enum LoRaState state = INIT;
+    // Deferred logging: records are formatted off the sampling/TX path
+    binlog_start_task(1);
 
-    // Define number of samples (1 per second for 10 seconds)
-    const int sample_count = 10;
+    // This task runs the radio, it belongs on the processing core
+    vTaskPrioritySet(NULL, PIPELINE_RADIO_PRIORITY);
+#if CONFIG_PIPELINE_PIN_TASKS && !CONFIG_FREERTOS_UNICORE
+    if (xPortGetCoreID() != PIPELINE_PROC_CORE) {
+        ESP_LOGW("MAIN", "Main task on core %d, expected %d (ESP_MAIN_TASK_AFFINITY)",
+                 xPortGetCoreID(), PIPELINE_PROC_CORE);
+    }
+#endif
+
+    // Number of samples and period, at most DOWNLINK_SAMPLES_MAX (node_config.h)
+    const int sample_count = node_cfg.sample_count;
+    const uint32_t sample_period_ms = node_cfg.sample_period_ms;
 
     // Buffers allocated on the stack
     float temp_buffer[sample_count];
@@ -48,9 +428,20 @@ void app_main(void) {
     float humidity_buffer[sample_count];
     float sound_buffer[sample_count];
 
+    // Sample timestamps, filled by each task from the shared sampling clock
+    int64_t temp_timestamps[sample_count];
+    int64_t pressure_timestamps[sample_count];
+    int64_t humidity_timestamps[sample_count];
+    int64_t sound_timestamps[sample_count];
+
+    // One clock drives every channel so samples are aligned in time
+    static SamplingClock sampling_clock;
+
     // Sensor contexts
     CapteurContext temp_ctx = {
         .buffer = temp_buffer,
+        .timestamps = temp_timestamps,
+        .clock = &sampling_clock,
         .sample_count = sample_count,
         .done_semaphore = xSemaphoreCreateBinary(),
         .start_signal = xSemaphoreCreateBinary()
@@ -58,6 +449,8 @@ void app_main(void) {
 
     CapteurContext pressure_ctx = {
         .buffer = pressure_buffer,
+        .timestamps = pressure_timestamps,
+        .clock = &sampling_clock,
         .sample_count = sample_count,
         .done_semaphore = xSemaphoreCreateBinary(),
         .start_signal = xSemaphoreCreateBinary()
@@ -65,6 +458,8 @@ void app_main(void) {
 
     CapteurContext humidity_ctx = {
         .buffer = humidity_buffer,
+        .timestamps = humidity_timestamps,
+        .clock = &sampling_clock,
         .sample_count = sample_count,
         .done_semaphore = xSemaphoreCreateBinary(),
         .start_signal = xSemaphoreCreateBinary()
@@ -72,6 +467,8 @@ void app_main(void) {
 
     CapteurContext sound_ctx = {
         .buffer = sound_buffer,
+        .timestamps = sound_timestamps,
+        .clock = &sampling_clock,
         .sample_count = sample_count,
         .done_semaphore = xSemaphoreCreateBinary(),
         .start_signal = xSemaphoreCreateBinary(),
@@ -83,80 +480,295 @@ void app_main(void) {
     TaskHandle_t humidity_task_handle;
     TaskHandle_t sound_task_handle;
 
-    xTaskCreate(temperature_task, "TempTask", 2048, &temp_ctx, 5, &temp_task_handle);
-    xTaskCreate(pressure_task, "PressureTask", 2048, &pressure_ctx, 5, &pressure_task_handle);
-    xTaskCreate(humidity_task, "HumidityTask", 2048, &humidity_ctx, 5, &humidity_task_handle);
-    xTaskCreate(sound_task, "SoundTask", 2048, &sound_ctx, 5, &sound_task_handle);
+    // Acquisition and I2S consumer on one core, SPL processing on the other (task_plan.h)
+    sound_pipeline_init();
+    xTaskCreatePinnedToCore(temperature_task, "TempTask", 2048, &temp_ctx,
+                            PIPELINE_ACQ_PRIORITY, &temp_task_handle, PIPELINE_ACQ_CORE);
+    xTaskCreatePinnedToCore(pressure_task, "PressureTask", 2048, &pressure_ctx,
+                            PIPELINE_ACQ_PRIORITY, &pressure_task_handle, PIPELINE_ACQ_CORE);
+    xTaskCreatePinnedToCore(humidity_task, "HumidityTask", 2048, &humidity_ctx,
+                            PIPELINE_ACQ_PRIORITY, &humidity_task_handle, PIPELINE_ACQ_CORE);
+    xTaskCreatePinnedToCore(sound_task, "SoundTask", 2048, &sound_ctx,
+                            PIPELINE_I2S_PRIORITY, &sound_task_handle, PIPELINE_ACQ_CORE);
+    xTaskCreatePinnedToCore(sound_dsp_task, "SoundDspTask", 2048, &sound_ctx,
+                            PIPELINE_DSP_PRIORITY, NULL, PIPELINE_PROC_CORE);
+
+    const TaskHandle_t sampled_tasks[SENSOR_COUNT] = {
+        temp_task_handle, pressure_task_handle, humidity_task_handle, sound_task_handle
+    };
+    sampling_clock_init(&sampling_clock, sample_period_ms, sampled_tasks, SENSOR_COUNT);
+
+    CapteurContext *const channels[SENSOR_COUNT] = { &temp_ctx, &pressure_ctx, &humidity_ctx, &sound_ctx };
+    // Time allowed past the end of the sampling window, per bus
+    const uint32_t deadline_margin_ms[SENSOR_COUNT] = {
+        CONFIG_ACQ_I2C_MARGIN_MS, CONFIG_ACQ_I2C_MARGIN_MS, CONFIG_ACQ_I2C_MARGIN_MS, CONFIG_ACQ_I2S_MARGIN_MS
+    };
+    uint8_t valid_mask = 0;   // Bit i set when channel i delivered valid samples in time
 
     while (1) {
+        // Attribute heap allocations to the current state
+        diag_set_state(state);
+
         switch (state) {
         case INIT:
             ESP_LOGI("STATE", "INIT");
+            trace_begin(TRACE_STATE_INIT);
             if (lora_init() == 0) {
                 ESP_LOGE("LoRa", "LoRa module not detected.");
+                trace_end(TRACE_STATE_INIT);
                 state = ERROR;
                 break;
             }
 
+            // Only the registers that differ from the last cycle are written, in one sequence
+            lora_config_begin();
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+            lora_set_channel(0);
+#else
             lora_set_frequency(868e6);
+#endif
+            lora_set_spreading_factor(node_cfg.sf);
+            lora_set_tx_power(node_cfg.tx_power);
+#if CONFIG_LORA_IMPLICIT_HEADER
+            // Fixed-size measure frames, no PHY header on air (same setting on the receiver)
+            lora_implicit_header_mode(FRAME_MEASURE_LEN, CONFIG_LORA_IMPLICIT_CODING_RATE);
+#endif
+#if CONFIG_LORA_SNIFF_ENABLE
+            // Preamble that outlasts the receiver's sleep between CADs, at this SF
+            lora_sniff_config(CONFIG_LORA_SNIFF_PERIOD_MS);
+#elif CONFIG_LORA_CHANNEL_COUNT > 1
+            // Preamble that outlasts the receiver's scan of every channel
+            lora_sniff_config(0);
+#endif
+            lora_config_commit();
             temperature_init();
             if (mic_init() != ESP_OK) {
                 ESP_LOGE("mic", "Erreur initialisation microphone");
             }    
+            trace_end(TRACE_STATE_INIT);
             state = ACQUISITION;
             break;
 
         case ACQUISITION:
             ESP_LOGI("STATE", "ACQUISITION");
+            trace_begin(TRACE_STATE_ACQUISITION);
               
-            // Resume sensor tasks
-            vTaskResume(temp_task_handle);
-            vTaskResume(pressure_task_handle);
-            vTaskResume(humidity_task_handle);
-            vTaskResume(sound_task_handle);
-
+            // Resume and trigger the sensors that are not backing off
+            uint8_t sampled_mask = 0;
+            for (int i = 0; i < SENSOR_COUNT; i++) {
+                if (!sensor_health_should_sample(&sensor_health[i])) {
+                    BINLOG(BL_SENSOR_SKIPPED, i, sensor_health[i].skip);
+                    continue;
+                }
+                sampled_mask |= 1 << i;
+                vTaskResume(sampled_tasks[i]);
+                xSemaphoreGive(channels[i]->start_signal);
+            }
 
-            // Trigger synchronized measurements
-            xSemaphoreGive(temp_ctx.start_signal);
-            xSemaphoreGive(pressure_ctx.start_signal);
-            xSemaphoreGive(humidity_ctx.start_signal);
-            xSemaphoreGive(sound_ctx.start_signal);
+            // Start the shared schedule, slot 0 is sampled immediately
+            sampling_clock_start(&sampling_clock, sample_count);
 
+            // Wait for each sensor until its own deadline, a stuck bus only costs its margin
+            const TickType_t acq_start = xTaskGetTickCount();
+            const uint32_t window_ms = (sample_count - 1) * sample_period_ms;
+            valid_mask = 0;
+            for (int i = 0; i < SENSOR_COUNT; i++) {
+                if (!(sampled_mask & (1 << i))) {
+                    continue;
+                }
+                TickType_t deadline = pdMS_TO_TICKS(window_ms + deadline_margin_ms[i]);
+                TickType_t elapsed = xTaskGetTickCount() - acq_start;
+                bool ok = xSemaphoreTake(channels[i]->done_semaphore,
+                                         elapsed < deadline ? deadline - elapsed : 0) == pdTRUE
+                          && channels[i]->valid_count > 0;
+                sensor_health_report(&sensor_health[i], ok, CONFIG_ACQ_BACKOFF_MAX_CYCLES);
+                if (ok) {
+                    valid_mask |= 1 << i;
+                } else {
+                    BINLOG(BL_SENSOR_FAILED, i, sensor_health[i].failures, sensor_health[i].skip);
+                }
+            }
 
-            // Wait for each task to finish
-            xSemaphoreTake(temp_ctx.done_semaphore, portMAX_DELAY);
-            xSemaphoreTake(pressure_ctx.done_semaphore, portMAX_DELAY);
-            xSemaphoreTake(humidity_ctx.done_semaphore, portMAX_DELAY);
-            xSemaphoreTake(sound_ctx.done_semaphore, portMAX_DELAY);
+            BINLOG(BL_AVERAGES, temp_ctx.average, pressure_ctx.average, humidity_ctx.average, sound_ctx.average);
 
-            printf("Average temperature: %.2f°C | Average pressure: %.2f hPa | Average humidity: %.2f%% | Average SPL: %.2f dB SPL\n",
-                   temp_ctx.average, pressure_ctx.average, humidity_ctx.average, sound_ctx.average);
+            // Scheduling quality per channel (0 temp, 1 press, 2 hum, 3 sound)
+            for (int i = 0; i < SENSOR_COUNT; i++) {
+                if (!(valid_mask & (1 << i))) {
+                    continue;
+                }
+                const SamplingStats *st = &channels[i]->stats;
+                BINLOG(BL_SAMPLING_LATENCY, i, (int32_t)st->latency.mean_us,
+                       (int32_t)st->latency.max_us, (int32_t)st->latency.p99_us);
+                BINLOG(BL_SAMPLING_JITTER, i, (int32_t)st->jitter.mean_us,
+                       (int32_t)st->jitter.max_us, (int32_t)st->jitter.p99_us);
+            }
 
+            trace_end(TRACE_STATE_ACQUISITION);
             state = TRANSMISSION;
             break;
 
         case TRANSMISSION:
             ESP_LOGI("STATE", "TRANSMISSION");
+            trace_begin(TRACE_STATE_TRANSMISSION);
+            const LinkTxStats *link = link_tx_stats();
+#if CONFIG_TDMA_ENABLE
+            // Every cycle, sending or not, so the drift never builds up
+            tdma_sync();
+#endif
+#if CONFIG_LINK_ACK_ENABLE
+            const uint32_t sent_before = link->sent;
+            const uint32_t acked_before = link->acked;
+            const uint32_t refused_before = link->refused;
+#endif
 
-            
-            char message[160];
-            snprintf(message, sizeof(message),
-                        "{\"temp\":%.2f,\"press\":%.2f,\"hum\":%.2f,\"sound\":%.2f}",
-                        temp_ctx.average, pressure_ctx.average, humidity_ctx.average, sound_ctx.average);
-            lora_send_packet((uint8_t *)message, strlen(message));
-            ESP_LOGI("LoRa", "Message sent: %s", message);
-            
+            // Compact binary frame, invalid channels are flagged in the bitmap
+            FrameMeasure measure = {
+                .hdr = { .device_id = device_id },
+                .valid = valid_mask,
+                .temp = temp_ctx.average,
+                .press = pressure_ctx.average,
+                .hum = humidity_ctx.average,
+                .sound = sound_ctx.average,
+            };
+#if CONFIG_BATCH_CYCLES > 1
+            // Batched uplink: one compressed frame every CONFIG_BATCH_CYCLES cycles
+            struct timeval now;
+            gettimeofday(&now, NULL);   // RTC time, keeps running in deep sleep
+            int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+            if (batch_count == 0) {
+                batch_first_us = now_us;
+            }
+            frame_quantize(&measure, &batch[batch_count++]);
+            if (batch_count >= CONFIG_BATCH_CYCLES) {
+                uint16_t interval_s = (now_us - batch_first_us) / 1000000 / (batch_count - 1);
+                uint8_t frame[FRAME_MAX_LEN];
+                int encoded;
+                measure.hdr.seq = frame_seq++;
+                int frame_len = frame_encode_batch(&measure.hdr, interval_s, batch, batch_count,
+                                                   frame, sizeof(frame), &encoded);
+                if (frame_len > 0) {
+#if CONFIG_TDMA_ENABLE
+                    tdma_wait_slot(device_id, frame_len);
+#endif
+                    int acked = uplink_send(frame, frame_len, device_id, &frame_seq);
+                    BINLOG(BL_MESSAGE_SENT, frame_len);
+#if CONFIG_LINK_BULK_ENABLE
+                    if (acked != 1) {
+                        // Kept for a bulk transfer once the receiver answers again
+                        backlog_push(batch, encoded, batch_first_us, interval_s);
+                    }
+#else
+                    (void)acked;
+#endif
+                }
+                // Samples that did not fit go in the next frame
+                memmove(batch, batch + encoded, (batch_count - encoded) * sizeof(batch[0]));
+                batch_count -= encoded;
+                batch_first_us += (int64_t)encoded * interval_s * 1000000;
+            }
+#else
+            measure.hdr.seq = frame_seq++;
+            uint8_t frame[FRAME_MEASURE_LEN];
+            int frame_len = frame_encode_measure(&measure, frame, sizeof(frame));
+#if CONFIG_TDMA_ENABLE
+            tdma_wait_slot(device_id, frame_len);
+#endif
+            int acked = link_send(frame, frame_len);
+            BINLOG(BL_MESSAGE_SENT, frame_len);
+#if CONFIG_LINK_BULK_ENABLE
+            if (acked != 1) {
+                // Kept for a bulk transfer once the receiver answers again
+                FrameSample sample;
+                frame_quantize(&measure, &sample);
+                backlog_push(&sample, 1, rtc_time_us(), 0);
+            }
+#else
+            (void)acked;
+#endif
+#endif
+            BINLOG(BL_LINK_STATS, link->acked, link->sent, link->attempts, link_tx_ratio(link) * 100.0f);
+            BINLOG(BL_AIRTIME_LEFT, (int)(lora_airtime_left_us() / 1000), lora_packet_refused());
+            const LoraLbtStats *lbt = lora_lbt_stats();
+            BINLOG(BL_LBT_STATS, lbt->cad, lbt->busy, lbt->forced, lbt->deferred_ms);
 
+#if CONFIG_DIAG_PERIOD_CYCLES > 0 && !CONFIG_LORA_IMPLICIT_HEADER
+            // Periodic memory budget report (stack headroom, heap, allocations per state)
+            if (cycle_count % CONFIG_DIAG_PERIOD_CYCLES == 0) {
+                char diag_packet[240];
+                diag_log();
+                int diag_len = diag_format_json(diag_packet, sizeof(diag_packet));
+                // Optional traffic, left out rather than delaying the measures on a short budget
+                if (diag_len > 0 && lora_airtime_wait_ms(diag_len) == 0) {
+                    uplink_send((uint8_t *)diag_packet, diag_len, device_id, &frame_seq);
+                }
+            }
+#endif
+
+#if CONFIG_LINK_ACK_ENABLE
+            // Undo a radio change that lost the receiver, confirm it on the first ACK. A cycle
+            // cut short by the duty-cycle budget says nothing about the link
+            if (link->sent != sent_before && link->refused == refused_before) {
+                const NodeConfig before = node_cfg;
+                if (node_config_link_result(&node_cfg, link->acked != acked_before,
+                                            CONFIG_NODE_RADIO_FALLBACK_CYCLES)) {
+                    node_config_save(&node_cfg);
+                    if (node_cfg.sf != before.sf || node_cfg.tx_power != before.tx_power) {
+                        BINLOG(BL_RADIO_FALLBACK, node_cfg.sf, node_cfg.tx_power);
+                    }
+                }
+            }
+#if CONFIG_LINK_BULK_ENABLE
+            // The receiver answers again: what it missed goes in an FSK burst
+            if (link->acked != acked_before && backlog_count >= CONFIG_LINK_BULK_MIN_SAMPLES) {
+                backlog_send(device_id, &frame_seq);
+            }
+#endif
+            // Commands received with an ACK, after the check above since that ACK came with the
+            // old radio settings. The sleep interval applies now, the rest from the next cycle
+            DownlinkConfig downlink;
+            if (link_take_downlink(&downlink)) {
+                int changed = node_config_apply(&node_cfg, &downlink, NODE_WINDOW_MAX_MS);
+                if (changed < 0) {
+                    BINLOG(BL_CONFIG_REJECTED, downlink.set);
+                } else if (changed > 0) {
+                    node_config_save(&node_cfg);
+                    BINLOG(BL_CONFIG_APPLIED, node_cfg.sleep_s, node_cfg.sample_count, node_cfg.sample_period_ms);
+                    BINLOG(BL_CONFIG_RADIO, node_cfg.sf, node_cfg.tx_power);
+                }
+            }
+#endif
+
+#if CONFIG_TDMA_ENABLE
+            // Sent at once without a beacon, look for one for the next cycles
+            tdma_search();
+#endif
+
+            trace_end(TRACE_STATE_TRANSMISSION);
             state = SLEEPMODE;
             break;
 
         case SLEEPMODE:
             ESP_LOGI("STATE", "SLEEPMODE");
+            trace_begin(TRACE_STATE_SLEEPMODE);
 
             
-                const int sleep_time_sec = 10;
                 state = INIT;
-                esp_sleep_enable_timer_wakeup(sleep_time_sec * 1000000ULL);
+#if CONFIG_TDMA_ENABLE
+                // Just before the beacon ahead of the next slot
+                esp_sleep_enable_timer_wakeup(tdma_sleep_us());
+#else
+                esp_sleep_enable_timer_wakeup(node_cfg.sleep_s * 1000000ULL);
+#endif
+                trace_end(TRACE_STATE_SLEEPMODE);
+                trace_dump_periodic();
+
+                // A frame sent without ACK may still be on air, the radio sleeps once it is done
+                LoraTxResult tx;
+                if (lora_send_wait(-1, &tx) && tx.done_us != 0) {
+                    BINLOG(BL_LORA_TX_DONE, tx.status, (int32_t)(tx.done_us - tx.start_us), tx.airtime_us);
+                }
+                lora_sleep();
+                binlog_flush();
                 esp_deep_sleep_start();
             
             break;
@@ -171,9 +783,9 @@ void app_main(void) {
             break;
 
         case ERROR:
-            ESP_LOGE("STATE", "ERROR - restarting in 5 sec");
-            vTaskDelay(pdMS_TO_TICKS(5000));
-            state = INIT;
+            // Retry on the next wake cycle instead of staying awake
+            ESP_LOGE("STATE", "ERROR - sleeping until next cycle");
+            state = SLEEPMODE;
             break;
         
         }
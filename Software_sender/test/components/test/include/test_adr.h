@@ -0,0 +1,8 @@
+#ifndef TEST_ADR_H
+#define TEST_ADR_H
+
+void test_adr_decide_steps(void);
+void test_adr_update_history(void);
+void test_node_config_backoff(void);
+
+#endif // TEST_ADR_H
@@ -0,0 +1,7 @@
+#ifndef TEST_AIRTIME_H
+#define TEST_AIRTIME_H
+
+void test_airtime_known_values(void);
+void test_airtime_budget(void);
+
+#endif // TEST_AIRTIME_H
@@ -0,0 +1,7 @@
+#ifndef TEST_BULK_H
+#define TEST_BULK_H
+
+void test_bulk_round_trip(void);
+void test_bulk_rejects_invalid(void);
+
+#endif // TEST_BULK_H
@@ -0,0 +1,8 @@
+#ifndef TEST_DOWNLINK_H
+#define TEST_DOWNLINK_H
+
+void test_downlink_round_trip(void);
+void test_downlink_rejects_invalid(void);
+void test_node_config_apply_and_fallback(void);
+
+#endif // TEST_DOWNLINK_H
@@ -0,0 +1,8 @@
+#ifndef TEST_FEC_H
+#define TEST_FEC_H
+
+void test_fec_rebuilds_lost_frames(void);
+void test_fec_too_many_losses(void);
+void test_fec_group_closed_early(void);
+
+#endif // TEST_FEC_H
@@ -0,0 +1,8 @@
+#ifndef TEST_FRAG_H
+#define TEST_FRAG_H
+
+void test_frag_reassemble_out_of_order(void);
+void test_frag_timeout_eviction(void);
+void test_frag_pool_full_evicts_oldest(void);
+
+#endif // TEST_FRAG_H
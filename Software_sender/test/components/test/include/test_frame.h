@@ -0,0 +1,8 @@
+#ifndef TEST_FRAME_H
+#define TEST_FRAME_H
+
+void test_frame_measure_round_trip(void);
+void test_frame_invalid_channels(void);
+void test_frame_rejects_json(void);
+
+#endif // TEST_FRAME_H
@@ -0,0 +1,8 @@
+#ifndef TEST_LINK_H
+#define TEST_LINK_H
+
+void test_link_track_gaps_and_duplicates(void);
+void test_link_track_wrap_and_restart(void);
+void test_link_ack_frame(void);
+
+#endif // TEST_LINK_H
@@ -5,5 +5,14 @@ void test_lora_init(void);
 void test_lora_send(void);
 void test_lora_receive(void);
 void test_lora_config(void);
+void test_lora_tx_done(void);
+void test_lora_send_async(void);
+void test_lora_cad(void);
+void test_lora_sniff(void);
+void test_lora_channels(void);
+void test_lora_wait_timeout(void);
+void test_lora_config_shadow(void);
+void test_lora_ldro(void);
+void test_lora_spi_benchmark(void);
 
 #endif // TEST_LORA_H 
\ No newline at end of file
@@ -0,0 +1,6 @@
+#ifndef TEST_PIPELINE_H
+#define TEST_PIPELINE_H
+
+void test_pipeline_pinning_benchmark(void);
+
+#endif // TEST_PIPELINE_H
@@ -0,0 +1,8 @@
+#ifndef TEST_SAMPLING_H
+#define TEST_SAMPLING_H
+
+void test_sampling_stats_perfect_schedule(void);
+void test_sampling_stats_late_sample(void);
+void test_sampling_read_overrun(void);
+
+#endif // TEST_SAMPLING_H
@@ -0,0 +1,8 @@
+#ifndef TEST_SENSOR_HEALTH_H
+#define TEST_SENSOR_HEALTH_H
+
+void test_sensor_health_backoff_doubles(void);
+void test_sensor_health_backoff_capped(void);
+void test_sensor_health_recovers(void);
+
+#endif // TEST_SENSOR_HEALTH_H
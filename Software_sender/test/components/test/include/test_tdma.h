@@ -0,0 +1,8 @@
+#ifndef TEST_TDMA_H
+#define TEST_TDMA_H
+
+void test_beacon_round_trip(void);
+void test_tdma_drift_correction(void);
+void test_tdma_missed_and_search(void);
+
+#endif // TEST_TDMA_H
@@ -0,0 +1,8 @@
+#ifndef TEST_TSCOMP_H
+#define TEST_TSCOMP_H
+
+void test_tscomp_zigzag(void);
+void test_tscomp_round_trip(void);
+void test_tscomp_batch_split(void);
+
+#endif // TEST_TSCOMP_H
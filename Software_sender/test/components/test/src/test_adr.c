@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include "unity.h"
+#include "adr.h"
+#include "node_config.h"
+#include "sdkconfig.h"
+#include "test_adr.h"
+
+static int tests_passed = 0;
+
+void test_adr_decide_steps(void)
+{
+    const AdrParams one_sf = { .history = 4, .margin_db = 10, .sf_min = 7, .sf_max = 7 };
+    const AdrParams all_sf = { .history = 4, .margin_db = 10, .sf_min = 7, .sf_max = 12 };
+    uint8_t sf = 7, tx_power = 17;
+
+    // SF7 floor -7.5 dB: 9 dB SNR leaves 6.5 dB over the margin, two 3 dB steps
+    TEST_ASSERT_EQUAL_INT(1, adr_decide(9.0f, &one_sf, &sf, &tx_power));
+    TEST_ASSERT_EQUAL_UINT8(7, sf);
+    TEST_ASSERT_EQUAL_UINT8(11, tx_power);
+    TEST_ASSERT_EQUAL_INT(0, adr_decide(4.0f, &one_sf, &sf, &tx_power));   // Margin kept
+
+    // Short of margin: power back up
+    TEST_ASSERT_EQUAL_INT(1, adr_decide(-8.0f, &one_sf, &sf, &tx_power));
+    TEST_ASSERT_EQUAL_UINT8(17, tx_power);
+
+    // Spreading factor goes down before the power, and up after it
+    sf = 10;
+    TEST_ASSERT_EQUAL_INT(1, adr_decide(0.0f, &all_sf, &sf, &tx_power));
+    TEST_ASSERT_EQUAL_UINT8(9, sf);
+    TEST_ASSERT_EQUAL_UINT8(17, tx_power);
+    sf = 7;
+    TEST_ASSERT_EQUAL_INT(1, adr_decide(-20.0f, &all_sf, &sf, &tx_power));
+    TEST_ASSERT_EQUAL_UINT8(12, sf);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_adr_update_history(void)
+{
+    const AdrParams p = { .history = 4, .margin_db = 10, .sf_min = 7, .sf_max = 7 };
+    AdrPeers t = { 0 };
+    DownlinkConfig cfg;
+
+    // The best SNR of a whole history decides, new senders start at full power
+    TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 1, 2.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 2, 6.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 3, -3.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_INT(1, adr_update(&t, 0x1234, 4, 0.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_UINT8(1 << DOWNLINK_TX_POWER, cfg.set);
+    TEST_ASSERT_EQUAL_UINT8(14, cfg.tx_power);
+    TEST_ASSERT_EQUAL_INT(0, downlink_validate(&cfg));
+
+    // Settings sent from the API restart the history
+    DownlinkConfig api = { .set = 1 << DOWNLINK_TX_POWER, .tx_power = 2 };
+    adr_note_downlink(&t, 0x1234, &api);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 5 + i, -6.0f, 7, &p, &cfg));
+    }
+    TEST_ASSERT_EQUAL_INT(1, adr_update(&t, 0x1234, 8, -6.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_UINT8(11, cfg.tx_power);
+
+    // Frames lost, the sender may have stepped up: the next decision starts
+    // from full power, not from the 11 dBm last commanded
+    TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 9, 7.0f, 7, &p, &cfg));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(0, adr_update(&t, 0x1234, 13 + i, 7.0f, 7, &p, &cfg));
+    }
+    TEST_ASSERT_EQUAL_INT(1, adr_update(&t, 0x1234, 16, 7.0f, 7, &p, &cfg));
+    TEST_ASSERT_EQUAL_UINT8(14, cfg.tx_power);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_node_config_backoff(void)
+{
+    NodeConfig c;
+    node_config_defaults(&c);
+    c.sf = CONFIG_NODE_SF;
+    c.tx_power = 8;
+
+    // Confirmed low power that stops getting ACKs: +3 dB every 3 silent cycles
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(1, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_UINT8(11, c.tx_power);
+
+    // An ACK resets the count
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, true, 3));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(1, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_UINT8(14, c.tx_power);
+
+    // Nothing more robust than full power at the default spreading factor
+    c.tx_power = DOWNLINK_TX_POWER_MAX;
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    }
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
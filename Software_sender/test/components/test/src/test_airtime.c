@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include "unity.h"
+#include "lora_airtime.h"
+#include "test_airtime.h"
+
+static int tests_passed = 0;
+
+void test_airtime_known_values(void)
+{
+    // 20-byte payload, 8-symbol preamble, CR 4/5, explicit header, CRC on
+    LoraModem sf7 = { .sf = 7, .bw_hz = 125000, .cr = 1, .preamble = 8, .crc = true };
+    LoraModem sf12 = { .sf = 12, .bw_hz = 125000, .cr = 1, .preamble = 8, .crc = true, .ldro = true };
+    TEST_ASSERT_EQUAL_UINT32(56576, lora_airtime_us(&sf7, 20));
+    TEST_ASSERT_EQUAL_UINT32(1318912, lora_airtime_us(&sf12, 20));
+
+    // No PHY header: 20 bits less to send, one symbol group saved here
+    LoraModem implicit = sf7;
+    implicit.implicit = true;
+    TEST_ASSERT_LESS_THAN_UINT32(lora_airtime_us(&sf7, 20), lora_airtime_us(&implicit, 20));
+
+    // FSK at 50 kbit/s: 5-byte preamble, 3-byte sync word, length byte, 10 bytes, CRC
+    TEST_ASSERT_EQUAL_UINT32(3360, lora_fsk_airtime_us(50000, 5, 3, 10));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_airtime_budget(void)
+{
+    // 1% over an hour: 36 s of airtime, refilled at 10 ms per second
+    LoraAirtimeBudget b = { 0 };
+    lora_budget_reset(&b, 10, 3600, 0);
+    TEST_ASSERT_EQUAL_INT64(36000000, lora_budget_left_us(&b, 0));
+
+    lora_budget_consume(&b, 35000000);
+    TEST_ASSERT_EQUAL_INT64(0, lora_budget_wait_us(&b, 1000000, 0));
+    TEST_ASSERT_EQUAL_INT64(100000000, lora_budget_wait_us(&b, 2000000, 0));
+    TEST_ASSERT_EQUAL_INT64(0, lora_budget_wait_us(&b, 2000000, 100000000));
+    TEST_ASSERT_EQUAL_INT64(-1, lora_budget_wait_us(&b, 40000000, 100000000));
+
+    // A clock jump fills the budget without overflowing, a step back earns nothing
+    TEST_ASSERT_EQUAL_INT64(36000000, lora_budget_left_us(&b, 1000000000000000LL));
+    lora_budget_consume(&b, 6000000);
+    TEST_ASSERT_EQUAL_INT64(30000000, lora_budget_left_us(&b, 0));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
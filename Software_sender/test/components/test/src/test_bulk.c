@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "bulk.h"
+#include "test_bulk.h"
+
+static int tests_passed = 0;
+
+void test_bulk_round_trip(void)
+{
+    FrameHeader hdr = { .device_id = 0x1234, .seq = 7 };
+    FrameMeasure meas = { .hdr = { .device_id = 0x1234, .seq = 3 }, .valid = 0x01, .temp = 21.5f };
+    uint8_t inner[FRAME_MEASURE_LEN];
+    frame_encode_measure(&meas, inner, sizeof(inner));
+
+    // A frame of the backlog, its last sample one hour old
+    BulkMsg in = { .op = BULK_DATA, .age_s = 3600, .frame = inner, .frame_len = sizeof(inner) };
+    uint8_t buf[FRAME_MAX_LEN];
+    int n = bulk_encode(&hdr, &in, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(BULK_DATA_HEADER_LEN + FRAME_MEASURE_LEN, n);
+
+    FrameHeader h;
+    BulkMsg out;
+    TEST_ASSERT_EQUAL_INT(0, bulk_decode(buf, n, &h, &out));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TYPE_BULK, h.type);
+    TEST_ASSERT_EQUAL_UINT16(0x1234, h.device_id);
+    TEST_ASSERT_EQUAL_UINT8(7, h.seq);
+    TEST_ASSERT_EQUAL_UINT8(BULK_DATA, out.op);
+    TEST_ASSERT_EQUAL_UINT32(3600, out.age_s);
+    TEST_ASSERT_EQUAL_INT(sizeof(inner), out.frame_len);
+    TEST_ASSERT_EQUAL_MEMORY(inner, out.frame, sizeof(inner));
+
+    // Control messages
+    in = (BulkMsg){ .op = BULK_REQUEST, .count = 20 };
+    TEST_ASSERT_EQUAL_INT(BULK_CONTROL_LEN, bulk_encode(&hdr, &in, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_INT(0, bulk_decode(buf, BULK_CONTROL_LEN, &h, &out));
+    TEST_ASSERT_EQUAL_UINT8(BULK_REQUEST, out.op);
+    TEST_ASSERT_EQUAL_UINT8(20, out.count);
+    in = (BulkMsg){ .op = BULK_END };
+    TEST_ASSERT_EQUAL_INT(BULK_END_LEN, bulk_encode(&hdr, &in, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_INT(0, bulk_decode(buf, BULK_END_LEN, &h, &out));
+    TEST_ASSERT_EQUAL_UINT8(BULK_END, out.op);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_bulk_rejects_invalid(void)
+{
+    FrameHeader hdr = { .device_id = 1, .seq = 1 };
+    uint8_t buf[FRAME_MAX_LEN];
+    uint8_t nested[BULK_END_LEN];
+
+    // Nothing to send is not a request
+    BulkMsg m = { .op = BULK_REQUEST, .count = 0 };
+    TEST_ASSERT_EQUAL_INT(-1, bulk_encode(&hdr, &m, buf, sizeof(buf)));
+
+    // A transfer message is not carried by another one
+    m = (BulkMsg){ .op = BULK_END };
+    bulk_encode(&hdr, &m, nested, sizeof(nested));
+    m = (BulkMsg){ .op = BULK_DATA, .frame = nested, .frame_len = sizeof(nested) };
+    TEST_ASSERT_EQUAL_INT(-1, bulk_encode(&hdr, &m, buf, sizeof(buf)));
+
+    FrameHeader h;
+    BulkMsg out;
+    m = (BulkMsg){ .op = BULK_ACCEPT, .count = 0 };   // Refusal
+    int n = bulk_encode(&hdr, &m, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(0, bulk_decode(buf, n, &h, &out));
+    TEST_ASSERT_EQUAL_INT(-1, bulk_decode(buf, n - 1, &h, &out));   // Truncated
+    buf[4] = 0x7f;
+    TEST_ASSERT_EQUAL_INT(-1, bulk_decode(buf, n, &h, &out));       // Unknown operation
+
+    // A plain ACK is not a transfer message
+    TEST_ASSERT_EQUAL_INT(FRAME_ACK_LEN, frame_encode_ack(&hdr, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_INT(-1, bulk_decode(buf, FRAME_ACK_LEN, &h, &out));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
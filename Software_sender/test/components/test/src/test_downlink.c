@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "downlink.h"
+#include "node_config.h"
+#include "test_downlink.h"
+
+static int tests_passed = 0;
+
+void test_downlink_round_trip(void)
+{
+    FrameHeader acked = { .device_id = 0x1234, .seq = 42 };
+    DownlinkConfig cfg = {
+        .set = (1 << DOWNLINK_SLEEP_S) | (1 << DOWNLINK_SF) | (1 << DOWNLINK_SAMPLE_PERIOD_MS),
+        .sleep_s = 600,
+        .sample_period_ms = 250,
+        .sf = 9,
+    };
+    uint8_t buf[DOWNLINK_MAX_LEN];
+    int n = downlink_encode(&acked, &cfg, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(FRAME_HEADER_LEN + 3 + 3 + 2, n);
+
+    // Also an ACK of the same frame
+    FrameHeader hdr;
+    DownlinkConfig out;
+    TEST_ASSERT_EQUAL_INT(0, downlink_decode(buf, n, &hdr, &out));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TYPE_CONFIG, hdr.type);
+    TEST_ASSERT_EQUAL_UINT16(0x1234, hdr.device_id);
+    TEST_ASSERT_EQUAL_UINT8(42, hdr.seq);
+    TEST_ASSERT_EQUAL_UINT8(cfg.set, out.set);
+    TEST_ASSERT_EQUAL_UINT16(600, out.sleep_s);
+    TEST_ASSERT_EQUAL_UINT16(250, out.sample_period_ms);
+    TEST_ASSERT_EQUAL_UINT8(9, out.sf);
+
+    // Every command at once
+    cfg.set |= (1 << DOWNLINK_SAMPLE_COUNT) | (1 << DOWNLINK_TX_POWER);
+    cfg.sample_count = 5;
+    cfg.tx_power = 10;
+    TEST_ASSERT_EQUAL_INT(DOWNLINK_MAX_LEN, downlink_encode(&acked, &cfg, buf, sizeof(buf)));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_downlink_rejects_invalid(void)
+{
+    FrameHeader acked = { .device_id = 1, .seq = 1 };
+    DownlinkConfig cfg = { .set = 1 << DOWNLINK_SF, .sf = 13 };
+    uint8_t buf[DOWNLINK_MAX_LEN];
+    TEST_ASSERT_EQUAL_INT(-1, downlink_encode(&acked, &cfg, buf, sizeof(buf)));
+    cfg = (DownlinkConfig){ 0 };
+    TEST_ASSERT_EQUAL_INT(-1, downlink_encode(&acked, &cfg, buf, sizeof(buf)));   // Empty
+
+    cfg = (DownlinkConfig){ .set = 1 << DOWNLINK_SAMPLE_COUNT, .sample_count = 8 };
+    int n = downlink_encode(&acked, &cfg, buf, sizeof(buf));
+    FrameHeader hdr;
+    DownlinkConfig out;
+    TEST_ASSERT_EQUAL_INT(-1, downlink_decode(buf, n - 1, &hdr, &out));   // Truncated value
+    buf[FRAME_HEADER_LEN] = 0x7f;
+    TEST_ASSERT_EQUAL_INT(-1, downlink_decode(buf, n, &hdr, &out));       // Unknown command
+    buf[FRAME_HEADER_LEN] = DOWNLINK_SAMPLE_COUNT;
+    buf[FRAME_HEADER_LEN + 1] = DOWNLINK_SAMPLES_MAX + 1;
+    TEST_ASSERT_EQUAL_INT(-1, downlink_decode(buf, n, &hdr, &out));       // Out of range
+
+    // A plain ACK is not a configuration frame
+    TEST_ASSERT_EQUAL_INT(FRAME_ACK_LEN, frame_encode_ack(&acked, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_INT(-1, downlink_decode(buf, FRAME_ACK_LEN, &hdr, &out));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_node_config_apply_and_fallback(void)
+{
+    NodeConfig c;
+    node_config_defaults(&c);
+    c.sf = 7;
+    c.tx_power = 17;
+
+    // Window longer than allowed: nothing changes
+    DownlinkConfig dl = { .set = 1 << DOWNLINK_SAMPLE_COUNT, .sample_count = 30 };
+    NodeConfig before = c;
+    TEST_ASSERT_EQUAL_INT(-1, node_config_apply(&c, &dl, (30 - 1) * c.sample_period_ms - 1));
+    TEST_ASSERT_EQUAL_MEMORY(&before, &c, sizeof(c));
+
+    dl = (DownlinkConfig){ .set = 1 << DOWNLINK_SLEEP_S, .sleep_s = 300 };
+    TEST_ASSERT_EQUAL_INT(1, node_config_apply(&c, &dl, 60000));
+    TEST_ASSERT_EQUAL_UINT16(300, c.sleep_s);
+    TEST_ASSERT_EQUAL_INT(0, node_config_apply(&c, &dl, 60000));   // Repeated downlink
+    TEST_ASSERT_EQUAL_UINT8(0, c.fallback_sf);
+
+    // Radio change confirmed by an ACK
+    dl = (DownlinkConfig){ .set = 1 << DOWNLINK_SF, .sf = 10 };
+    TEST_ASSERT_EQUAL_INT(1, node_config_apply(&c, &dl, 60000));
+    TEST_ASSERT_EQUAL_UINT8(7, c.fallback_sf);
+    TEST_ASSERT_EQUAL_INT(1, node_config_link_result(&c, true, 3));
+    TEST_ASSERT_EQUAL_UINT8(10, c.sf);
+    TEST_ASSERT_EQUAL_UINT8(0, c.fallback_sf);
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));   // Nothing to undo
+
+    // Radio change that loses the receiver is undone after 3 cycles
+    dl = (DownlinkConfig){ .set = (1 << DOWNLINK_SF) | (1 << DOWNLINK_TX_POWER), .sf = 12, .tx_power = 2 };
+    TEST_ASSERT_EQUAL_INT(1, node_config_apply(&c, &dl, 60000));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(0, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_INT(1, node_config_link_result(&c, false, 3));
+    TEST_ASSERT_EQUAL_UINT8(10, c.sf);
+    TEST_ASSERT_EQUAL_UINT8(17, c.tx_power);
+    TEST_ASSERT_EQUAL_UINT16(300, c.sleep_s);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
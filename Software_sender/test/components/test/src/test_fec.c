@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "fec.h"
+#include "test_fec.h"
+
+static int tests_passed = 0;
+static FecDecoder s_dec;
+static uint8_t s_frames[FEC_MAX_K][FRAME_MEASURE_LEN];
+static uint8_t s_repairs[FEC_MAX_M][FRAME_MAX_LEN];
+static int s_repair_lens[FEC_MAX_M];
+
+/**
+ * @brief Encode k measurement frames from seq and their m repair frames.
+ */
+static void make_group(int k, int m, uint8_t seq)
+{
+    FecEncoder e;
+    fec_encoder_init(&e, k, m);
+    for (int i = 0; i < k; i++) {
+        FrameMeasure fm = {
+            .hdr = { .device_id = 0x55, .seq = (uint8_t)(seq + i) },
+            .valid = 0x0f, .temp = 20.0f + i, .press = 1000.0f + i, .hum = 40.0f, .sound = 50.0f,
+        };
+        frame_encode_measure(&fm, s_frames[i], sizeof(s_frames[i]));
+        TEST_ASSERT_EQUAL_INT(i + 1, fec_encoder_add(&e, s_frames[i], FRAME_MEASURE_LEN));
+    }
+    for (int j = 0; j < m; j++) {
+        s_repair_lens[j] = fec_encode_repair(&e, 0x55, j, s_repairs[j], sizeof(s_repairs[j]));
+        // Length byte and frame, no padding for equal-length frames
+        TEST_ASSERT_EQUAL_INT(FEC_HEADER_LEN + 1 + FRAME_MEASURE_LEN, s_repair_lens[j]);
+    }
+}
+
+void test_fec_rebuilds_lost_frames(void)
+{
+    make_group(8, 2, 250);   // Sequence numbers wrap inside the group
+    fec_decoder_init(&s_dec, 0x55);
+    for (int i = 0; i < 8; i++) {
+        if (i != 1 && i != 6) {
+            fec_decoder_add_data(&s_dec, (uint8_t)(250 + i), s_frames[i], FRAME_MEASURE_LEN);
+        }
+    }
+
+    FecRecovered rec[FEC_MAX_M];
+    TEST_ASSERT_EQUAL_INT(0, fec_decoder_add_repair(&s_dec, s_repairs[1], s_repair_lens[1], rec, FEC_MAX_M));
+    TEST_ASSERT_EQUAL_INT(2, fec_decoder_add_repair(&s_dec, s_repairs[0], s_repair_lens[0], rec, FEC_MAX_M));
+    TEST_ASSERT_EQUAL_UINT8(251, rec[0].seq);
+    TEST_ASSERT_EQUAL_UINT8(0, rec[1].seq);
+    TEST_ASSERT_EQUAL_INT(FRAME_MEASURE_LEN, rec[0].len);
+    TEST_ASSERT_EQUAL_MEMORY(s_frames[1], rec[0].frame, FRAME_MEASURE_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(s_frames[6], rec[1].frame, FRAME_MEASURE_LEN);
+    TEST_ASSERT_EQUAL_UINT32(2, s_dec.recovered);
+
+    // The group is done, a late repair changes nothing
+    TEST_ASSERT_EQUAL_INT(0, fec_decoder_add_repair(&s_dec, s_repairs[1], s_repair_lens[1], rec, FEC_MAX_M));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_fec_too_many_losses(void)
+{
+    make_group(4, 1, 10);
+    fec_decoder_init(&s_dec, 0x55);
+    fec_decoder_add_data(&s_dec, 10, s_frames[0], FRAME_MEASURE_LEN);
+    fec_decoder_add_data(&s_dec, 13, s_frames[3], FRAME_MEASURE_LEN);
+
+    FecRecovered rec[FEC_MAX_M];
+    TEST_ASSERT_EQUAL_INT(0, fec_decoder_add_repair(&s_dec, s_repairs[0], s_repair_lens[0], rec, FEC_MAX_M));
+
+    // The next group's first repair closes this one: its two frames are lost
+    make_group(4, 1, 14);
+    // (a data frame is not taken for a repair frame)
+    TEST_ASSERT_EQUAL_INT(-1, fec_decoder_add_repair(&s_dec, s_frames[0], FRAME_MEASURE_LEN, rec, FEC_MAX_M));
+    fec_decoder_add_repair(&s_dec, s_repairs[0], s_repair_lens[0], rec, FEC_MAX_M);
+    TEST_ASSERT_EQUAL_UINT32(2, s_dec.unrecoverable);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_fec_group_closed_early(void)
+{
+    FecEncoder e;
+    uint8_t repair[FRAME_MAX_LEN];
+    make_group(4, 1, 20);
+    fec_encoder_init(&e, 4, 1);
+    TEST_ASSERT_EQUAL_INT(-1, fec_encode_repair(&e, 0x55, 0, repair, sizeof(repair)));
+
+    TEST_ASSERT_EQUAL_INT(1, fec_encoder_add(&e, s_frames[0], FRAME_MEASURE_LEN));
+    TEST_ASSERT_EQUAL_INT(-1, fec_encoder_add(&e, s_frames[2], FRAME_MEASURE_LEN));   // 21 was skipped
+    int len = fec_encode_repair(&e, 0x55, 0, repair, sizeof(repair));
+    TEST_ASSERT_EQUAL_UINT8(1, repair[4]);   // k of the partial group
+
+    // A one-frame group: its repair rebuilds the frame alone
+    fec_decoder_init(&s_dec, 0x55);
+    FecRecovered rec[FEC_MAX_M];
+    TEST_ASSERT_EQUAL_INT(1, fec_decoder_add_repair(&s_dec, repair, len, rec, FEC_MAX_M));
+    TEST_ASSERT_EQUAL_MEMORY(s_frames[0], rec[0].frame, FRAME_MEASURE_LEN);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "frag.h"
+#include "test_frag.h"
+
+#define TEST_FRAG_LEN 51
+
+static int tests_passed = 0;
+static FragReasm s_reasm;
+static uint8_t s_packets[FRAG_MAX_COUNT][TEST_FRAG_LEN];
+static int s_packet_len[FRAG_MAX_COUNT];
+
+/**
+ * @brief Split a test message into s_packets, return the fragment count.
+ */
+static int split(uint16_t device_id, uint8_t msg_id, const uint8_t *msg, int len)
+{
+    FrameHeader hdr = { .device_id = device_id };
+    int count = frag_count(len, TEST_FRAG_LEN);
+    for (int i = 0; i < count; i++) {
+        hdr.seq = i;
+        s_packet_len[i] = frag_encode(&hdr, msg_id, msg, len, TEST_FRAG_LEN, i,
+                                      s_packets[i], sizeof(s_packets[i]));
+        TEST_ASSERT_GREATER_THAN(0, s_packet_len[i]);
+        TEST_ASSERT_LESS_OR_EQUAL(TEST_FRAG_LEN, s_packet_len[i]);
+    }
+    return count;
+}
+
+static int push(int i, uint32_t now_ms, const uint8_t **msg)
+{
+    FrameFragment f;
+    TEST_ASSERT_EQUAL_INT(0, frag_parse(s_packets[i], s_packet_len[i], &f));
+    return frag_reasm_push(&s_reasm, &f, now_ms, msg);
+}
+
+void test_frag_reassemble_out_of_order(void)
+{
+    uint8_t msg[240];
+    for (int i = 0; i < (int)sizeof(msg); i++) {
+        msg[i] = (uint8_t)(i * 7);
+    }
+    frag_reasm_init(&s_reasm);
+    int count = split(0x1234, 9, msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_INT(6, count);   // 42 payload bytes per fragment
+
+    // Reverse order with a duplicate, the message completes on the last missing one
+    const uint8_t *out = NULL;
+    for (int i = count - 1; i > 0; i--) {
+        TEST_ASSERT_EQUAL_INT(0, push(i, 100, &out));
+    }
+    TEST_ASSERT_EQUAL_INT(0, push(3, 110, &out));
+    TEST_ASSERT_EQUAL_INT(sizeof(msg), push(0, 120, &out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, out, sizeof(msg));
+    TEST_ASSERT_EQUAL_UINT32(1, s_reasm.completed);
+    TEST_ASSERT_EQUAL_UINT32(0, s_reasm.evicted);
+
+    // A truncated fragment is rejected by the parser
+    FrameFragment f;
+    TEST_ASSERT_EQUAL_INT(-1, frag_parse(s_packets[0], s_packet_len[0] - 1, &f));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_frag_timeout_eviction(void)
+{
+    uint8_t msg[100] = { 0 };
+    const uint8_t *out;
+    frag_reasm_init(&s_reasm);
+    split(1, 1, msg, sizeof(msg));
+
+    TEST_ASSERT_EQUAL_INT(0, push(0, 1000, &out));
+    TEST_ASSERT_EQUAL_INT(0, frag_reasm_expire(&s_reasm, 1000 + CONFIG_FRAME_REASM_TIMEOUT_MS - 1));
+    TEST_ASSERT_EQUAL_INT(1, frag_reasm_expire(&s_reasm, 1000 + CONFIG_FRAME_REASM_TIMEOUT_MS));
+
+    // The late fragment starts a new partial message instead of completing the old one
+    TEST_ASSERT_EQUAL_INT(0, push(1, 1000 + CONFIG_FRAME_REASM_TIMEOUT_MS, &out));
+    TEST_ASSERT_EQUAL_UINT32(1, s_reasm.evicted);
+    TEST_ASSERT_EQUAL_UINT32(0, s_reasm.completed);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_frag_pool_full_evicts_oldest(void)
+{
+    uint8_t msg[100] = { 0 };
+    const uint8_t *out;
+    frag_reasm_init(&s_reasm);
+
+    // One partial message per slot, device 0 is the least recently updated
+    for (int d = 0; d < CONFIG_FRAME_REASM_SLOTS; d++) {
+        split(d, 0, msg, sizeof(msg));
+        TEST_ASSERT_EQUAL_INT(0, push(0, 10 + d, &out));
+    }
+    split(100, 0, msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_INT(0, push(0, 50, &out));
+    TEST_ASSERT_EQUAL_UINT32(1, s_reasm.evicted);
+
+    // Device 1 kept its slot and completes
+    split(1, 0, msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_INT(0, push(1, 60, &out));
+    TEST_ASSERT_EQUAL_INT(sizeof(msg), push(2, 60, &out));
+    TEST_ASSERT_EQUAL_UINT32(1, s_reasm.evicted);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
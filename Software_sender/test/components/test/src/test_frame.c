@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "unity.h"
+#include "frame.h"
+#include "test_frame.h"
+
+static int tests_passed = 0;
+
+void test_frame_measure_round_trip(void)
+{
+    FrameMeasure in = {
+        .hdr = { .device_id = 0x1234, .seq = 200 },
+        .valid = 0x0f,
+        .temp = -5.27f,
+        .press = 1013.25f,
+        .hum = 45.6f,
+        .sound = 55.26f,
+    };
+    uint8_t buf[FRAME_MEASURE_LEN];
+    TEST_ASSERT_EQUAL_INT(FRAME_MEASURE_LEN, frame_encode_measure(&in, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_UINT8((FRAME_VERSION << 4) | FRAME_TYPE_MEASURE, buf[0]);
+
+    FrameMeasure out;
+    TEST_ASSERT_EQUAL_INT(0, frame_decode_measure(buf, sizeof(buf), &out));
+    TEST_ASSERT_EQUAL_UINT16(0x1234, out.hdr.device_id);
+    TEST_ASSERT_EQUAL_UINT8(200, out.hdr.seq);
+    TEST_ASSERT_EQUAL_UINT8(0x0f, out.valid);
+    // Field resolution: 0.01 °C, 0.1 hPa, 0.5 %RH, 0.01 dB
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.temp, out.temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, in.press, out.press);
+    TEST_ASSERT_FLOAT_WITHIN(0.25f, in.hum, out.hum);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.sound, out.sound);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_frame_invalid_channels(void)
+{
+    FrameMeasure in = {
+        .hdr = { .device_id = 1, .seq = 0 },
+        .valid = 0x05,              // press and sound missed their deadline
+        .temp = 20.0f,
+        .press = NAN,
+        .hum = 50.0f,
+        .sound = 70.0f,
+    };
+    uint8_t buf[FRAME_MEASURE_LEN];
+    FrameMeasure out;
+    frame_encode_measure(&in, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(0, frame_decode_measure(buf, sizeof(buf), &out));
+    TEST_ASSERT_EQUAL_UINT8(0x05, out.valid);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, out.press);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, out.sound);
+
+    // Too small output buffer
+    TEST_ASSERT_EQUAL_INT(-1, frame_encode_measure(&in, buf, FRAME_MEASURE_LEN - 1));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_frame_rejects_json(void)
+{
+    const char *json = "{\"temp\":21.50}";
+    FrameHeader hdr;
+    FrameMeasure m;
+    TEST_ASSERT_EQUAL_INT(-1, frame_parse_header((const uint8_t *)json, strlen(json), &hdr));
+    TEST_ASSERT_EQUAL_INT(-1, frame_decode_measure((const uint8_t *)json, strlen(json), &m));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
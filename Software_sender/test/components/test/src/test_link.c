@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "link.h"
+#include "test_link.h"
+
+static int tests_passed = 0;
+
+void test_link_track_gaps_and_duplicates(void)
+{
+    LinkPeers t;
+    memset(&t, 0, sizeof(t));
+
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 0xabcd, 10));
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 0xabcd, 11));
+    TEST_ASSERT_EQUAL_INT(0, link_track(&t, 0xabcd, 11));   // ACK lost, sent again
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 0xabcd, 14));   // 12 and 13 never arrived
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 0x0001, 14));   // Other sender, own counters
+
+    const LinkPeer *p = &t.peers[0];
+    TEST_ASSERT_EQUAL_UINT16(0xabcd, p->device_id);
+    TEST_ASSERT_EQUAL_UINT32(3, p->received);
+    TEST_ASSERT_EQUAL_UINT32(2, p->missed);
+    TEST_ASSERT_EQUAL_UINT32(1, p->duplicates);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.6f, link_peer_ratio(p));
+    TEST_ASSERT_EQUAL_UINT32(1, t.peers[1].received);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_link_track_wrap_and_restart(void)
+{
+    LinkPeers t;
+    memset(&t, 0, sizeof(t));
+
+    link_track(&t, 7, 254);
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 7, 255));
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 7, 1));     // Wraps, 0 is missed
+    TEST_ASSERT_EQUAL_UINT32(1, t.peers[0].missed);
+
+    // Sender lost its RTC memory and counts from 0 again: a new frame, not a gap
+    link_track(&t, 7, 120);
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 7, 0));
+    TEST_ASSERT_EQUAL_UINT32(1 + 118, t.peers[0].missed);
+    TEST_ASSERT_EQUAL_UINT8(0, t.peers[0].last_seq);
+
+    // Frame 2 rebuilt by FEC after 3 and 4: late, no longer missed
+    link_track(&t, 7, 1);
+    link_track(&t, 7, 3);
+    link_track(&t, 7, 4);
+    uint32_t missed = t.peers[0].missed;
+    TEST_ASSERT_EQUAL_INT(1, link_track(&t, 7, 2));
+    TEST_ASSERT_EQUAL_UINT32(missed - 1, t.peers[0].missed);
+    TEST_ASSERT_EQUAL_UINT8(4, t.peers[0].last_seq);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_link_ack_frame(void)
+{
+    FrameHeader hdr = { .type = FRAME_TYPE_MEASURE, .device_id = 0x4321, .seq = 77 };
+    uint8_t ack[FRAME_ACK_LEN];
+    TEST_ASSERT_EQUAL_INT(FRAME_ACK_LEN, frame_encode_ack(&hdr, ack, sizeof(ack)));
+
+    FrameHeader out;
+    TEST_ASSERT_EQUAL_INT(0, frame_parse_header(ack, sizeof(ack), &out));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TYPE_ACK, out.type);
+    TEST_ASSERT_EQUAL_UINT16(0x4321, out.device_id);
+    TEST_ASSERT_EQUAL_UINT8(77, out.seq);
+    TEST_ASSERT_EQUAL_INT(-1, frame_encode_ack(&hdr, ack, FRAME_ACK_LEN - 1));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -3,10 +3,21 @@
 #include "unity.h"
 #include "lora.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
+#include "diag.h"
 #include "test_lora.h"
 
+#define REG_MODEM_CONFIG_1 0x1d
+#define REG_MODEM_CONFIG_2 0x1e
+#define REG_MODEM_CONFIG_3 0x26
+#define BENCH_REG          0x39   // RegSyncWord, rewritten with its own value
+#define BENCH_ACCESSES     1000
+#define BENCH_SEQ_LEN      16     // Writes per lora_write_reg_seq() call
+#define BENCH_ALLOC_STATE  1      // diag state the packet allocations are counted in
+
 static int tests_passed = 0;
 
 void tearDown_lora(void)
@@ -68,4 +79,238 @@ void test_lora_config(void)
     
     printf("Test %s PASSED\n", __func__);
     tests_passed++;
-} 
\ No newline at end of file
+}
+
+void test_lora_tx_done(void)
+{
+    // TxDone must arrive (DIO0 interrupt or polling) well before the timeout
+    const char *test_message = "TxDone";
+    int lost = lora_packet_lost();
+    int64_t start = esp_timer_get_time();
+    lora_send_packet((uint8_t *)test_message, strlen(test_message));
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    printf("lora_send_packet: %lld us\n", elapsed_us);
+    TEST_ASSERT_EQUAL_INT(lost, lora_packet_lost());
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+static void tx_done_cb(const LoraTxResult *res, void *arg)
+{
+    *(LoraTxResult *)arg = *res;
+}
+
+void test_lora_send_async(void)
+{
+    // The call returns once the packet is on air, the callback reports its end
+    const char *test_message = "Async";
+    LoraTxResult res = { 0 };
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL_INT(0, lora_send_packet_async((uint8_t *)test_message, strlen(test_message),
+                                                    tx_done_cb, &res));
+    int64_t call_us = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL_INT(1, lora_send_wait(1000, NULL));
+    printf("lora_send_packet_async: %lld us, TxDone after %lld us (%lu us computed)\n",
+           call_us, res.done_us - res.start_us, (unsigned long)res.airtime_us);
+    TEST_ASSERT_EQUAL_INT(LORA_TX_OK, res.status);
+    TEST_ASSERT_LESS_THAN(res.airtime_us / 2, call_us);
+    TEST_ASSERT_GREATER_OR_EQUAL(res.airtime_us * 9 / 10, res.done_us - res.start_us);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_cad(void)
+{
+    // Quiet bench: CadDone comes within a few symbols and finds no preamble
+    const LoraLbtStats *lbt = lora_lbt_stats();
+    uint32_t cad = lbt->cad;
+    int64_t start = esp_timer_get_time();
+    int busy = lora_cad();
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    printf("lora_cad: %d in %lld us\n", busy, elapsed_us);
+    TEST_ASSERT_EQUAL_INT(0, busy);
+    TEST_ASSERT_EQUAL_UINT32(cad + 1, lbt->cad);
+
+#if CONFIG_LORA_LBT_ENABLE
+    // Every packet is preceded by a CAD
+    const char *test_message = "LBT";
+    lora_send_packet((uint8_t *)test_message, strlen(test_message));
+    TEST_ASSERT_EQUAL_UINT32(cad + 2, lbt->cad);
+#endif
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_sniff(void)
+{
+    // SF7 at 125 kHz: 1024 us symbols, the preamble covers the sleep, a tick and 8 symbols
+    int sf = lora_get_spreading_factor();
+    lora_set_spreading_factor(7);
+    lora_set_bandwidth(7);
+    uint32_t airtime_us = lora_time_on_air_us(12);
+    lora_sniff_config(200);
+    long expected = ((200 + portTICK_PERIOD_MS) * 1000L + 1023) / 1024 + 8;
+#if CONFIG_LORA_CHANNEL_COUNT > 1
+    // Plus the CADs on the other channels
+    TEST_ASSERT_GREATER_THAN(expected, lora_get_preamble_length());
+    expected = lora_get_preamble_length();
+#endif
+    TEST_ASSERT_EQUAL_INT(expected, lora_get_preamble_length());
+    TEST_ASSERT_EQUAL_INT(airtime_us + (expected - 8) * 1024, lora_time_on_air_us(12));
+
+    // Quiet bench: every wake is a CAD without detection, most of the time is asleep
+    const LoraSniffStats *sn = lora_sniff_stats();
+    uint32_t cad = sn->cad;
+    TEST_ASSERT_EQUAL_INT(0, lora_sniff_wait(1000));
+    printf("lora_sniff_wait: %lu CADs, radio %d uA\n", (unsigned long)(sn->cad - cad), lora_sniff_current_ua());
+    TEST_ASSERT_GREATER_OR_EQUAL(cad + 4, sn->cad);
+    TEST_ASSERT_LESS_THAN(1000, lora_sniff_current_ua());
+
+    lora_set_preamble_length(8);
+    lora_set_spreading_factor(sf);
+    lora_idle();
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_channels(void)
+{
+    // Indexes past the plan wrap around
+    lora_set_channel(CONFIG_LORA_CHANNEL_COUNT);
+    TEST_ASSERT_EQUAL_INT(0, lora_get_channel());
+    lora_set_channel(CONFIG_LORA_CHANNEL_COUNT - 1);
+    TEST_ASSERT_EQUAL_INT(CONFIG_LORA_CHANNEL_COUNT - 1, lora_get_channel());
+
+    // Hops stay in the plan, a device always gets the same channel
+    for (int i = 0; i < 20; i++) {
+        lora_channel_hop(0x1234);
+        TEST_ASSERT_LESS_THAN(CONFIG_LORA_CHANNEL_COUNT, lora_get_channel());
+#if CONFIG_LORA_CHANNEL_BY_DEVICE
+        TEST_ASSERT_EQUAL_INT(0x1234 % CONFIG_LORA_CHANNEL_COUNT, lora_get_channel());
+#endif
+    }
+
+    // Scanning only: the preamble covers a CAD on every other channel
+    int sf = lora_get_spreading_factor();
+    lora_set_spreading_factor(7);
+    lora_set_bandwidth(7);
+    lora_sniff_config(0);
+    TEST_ASSERT_GREATER_OR_EQUAL(8 + (CONFIG_LORA_CHANNEL_COUNT - 1) * 2, lora_get_preamble_length());
+
+    lora_set_preamble_length(8);
+    lora_set_spreading_factor(sf);
+    lora_set_channel(0);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_wait_timeout(void)
+{
+    // No transmitter on the air: the wait ends on its timeout, not before
+    lora_receive();
+    int64_t start = esp_timer_get_time();
+    int received = lora_wait_received(50);
+    int64_t elapsed_ms = (esp_timer_get_time() - start) / 1000;
+    lora_idle();
+    TEST_ASSERT_EQUAL_INT(0, received);
+    TEST_ASSERT_GREATER_OR_EQUAL(40, elapsed_ms);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_config_shadow(void)
+{
+    // Inside a batch the getters already see the new values, the radio does not
+    int sf = lora_get_spreading_factor();
+    lora_config_begin();
+    lora_set_spreading_factor(9);
+    lora_set_coding_rate(2);
+    TEST_ASSERT_EQUAL_INT(9, lora_get_spreading_factor());
+    TEST_ASSERT_EQUAL_INT(2, lora_get_coding_rate());
+    TEST_ASSERT_EQUAL_INT(sf, lora_read_reg(REG_MODEM_CONFIG_2) >> 4);
+    lora_config_commit();
+
+    // After the commit the radio holds the shadow
+    TEST_ASSERT_EQUAL_INT(9, lora_read_reg(REG_MODEM_CONFIG_2) >> 4);
+    TEST_ASSERT_EQUAL_INT(2, (lora_read_reg(REG_MODEM_CONFIG_1) & 0x0e) >> 1);
+
+    lora_set_spreading_factor(sf);
+    lora_set_coding_rate(1);
+    TEST_ASSERT_EQUAL_INT(sf, lora_read_reg(REG_MODEM_CONFIG_2) >> 4);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_ldro(void)
+{
+    // Symbols over 16 ms need LowDataRateOptimize, and it counts in the time on air
+    int sf = lora_get_spreading_factor();
+    int bw = lora_get_bandwidth();
+    lora_set_bandwidth(7);   // 125 kHz
+    lora_set_spreading_factor(12);
+    TEST_ASSERT_EQUAL_INT(0x08, lora_read_reg(REG_MODEM_CONFIG_3) & 0x08);
+    lora_set_spreading_factor(10);
+    TEST_ASSERT_EQUAL_INT(0, lora_read_reg(REG_MODEM_CONFIG_3) & 0x08);
+    lora_set_bandwidth(6);   // 62.5 kHz, SF10 symbols last 16.4 ms
+    TEST_ASSERT_EQUAL_INT(0x08, lora_read_reg(REG_MODEM_CONFIG_3) & 0x08);
+
+    lora_set_bandwidth(bw);
+    lora_set_spreading_factor(sf);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_lora_spi_benchmark(void)
+{
+    // Register access latency: polling transactions against a queued sequence
+    int sync = lora_read_reg(BENCH_REG);
+    LoraRegWrite seq[BENCH_SEQ_LEN];
+    for (int i = 0; i < BENCH_SEQ_LEN; i++) {
+        seq[i] = (LoraRegWrite){ BENCH_REG, sync };
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ACCESSES; i++) {
+        lora_read_reg(BENCH_REG);
+    }
+    int64_t read_ns = (esp_timer_get_time() - start) * 1000 / BENCH_ACCESSES;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ACCESSES; i++) {
+        lora_write_reg(BENCH_REG, sync);
+    }
+    int64_t write_ns = (esp_timer_get_time() - start) * 1000 / BENCH_ACCESSES;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ACCESSES / BENCH_SEQ_LEN; i++) {
+        lora_write_reg_seq(seq, BENCH_SEQ_LEN);
+    }
+    int64_t seq_ns = (esp_timer_get_time() - start) * 1000 / (BENCH_ACCESSES / BENCH_SEQ_LEN * BENCH_SEQ_LEN);
+
+    printf("access             latency (ns)\n");
+    printf("read (polling)     %12lld\n", read_ns);
+    printf("write (polling)    %12lld\n", write_ns);
+    printf("write (queued x%d) %12lld\n", BENCH_SEQ_LEN, seq_ns);
+    TEST_ASSERT_EQUAL_INT(sync, lora_read_reg(BENCH_REG));
+
+    // Heap allocations for one packet sent and one receive check (target zero)
+    uint8_t buf[32];
+    const char *test_message = "No malloc";
+    uint32_t before = diag_alloc_count(BENCH_ALLOC_STATE);
+    diag_set_state(BENCH_ALLOC_STATE);
+    lora_send_packet((uint8_t *)test_message, strlen(test_message));
+    lora_receive();
+    lora_receive_packet(buf, sizeof(buf));
+    diag_set_state(0);
+    lora_idle();
+    uint32_t allocs = diag_alloc_count(BENCH_ALLOC_STATE) - before;
+#if CONFIG_HEAP_USE_HOOKS
+    printf("heap allocations per packet: %lu\n", (unsigned long)allocs);
+    TEST_ASSERT_EQUAL_UINT32(0, allocs);
+#else
+    (void)allocs;
+    printf("heap allocations per packet: not counted (CONFIG_HEAP_USE_HOOKS disabled)\n");
+#endif
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "sampling.h"
+#include "task_plan.h"
+#include "test_pipeline.h"
+
+#define BENCH_WORKERS    3     // Sensor tasks driven by the clock
+#define BENCH_SAMPLES    50    // Slots per acquisition window
+#define BENCH_PERIOD_MS  10
+#define BENCH_READ_US    300   // Simulated bus transaction per sample
+#define BENCH_LOAD_US    4000  // Busy time of a load task per iteration
+
+static int tests_passed = 0;
+
+typedef struct {
+    int64_t timestamps[BENCH_SAMPLES];
+    SemaphoreHandle_t done;
+} BenchWorker;
+
+static volatile bool s_load_running;
+
+/**
+ * @brief Simulated sensor task: one bus read per slot.
+ */
+static void bench_worker(void *arg)
+{
+    BenchWorker *w = (BenchWorker *)arg;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        w->timestamps[i] = sampling_wait_slot();
+        esp_rom_delay_us(BENCH_READ_US);
+    }
+    xSemaphoreGive(w->done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Simulated SPL processing / SPI radio traffic keeping a core busy.
+ */
+static void bench_load(void *arg)
+{
+    while (s_load_running) {
+        esp_rom_delay_us(BENCH_LOAD_US);
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Run one acquisition window under load.
+ * @param pinned true for the task_plan.h layout, false for the former unpinned layout.
+ * @param window_us Output acquisition duration.
+ * @param jitter Output worst per-channel jitter.
+ */
+static void bench_run(bool pinned, int64_t *window_us, SamplingTiming *jitter)
+{
+    static BenchWorker workers[BENCH_WORKERS];
+    TaskHandle_t handles[BENCH_WORKERS];
+    SamplingClock clock;
+
+    // Former layout: everything unpinned at priority 5
+    BaseType_t acq_core = pinned ? PIPELINE_ACQ_CORE : tskNO_AFFINITY;
+    BaseType_t proc_core = pinned ? PIPELINE_PROC_CORE : tskNO_AFFINITY;
+    UBaseType_t acq_prio = pinned ? PIPELINE_ACQ_PRIORITY : 5;
+    UBaseType_t load_prio = pinned ? PIPELINE_DSP_PRIORITY : 5;
+
+    s_load_running = true;
+    xTaskCreatePinnedToCore(bench_load, "BenchDsp", 2048, NULL, load_prio, NULL, proc_core);
+    xTaskCreatePinnedToCore(bench_load, "BenchRadio", 2048, NULL, load_prio, NULL, proc_core);
+
+    for (int i = 0; i < BENCH_WORKERS; i++) {
+        workers[i].done = xSemaphoreCreateBinary();
+        xTaskCreatePinnedToCore(bench_worker, "BenchAcq", 2048, &workers[i], acq_prio,
+                                &handles[i], acq_core);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, sampling_clock_init(&clock, BENCH_PERIOD_MS, handles, BENCH_WORKERS));
+
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(ESP_OK, sampling_clock_start(&clock, BENCH_SAMPLES));
+    for (int i = 0; i < BENCH_WORKERS; i++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(workers[i].done, pdMS_TO_TICKS(5 * BENCH_SAMPLES * BENCH_PERIOD_MS)));
+    }
+    *window_us = esp_timer_get_time() - start;
+
+    *jitter = (SamplingTiming){ 0 };
+    for (int i = 0; i < BENCH_WORKERS; i++) {
+        SamplingStats stats;
+        sampling_compute_stats(&clock, workers[i].timestamps, BENCH_SAMPLES, &stats);
+        if (stats.jitter.p99_us > jitter->p99_us) {
+            *jitter = stats.jitter;
+        }
+        vSemaphoreDelete(workers[i].done);
+    }
+
+    s_load_running = false;
+    vTaskDelay(pdMS_TO_TICKS(50));   // Let the load tasks exit
+    esp_timer_delete(clock.timer);
+}
+
+void test_pipeline_pinning_benchmark(void)
+{
+    int64_t window_us[2];
+    SamplingTiming jitter[2];
+
+    bench_run(false, &window_us[0], &jitter[0]);
+    bench_run(true, &window_us[1], &jitter[1]);
+
+    printf("layout    acquisition(us)  jitter mean/max/p99 (us)\n");
+    for (int i = 0; i < 2; i++) {
+        printf("%-8s  %15lld  %lld/%lld/%lld\n", i ? "pinned" : "unpinned", window_us[i],
+               jitter[i].mean_us, jitter[i].max_us, jitter[i].p99_us);
+    }
+    // The window length is set by the clock, the layout only changes jitter
+    TEST_ASSERT_LESS_THAN_INT64(2LL * BENCH_SAMPLES * BENCH_PERIOD_MS * 1000, window_us[1]);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
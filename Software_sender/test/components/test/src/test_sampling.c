@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sampling.h"
+#include "test_sampling.h"
+
+#define OVERRUN_SAMPLES    5
+#define OVERRUN_PERIOD_MS  20
+
+static int tests_passed = 0;
+
+typedef struct {
+    int taken;
+    SemaphoreHandle_t done;
+} OverrunReader;
+
+/**
+ * @brief Sensor task whose second read lasts two and a half periods.
+ */
+static void overrun_reader(void *arg)
+{
+    OverrunReader *r = (OverrunReader *)arg;
+    for (int i = 0; i < OVERRUN_SAMPLES; i++) {
+        sampling_wait_slot();
+        r->taken++;
+        if (i == 1) {
+            vTaskDelay(pdMS_TO_TICKS(5 * OVERRUN_PERIOD_MS / 2));
+        }
+    }
+    xSemaphoreGive(r->done);
+    vTaskDelete(NULL);
+}
+
+void test_sampling_stats_perfect_schedule(void)
+{
+    SamplingClock clock = { .origin_us = 1000, .period_us = 1000000 };
+    int64_t timestamps[5];
+    for (int i = 0; i < 5; i++) {
+        timestamps[i] = clock.origin_us + i * clock.period_us + 50;
+    }
+
+    SamplingStats stats;
+    sampling_compute_stats(&clock, timestamps, 5, &stats);
+    TEST_ASSERT_EQUAL_INT64(50, stats.latency.mean_us);
+    TEST_ASSERT_EQUAL_INT64(50, stats.latency.max_us);
+    TEST_ASSERT_EQUAL_INT64(0, stats.jitter.max_us);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_sampling_stats_late_sample(void)
+{
+    SamplingClock clock = { .origin_us = 0, .period_us = 1000000 };
+    int64_t timestamps[4] = { 0, 1000000, 2000300, 3000000 };
+
+    SamplingStats stats;
+    sampling_compute_stats(&clock, timestamps, 4, &stats);
+    TEST_ASSERT_EQUAL_INT64(300, stats.latency.max_us);
+    TEST_ASSERT_EQUAL_INT64(300, stats.latency.p99_us);
+    TEST_ASSERT_EQUAL_INT64(75, stats.latency.mean_us);
+    TEST_ASSERT_EQUAL_INT64(300, stats.jitter.max_us);
+    TEST_ASSERT_EQUAL_INT64(200, stats.jitter.mean_us);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_sampling_read_overrun(void)
+{
+    static OverrunReader reader;
+    TaskHandle_t handle;
+    SamplingClock clock;
+
+    reader = (OverrunReader){ .done = xSemaphoreCreateBinary() };
+    xTaskCreate(overrun_reader, "Overrun", 2048, &reader, 5, &handle);
+    TEST_ASSERT_EQUAL(ESP_OK, sampling_clock_init(&clock, OVERRUN_PERIOD_MS, &handle, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, sampling_clock_start(&clock, OVERRUN_SAMPLES));
+
+    // The slots missed during the long read are taken late, not lost
+    TEST_ASSERT_TRUE(xSemaphoreTake(reader.done, pdMS_TO_TICKS(4 * OVERRUN_SAMPLES * OVERRUN_PERIOD_MS)));
+    TEST_ASSERT_EQUAL_INT(OVERRUN_SAMPLES, reader.taken);
+
+    vSemaphoreDelete(reader.done);
+    esp_timer_delete(clock.timer);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include "unity.h"
+#include "sensor_health.h"
+#include "test_sensor_health.h"
+
+static int tests_passed = 0;
+
+/**
+ * @brief Count the cycles skipped before the sensor is sampled again.
+ */
+static int skipped_cycles(SensorHealth *h)
+{
+    int n = 0;
+    while (!sensor_health_should_sample(h)) {
+        n++;
+    }
+    return n;
+}
+
+void test_sensor_health_backoff_doubles(void)
+{
+    SensorHealth h = { 0 };
+    TEST_ASSERT_TRUE(sensor_health_should_sample(&h));
+
+    int expected[] = { 1, 2, 4, 8 };
+    for (int i = 0; i < 4; i++) {
+        sensor_health_report(&h, false, 100);
+        TEST_ASSERT_EQUAL_INT(expected[i], skipped_cycles(&h));
+    }
+    TEST_ASSERT_EQUAL_INT(4, h.failures);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_sensor_health_backoff_capped(void)
+{
+    SensorHealth h = { 0 };
+    for (int i = 0; i < 20; i++) {
+        sensor_health_report(&h, false, 16);
+    }
+    TEST_ASSERT_EQUAL_INT(16, skipped_cycles(&h));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_sensor_health_recovers(void)
+{
+    SensorHealth h = { 0 };
+    sensor_health_report(&h, false, 16);
+    sensor_health_report(&h, false, 16);
+    skipped_cycles(&h);
+    sensor_health_report(&h, true, 16);
+    TEST_ASSERT_EQUAL_INT(0, h.failures);
+    TEST_ASSERT_TRUE(sensor_health_should_sample(&h));
+
+    // Backoff starts over after a success
+    sensor_health_report(&h, false, 16);
+    TEST_ASSERT_EQUAL_INT(1, skipped_cycles(&h));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include "unity.h"
+#include "beacon.h"
+#include "tdma.h"
+#include "test_tdma.h"
+
+static int tests_passed = 0;
+
+static const TdmaParams params = { .guard_ms = 10, .drift_ppm = 500, .max_missed = 3 };
+static const BeaconSchedule layout = { .period_s = 10, .slot_ms = 1000, .slot_count = 8 };
+
+void test_beacon_round_trip(void)
+{
+    FrameHeader hdr = { .device_id = 0xbeef, .seq = 7 };
+    uint8_t buf[BEACON_LEN];
+    TEST_ASSERT_EQUAL_INT(BEACON_LEN, beacon_encode(&hdr, &layout, buf, sizeof(buf)));
+
+    FrameHeader out_hdr;
+    BeaconSchedule out;
+    TEST_ASSERT_EQUAL_INT(0, beacon_decode(buf, sizeof(buf), &out_hdr, &out));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TYPE_BEACON, out_hdr.type);
+    TEST_ASSERT_EQUAL_UINT16(0xbeef, out_hdr.device_id);
+    TEST_ASSERT_EQUAL_UINT8(7, out_hdr.seq);
+    TEST_ASSERT_EQUAL_UINT16(10, out.period_s);
+    TEST_ASSERT_EQUAL_UINT16(1000, out.slot_ms);
+    TEST_ASSERT_EQUAL_UINT8(8, out.slot_count);
+    TEST_ASSERT_EQUAL_INT(-1, beacon_decode(buf, sizeof(buf) - 1, &out_hdr, &out));   // Truncated
+
+    // The beacon slot and 10 sender slots of 1 s do not fit in 10 s
+    BeaconSchedule too_many = layout;
+    too_many.slot_count = 10;
+    TEST_ASSERT_EQUAL_INT(-1, beacon_encode(&hdr, &too_many, buf, sizeof(buf)));
+    too_many.slot_count = 9;
+    TEST_ASSERT_EQUAL_INT(BEACON_LEN, beacon_encode(&hdr, &too_many, buf, sizeof(buf)));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_tdma_drift_correction(void)
+{
+    TdmaSync t = { 0 };
+    const int64_t first = 5000000;
+    TEST_ASSERT_EQUAL_INT(0, tdma_heard(&t, &layout, first, &params));
+    TEST_ASSERT_EQUAL_INT(1, t.synced);
+
+    // Device 0x0102 is in slot 2, the third after the beacon's
+    TEST_ASSERT_EQUAL_INT(2, tdma_slot_of(&layout, 0x0102));
+    TEST_ASSERT_EQUAL_INT(first + 3000000, tdma_slot_us(&t, 0x0102));
+
+    // No drift known yet: the next beacon one period later, the window widened by 500 ppm of it
+    int64_t next = tdma_beacon_after(&t, first + 1);
+    TEST_ASSERT_EQUAL_INT(first + 10000000, next);
+    TEST_ASSERT_EQUAL_INT(10000 + 5000, tdma_guard_us(&t, next, &params));
+
+    // Heard 2 ms late after 10 s: 200 ppm, half of it taken at once
+    TEST_ASSERT_EQUAL_INT(2000, tdma_heard(&t, &layout, next + 2000, &params));
+    TEST_ASSERT_EQUAL_INT(100, t.drift_ppm);
+    TEST_ASSERT_EQUAL_INT(next + 2000 + 10001000, tdma_beacon_after(&t, next + 2001));
+
+    // A beacon 1 s late was held back by the receiver, not drift
+    int64_t late = tdma_beacon_after(&t, next + 2001) + 1000000;
+    tdma_heard(&t, &layout, late, &params);
+    TEST_ASSERT_EQUAL_INT(100, t.drift_ppm);
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_tdma_missed_and_search(void)
+{
+    TdmaSync t = { 0 };
+    tdma_heard(&t, &layout, 0, &params);
+
+    // The slot follows the predicted beacon while it is missed
+    for (int i = 1; i <= params.max_missed; i++) {
+        int64_t predicted = tdma_beacon_after(&t, t.anchor_us + 1);
+        TEST_ASSERT_EQUAL_INT(1, tdma_missed(&t, predicted, &params));
+        TEST_ASSERT_EQUAL_INT(predicted + 1000000, tdma_slot_us(&t, 0));
+    }
+    TEST_ASSERT_EQUAL_INT(0, tdma_missed(&t, tdma_beacon_after(&t, t.anchor_us + 1), &params));
+
+    // Unsynchronized: search, then skip 1, 2, 4... cycles, up to 32
+    int expected_skip[] = { 1, 2, 4, 8, 16, 32, 32 };
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL_INT(1, tdma_search_due(&t));
+        tdma_search_failed(&t);
+        for (int j = 0; j < expected_skip[i]; j++) {
+            TEST_ASSERT_EQUAL_INT(0, tdma_search_due(&t));
+        }
+    }
+
+    // A beacon heard ends the backoff
+    tdma_heard(&t, &layout, 500000000, &params);
+    TEST_ASSERT_EQUAL_INT(1, t.synced);
+    TEST_ASSERT_EQUAL_INT(1, tdma_search_due(&t));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "tscomp.h"
+#include "frame.h"
+#include "test_tscomp.h"
+
+static int tests_passed = 0;
+
+void test_tscomp_zigzag(void)
+{
+    const int32_t values[] = { 0, -1, 1, -2, 2, INT32_MAX, INT32_MIN };
+    const uint32_t expected[] = { 0, 1, 2, 3, 4, 0xfffffffe, 0xffffffff };
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i], ts_zigzag(values[i]));
+        TEST_ASSERT_EQUAL_INT(values[i], ts_unzigzag(expected[i]));
+    }
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_tscomp_round_trip(void)
+{
+    // Linear ramp, then a step and a large negative jump
+    int32_t values[40];
+    for (int i = 0; i < 30; i++) {
+        values[i] = 10130 + 3 * i;
+    }
+    for (int i = 30; i < 40; i++) {
+        values[i] = (i & 1) ? -32768 : 65535;
+    }
+
+    uint8_t buf[256];
+    TsWriter w = { .buf = buf, .cap = sizeof(buf) };
+    TsChannel enc = { 0 };
+    for (int i = 0; i < 40; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ts_encode(&enc, &w, values[i]));
+    }
+    // Two 3-byte values to settle the predictor, 1 byte per value on the slope, 3 per jump
+    TEST_ASSERT_LESS_OR_EQUAL(2 * 3 + 28 + 10 * 3, w.len);
+
+    TsReader r = { .buf = buf, .len = w.len };
+    TsChannel dec = { 0 };
+    for (int i = 0; i < 40; i++) {
+        int32_t v;
+        TEST_ASSERT_EQUAL_INT(0, ts_decode(&dec, &r, &v));
+        TEST_ASSERT_EQUAL_INT(values[i], v);
+    }
+    TEST_ASSERT_EQUAL_INT(w.len, r.pos);
+
+    // Truncated input is rejected
+    int32_t v;
+    TsReader cut = { .buf = buf, .len = 1 };
+    TsChannel c = { 0 };
+    TEST_ASSERT_EQUAL_INT(-1, ts_decode(&c, &cut, &v));
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
+
+void test_tscomp_batch_split(void)
+{
+    static FrameSample in[FRAME_BATCH_MAX];
+    static FrameSample out[FRAME_BATCH_MAX];
+    for (int i = 0; i < FRAME_BATCH_MAX; i++) {
+        // Uncorrelated values so the frame fills before the batch ends
+        in[i].valid = (i % 5) ? 0x0f : 0x0b;   // Humidity missing every 5th cycle
+        in[i].q[0] = (i * 7919) % 6000 - 3000;
+        in[i].q[1] = 9000 + (i * 104729) % 2000;
+        in[i].q[2] = (in[i].valid & 0x4) ? (i * 31) % 200 : 0;
+        in[i].q[3] = 4000 + (i * 613) % 3000;
+    }
+
+    FrameHeader hdr = { .device_id = 7, .seq = 3 };
+    uint8_t buf[FRAME_MAX_LEN];
+    int encoded;
+    int len = frame_encode_batch(&hdr, 600, in, FRAME_BATCH_MAX, buf, sizeof(buf), &encoded);
+    TEST_ASSERT_TRUE(len > 0 && len <= FRAME_MAX_LEN);
+    TEST_ASSERT_TRUE(encoded > 0 && encoded < FRAME_BATCH_MAX);
+
+    FrameHeader h;
+    uint16_t interval;
+    TEST_ASSERT_EQUAL_INT(encoded, frame_decode_batch(buf, len, &h, &interval, out, FRAME_BATCH_MAX));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TYPE_BATCH, h.type);
+    TEST_ASSERT_EQUAL_UINT16(600, interval);
+    for (int i = 0; i < encoded; i++) {
+        TEST_ASSERT_EQUAL_UINT8(in[i].valid, out[i].valid);
+        TEST_ASSERT_EQUAL_MEMORY(in[i].q, out[i].q, sizeof(in[i].q));
+    }
+    printf("Test %s PASSED\n", __func__);
+    tests_passed++;
+}
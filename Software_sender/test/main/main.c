@@ -3,6 +3,19 @@
 #include "test_sound.h"
 #include "test_temperature.h"
 #include "test_lora.h"
+#include "test_sampling.h"
+#include "test_pipeline.h"
+#include "test_sensor_health.h"
+#include "test_frame.h"
+#include "test_tscomp.h"
+#include "test_frag.h"
+#include "test_link.h"
+#include "test_fec.h"
+#include "test_downlink.h"
+#include "test_airtime.h"
+#include "test_adr.h"
+#include "test_tdma.h"
+#include "test_bulk.h"
 
 void app_main(void)
 {
@@ -30,9 +43,118 @@ void app_main(void)
     UNITY_BEGIN();
     RUN_TEST(test_lora_init);
     RUN_TEST(test_lora_config);
+    RUN_TEST(test_lora_tx_done);
+    RUN_TEST(test_lora_send_async);
+    RUN_TEST(test_lora_cad);
+    RUN_TEST(test_lora_sniff);
+    RUN_TEST(test_lora_channels);
+    RUN_TEST(test_lora_wait_timeout);
+    RUN_TEST(test_lora_config_shadow);
+    RUN_TEST(test_lora_ldro);
+    RUN_TEST(test_lora_spi_benchmark);
     RUN_TEST(test_lora_send);
     RUN_TEST(test_lora_receive);
     UNITY_END();
     
+    // Tests de l'horloge d'échantillonnage
+    printf("\n--- Tests de l'horloge d'échantillonnage ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_sampling_stats_perfect_schedule);
+    RUN_TEST(test_sampling_stats_late_sample);
+    RUN_TEST(test_sampling_read_overrun);
+    UNITY_END();
+    
+    // Tests du suivi d'état des capteurs
+    printf("\n--- Tests du suivi d'état des capteurs ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_sensor_health_backoff_doubles);
+    RUN_TEST(test_sensor_health_backoff_capped);
+    RUN_TEST(test_sensor_health_recovers);
+    UNITY_END();
+    
+    // Tests du format de trame binaire
+    printf("\n--- Tests du format de trame binaire ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_measure_round_trip);
+    RUN_TEST(test_frame_invalid_channels);
+    RUN_TEST(test_frame_rejects_json);
+    UNITY_END();
+    
+    // Tests de la compression des séries temporelles
+    printf("\n--- Tests de la compression des séries temporelles ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_tscomp_zigzag);
+    RUN_TEST(test_tscomp_round_trip);
+    RUN_TEST(test_tscomp_batch_split);
+    UNITY_END();
+    
+    // Tests de la fragmentation des messages
+    printf("\n--- Tests de la fragmentation des messages ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_frag_reassemble_out_of_order);
+    RUN_TEST(test_frag_timeout_eviction);
+    RUN_TEST(test_frag_pool_full_evicts_oldest);
+    UNITY_END();
+    
+    // Tests des acquittements et compteurs de livraison
+    printf("\n--- Tests des acquittements et compteurs de livraison ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_link_track_gaps_and_duplicates);
+    RUN_TEST(test_link_track_wrap_and_restart);
+    RUN_TEST(test_link_ack_frame);
+    UNITY_END();
+    
+    // Tests de la correction d'erreurs entre trames
+    printf("\n--- Tests de la correction d'erreurs entre trames ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_fec_rebuilds_lost_frames);
+    RUN_TEST(test_fec_too_many_losses);
+    RUN_TEST(test_fec_group_closed_early);
+    UNITY_END();
+    
+    // Tests de la configuration à distance
+    printf("\n--- Tests de la configuration à distance ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_downlink_round_trip);
+    RUN_TEST(test_downlink_rejects_invalid);
+    RUN_TEST(test_node_config_apply_and_fallback);
+    UNITY_END();
+    
+    // Tests du temps d'antenne et du rapport cyclique
+    printf("\n--- Tests du temps d'antenne et du rapport cyclique ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_airtime_known_values);
+    RUN_TEST(test_airtime_budget);
+    UNITY_END();
+    
+    // Tests du débit adaptatif
+    printf("\n--- Tests du débit adaptatif ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_adr_decide_steps);
+    RUN_TEST(test_adr_update_history);
+    RUN_TEST(test_node_config_backoff);
+    UNITY_END();
+    
+    // Tests des créneaux TDMA
+    printf("\n--- Tests des créneaux TDMA ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_beacon_round_trip);
+    RUN_TEST(test_tdma_drift_correction);
+    RUN_TEST(test_tdma_missed_and_search);
+    UNITY_END();
+    
+    // Tests du transfert en masse
+    printf("\n--- Tests du transfert en masse ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_bulk_round_trip);
+    RUN_TEST(test_bulk_rejects_invalid);
+    UNITY_END();
+    
+    // Placement des tâches sur les cœurs
+    printf("\n--- Benchmark du placement des tâches ---\n");
+    UNITY_BEGIN();
+    RUN_TEST(test_pipeline_pinning_benchmark);
+    UNITY_END();
+    
     printf("\n=== Fin des tests ===\n");
 } 
\ No newline at end of file
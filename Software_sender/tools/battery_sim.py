@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""
+Battery-life and airtime simulator for the LoRa sender.
+
+Reads the sender's real parameters from its configuration (sample count,
+sampling period, deep sleep interval, spreading factor and TX power: Kconfig
+defaults, overridden by sdkconfig.defaults and sdkconfig), the firmware
+sources (lora_set_* calls, TRANSMISSION payload format) and predicts, per wake cycle, the time on air, charge and energy, and
+the resulting battery life. Any parameter can be overridden or swept:
+
+    python3 tools/battery_sim.py                        # firmware as configured
+    python3 tools/battery_sim.py --sweep sf=7:12 sleep=10,60,600
+    python3 tools/battery_sim.py --sweep power=2,10,17 --battery-mah 2000
+
+Current figures default to Documentation/Energy consumption.docx and
+Documentation/Autonomie_ESP32_Batterie_3000mAh.pdf (awake 1.23 mA, deep sleep
+0.80 mA, 3000 mAh battery). The radio TX current is not in the project
+documentation and comes from the SX1276 datasheet (PA_BOOST output).
+"""
+
+import argparse
+import itertools
+import os
+import re
+import sys
+
+from lora_airtime import time_on_air_ms, DEFAULT_SF, DEFAULT_BW, DEFAULT_CR, DEFAULT_PREAMBLE
+
+SENDER_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+# Project energy documentation
+AWAKE_MA = 1.23          # sensor reading + LoRa phase
+SLEEP_MA = 0.80          # deep sleep
+BATTERY_MAH = 3000.0
+BATTERY_V = 3.7
+
+# SX1276 TX supply current (mA) vs. lora_set_tx_power() level, PA_BOOST pin
+TX_CURRENT_MA = {2: 24.0, 5: 30.0, 8: 38.0, 11: 48.0, 14: 62.0, 17: 87.0}
+
+# Awake phases not derived from the configuration (ms)
+BOOT_MS = 300.0          # ROM + 2nd stage bootloader after deep sleep wake-up
+INIT_MS = 50.0           # INIT state: radio reset, I2C and I2S set-up
+SOUND_READ_MS = 64.0     # One 1024-sample I2S block at 16 kHz, last slot
+
+
+def tx_current_ma(level):
+    """Interpolate the TX current table for a power level (2-17)."""
+    levels = sorted(TX_CURRENT_MA)
+    level = min(max(level, levels[0]), levels[-1])
+    for lo, hi in zip(levels, levels[1:]):
+        if lo <= level <= hi:
+            frac = (level - lo) / float(hi - lo)
+            return TX_CURRENT_MA[lo] + frac * (TX_CURRENT_MA[hi] - TX_CURRENT_MA[lo])
+    return TX_CURRENT_MA[levels[-1]]
+
+
+def _read(path):
+    try:
+        with open(os.path.join(SENDER_DIR, path)) as f:
+            return f.read()
+    except OSError:
+        return ""
+
+
+def _find_int(pattern, text, default):
+    m = re.search(pattern, text)
+    return int(m.group(1)) if m else default
+
+
+def kconfig_values():
+    """Integer options: Kconfig defaults, then sdkconfig.defaults, then sdkconfig."""
+    values = {}
+    text = _read("components/common/Kconfig.projbuild")
+    # First unconditional default of each option
+    for m in re.finditer(r"^\s*config\s+(\w+)\s*\n(.*?)(?=^\s*(?:config|menu|endmenu)\b|\Z)",
+                         text, re.M | re.S):
+        d = re.search(r"^\s*default\s+(-?\d+)\s*$", m.group(2), re.M)
+        if d:
+            values[m.group(1)] = int(d.group(1))
+    for path in ("sdkconfig.defaults", "sdkconfig"):
+        for m in re.finditer(r"^CONFIG_(\w+)=(-?\d+)\s*$", _read(path), re.M):
+            values[m.group(1)] = int(m.group(2))
+    return values
+
+
+def _config_int(values, name, default):
+    if name in values:
+        return values[name]
+    print("warning: CONFIG_%s not found, using %d" % (name, default), file=sys.stderr)
+    return default
+
+
+def payload_size(main_src):
+    """Length of the TRANSMISSION message for representative sensor values."""
+    if "frame_encode_measure" in main_src:
+        return _find_int(r"#define\s+FRAME_MEASURE_LEN\s+(\d+)",
+                         _read("components/frame/include/frame.h"), 12)
+    m = re.search(r'snprintf\(message,\s*sizeof\(message\),\s*"((?:[^"\\]|\\.)*)"', main_src)
+    if not m:
+        return 60
+    fmt = m.group(1).replace('\\"', '"')
+    # temp, press, hum, sound, then the validity bitmap
+    values = (22.5, 1013.25, 45.5, 55.25, 15)
+    try:
+        return len(fmt % values[:fmt.count("%") - 2 * fmt.count("%%")])
+    except TypeError:
+        return 60
+
+
+def firmware_config():
+    """Sender parameters as currently configured and written in the firmware sources."""
+    main_src = _read("main/main.c")
+    kconfig = kconfig_values()
+    return {
+        "samples": _config_int(kconfig, "NODE_SAMPLE_COUNT", 10),
+        "period_ms": _config_int(kconfig, "NODE_SAMPLE_PERIOD_MS", 1000),
+        "sleep": _config_int(kconfig, "NODE_SLEEP_S", 10),
+        "sf": _config_int(kconfig, "NODE_SF", DEFAULT_SF),
+        "bw": _find_int(r"lora_set_bandwidth\((\d+)\)", main_src, DEFAULT_BW),
+        "cr": _find_int(r"lora_set_coding_rate\((\d+)\)", main_src, DEFAULT_CR),
+        "power": _config_int(kconfig, "NODE_TX_POWER", 17),
+        "payload": payload_size(main_src),
+        "preamble": DEFAULT_PREAMBLE,
+    }
+
+
+def simulate(cfg, awake_ma, sleep_ma, battery_mah, voltage):
+    """Per-cycle airtime, charge, energy and battery life for one configuration."""
+    toa_ms = time_on_air_ms(cfg["payload"], cfg["sf"], cfg["bw"], cfg["cr"], cfg["preamble"])
+    acq_ms = (cfg["samples"] - 1) * cfg["period_ms"] + SOUND_READ_MS
+    awake_ms = BOOT_MS + INIT_MS + acq_ms + toa_ms
+    sleep_ms = cfg["sleep"] * 1000.0
+
+    # Charge in mA*ms = µC
+    charge_uc = awake_ms * awake_ma + toa_ms * tx_current_ma(cfg["power"]) + sleep_ms * sleep_ma
+    cycle_ms = awake_ms + sleep_ms
+    avg_ma = charge_uc / cycle_ms
+    return {
+        "toa_ms": toa_ms,
+        "awake_s": awake_ms / 1000.0,
+        "charge_mc": charge_uc / 1000.0,
+        "energy_mj": charge_uc / 1000.0 * voltage,
+        "avg_ma": avg_ma,
+        "duty": toa_ms / cycle_ms * 100.0,
+        "life_days": battery_mah / avg_ma / 24.0,
+    }
+
+
+def parse_sweep(items):
+    """Parse 'key=a,b,c' or 'key=lo:hi' sweep arguments."""
+    sweep = {}
+    for item in items:
+        key, _, values = item.partition("=")
+        if ":" in values:
+            lo, hi = values.split(":")
+            sweep[key] = list(range(int(lo), int(hi) + 1))
+        else:
+            sweep[key] = [int(v) for v in values.split(",")]
+    return sweep
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    cfg = firmware_config()
+    for key in ("samples", "period_ms", "sleep", "sf", "bw", "cr", "power", "payload", "preamble"):
+        parser.add_argument("--" + key.replace("_", "-"), type=int, default=cfg[key],
+                            help="default from firmware: %(default)s")
+    parser.add_argument("--sweep", nargs="+", default=[], metavar="KEY=VALUES",
+                        help="sweep a parameter, e.g. sf=7:12 or sleep=10,60,600")
+    parser.add_argument("--awake-ma", type=float, default=AWAKE_MA)
+    parser.add_argument("--sleep-ma", type=float, default=SLEEP_MA)
+    parser.add_argument("--battery-mah", type=float, default=BATTERY_MAH)
+    parser.add_argument("--voltage", type=float, default=BATTERY_V)
+    args = parser.parse_args()
+
+    base = {k: getattr(args, k) for k in cfg}
+    sweep = parse_sweep(args.sweep)
+    unknown = set(sweep) - set(base)
+    if unknown:
+        parser.error("cannot sweep %s, choose from %s" % (", ".join(unknown), ", ".join(base)))
+
+    keys = list(sweep)
+    header = "".join("%8s" % k for k in keys)
+    print("Base: " + ", ".join("%s=%s" % (k, v) for k, v in base.items()))
+    print(header + "%10s %8s %10s %10s %9s %7s %10s" % (
+        "ToA[ms]", "awake[s]", "Q/cyc[mC]", "E/cyc[mJ]", "avg[mA]", "duty%", "life[d]"))
+    for values in itertools.product(*[sweep[k] for k in keys]):
+        run = dict(base, **dict(zip(keys, values)))
+        r = simulate(run, args.awake_ma, args.sleep_ma, args.battery_mah, args.voltage)
+        print("".join("%8d" % v for v in values) + "%10.1f %8.2f %10.2f %10.2f %9.4f %7.3f %10.1f" % (
+            r["toa_ms"], r["awake_s"], r["charge_mc"], r["energy_mj"],
+            r["avg_ma"], r["duty"], r["life_days"]))
+
+
+if __name__ == "__main__":
+    main()
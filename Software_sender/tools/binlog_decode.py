@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+Decode raw deferred binary log records (components/binlog).
+
+With "Binary log output" set to "Raw hex" in `make config`, the firmware
+prints one line per record:
+
+    BL <ts_us> <format id> <arg0 hex> <arg1 hex> ...
+
+The format strings are read from binlog_fmt.h of the firmware that produced
+the log (sender by default):
+
+    python3 tools/binlog_decode.py monitor.log
+    python3 tools/binlog_decode.py monitor.log \\
+        --formats ../Software_receiver/components/binlog/include/binlog_fmt.h
+
+Other lines are passed through unchanged, so the output reads like a normal
+monitor log.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_FORMATS = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               "..", "components", "binlog", "include", "binlog_fmt.h")
+
+ENTRY_RE = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+RECORD_RE = re.compile(r"BL (\d+) (\d+)((?: [0-9a-fA-F]{8})*)\s*$")
+CONV_RE = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?[hlLqjzt]*([diuxXcfeEgG%])")
+
+
+def load_formats(path):
+    """Return the list of (name, format) in format ID order."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    return [(m.group(1), m.group(2).encode().decode("unicode_escape").encode("latin-1").decode("utf-8"))
+            for m in ENTRY_RE.finditer(text)]
+
+
+def decode_args(fmt, words):
+    """Convert raw 32-bit words to the Python types the format expects."""
+    values = []
+    convs = [c for c in CONV_RE.findall(fmt) if c != "%"]
+    for conv, word in zip(convs, words):
+        if conv in "feEgG":
+            values.append(struct.unpack("<f", struct.pack("<I", word))[0])
+        elif conv in "di":
+            values.append(word - (1 << 32) if word & 0x80000000 else word)
+        else:
+            values.append(word)
+    # Missing arguments print as zero, like the on-device formatter
+    values += [0] * (len(convs) - len(values))
+    return tuple(values)
+
+
+def decode_line(line, formats):
+    """Return the decoded text for a BL record line, or None."""
+    m = RECORD_RE.search(line)
+    if not m:
+        return None
+    ts_us, fmt_id = int(m.group(1)), int(m.group(2))
+    words = [int(w, 16) for w in m.group(3).split()]
+    if fmt_id >= len(formats):
+        return "B (%d) <unknown binlog id %d> %s" % (ts_us // 1000, fmt_id, m.group(3).strip())
+    name, fmt = formats[fmt_id]
+    return "B (%d) %s" % (ts_us // 1000, fmt % decode_args(fmt, words))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("--formats", default=DEFAULT_FORMATS, help="binlog_fmt.h of the firmware")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    src = open(args.log, errors="replace") if args.log else sys.stdin
+    with src:
+        for line in src:
+            decoded = decode_line(line, formats)
+            sys.stdout.write(decoded + "\n" if decoded is not None else line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,183 @@
+/**
+ * @file fec_bench.c
+ * @brief Host benchmark of the erasure coding across frames (components/frame/fec.h).
+ *
+ * Build and run from Software_sender/:
+ *
+ *   gcc -O2 -Icomponents/frame/include tools/fec_bench.c components/frame/src/frame.c \
+ *       components/frame/src/tscomp.c components/frame/src/fec.c -lm -o fec_bench
+ *   ./fec_bench [groups]
+ *
+ * Prints the encode and decode cost per frame on the host, then the share of
+ * frames delivered under independent random packet loss, with and without
+ * repair frames, for several (k, m) settings. Every rebuilt frame is compared
+ * with the original; the program exits with 1 on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fec.h"
+
+typedef struct {
+    int k;
+    int m;
+} FecConfig;
+
+static const FecConfig s_configs[] = { { 4, 1 }, { 8, 1 }, { 8, 2 }, { 16, 2 }, { 16, 4 } };
+#define CONFIG_COUNT (int)(sizeof(s_configs) / sizeof(s_configs[0]))
+
+static uint8_t s_frames[FEC_MAX_K][FEC_MAX_DATA_LEN];
+static int s_lens[FEC_MAX_K];
+static uint8_t s_repairs[FEC_MAX_M][FRAME_MAX_LEN];
+static int s_repair_lens[FEC_MAX_M];
+static FecDecoder s_dec;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Fill a group of k frames of @p len bytes, numbered from @p seq.
+ */
+static void make_group(int k, int len, uint8_t seq)
+{
+    for (int i = 0; i < k; i++) {
+        s_frames[i][0] = (FRAME_VERSION << 4) | FRAME_TYPE_MEASURE;
+        s_frames[i][1] = 0x34;
+        s_frames[i][2] = 0x12;
+        s_frames[i][3] = (uint8_t)(seq + i);
+        for (int b = FRAME_HEADER_LEN; b < len; b++) {
+            s_frames[i][b] = (uint8_t)rand();
+        }
+        s_lens[i] = len;
+    }
+}
+
+static void encode_group(const FecConfig *c)
+{
+    FecEncoder e;
+    fec_encoder_init(&e, c->k, c->m);
+    for (int i = 0; i < c->k; i++) {
+        fec_encoder_add(&e, s_frames[i], s_lens[i]);
+    }
+    for (int j = 0; j < c->m; j++) {
+        s_repair_lens[j] = fec_encode_repair(&e, 0x1234, j, s_repairs[j], sizeof(s_repairs[j]));
+    }
+}
+
+/**
+ * @brief Deliver a group through a lossy link.
+ * @param lost Per frame (k data then m repairs): 1 if lost on air.
+ * @return Data frames delivered, received or rebuilt; -1 on a wrong rebuild.
+ */
+static int deliver_group(const FecConfig *c, const int *lost, uint8_t seq)
+{
+    int delivered = 0;
+    fec_decoder_init(&s_dec, 0x1234);
+    for (int i = 0; i < c->k; i++) {
+        if (!lost[i]) {
+            fec_decoder_add_data(&s_dec, (uint8_t)(seq + i), s_frames[i], s_lens[i]);
+            delivered++;
+        }
+    }
+    for (int j = 0; j < c->m; j++) {
+        if (lost[c->k + j]) {
+            continue;
+        }
+        FecRecovered rec[FEC_MAX_M];
+        int n = fec_decoder_add_repair(&s_dec, s_repairs[j], s_repair_lens[j], rec, FEC_MAX_M);
+        for (int r = 0; r < n; r++) {
+            int i = (uint8_t)(rec[r].seq - seq);
+            if (i >= c->k || !lost[i] || (int)rec[r].len != s_lens[i]
+                || memcmp(rec[r].frame, s_frames[i], s_lens[i]) != 0) {
+                return -1;
+            }
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+static void bench_cost(int len)
+{
+    printf("\nCost per data frame, %d-byte frames (host CPU)\n", len);
+    printf("  k   m   encode [us]  decode m losses [us]\n");
+    for (int ci = 0; ci < CONFIG_COUNT; ci++) {
+        const FecConfig *c = &s_configs[ci];
+        const int iters = 2000;
+        make_group(c->k, len, 0);
+
+        double t0 = now_us();
+        for (int it = 0; it < iters; it++) {
+            encode_group(c);
+        }
+        double enc = (now_us() - t0) / iters / c->k;
+
+        // Worst case: the first m data frames lost, every repair received
+        int lost[FEC_MAX_K + FEC_MAX_M] = { 0 };
+        for (int i = 0; i < c->m; i++) {
+            lost[i] = 1;
+        }
+        t0 = now_us();
+        for (int it = 0; it < iters; it++) {
+            deliver_group(c, lost, 0);
+        }
+        double dec = (now_us() - t0) / iters / c->k;
+        printf("%3d %3d %12.2f %21.2f\n", c->k, c->m, enc, dec);
+    }
+}
+
+static int bench_recovery(int groups)
+{
+    const double losses[] = { 0.01, 0.05, 0.10, 0.20, 0.30 };
+    printf("\nDelivered frames under random loss (%d groups per cell)\n", groups);
+    printf("  k   m  airtime");
+    for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+        printf("  %5.0f%% loss", losses[l] * 100);
+    }
+    printf("\n  no FEC   1.00x");
+    for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+        printf("  %10.2f%%", (1 - losses[l]) * 100);
+    }
+    printf("\n");
+
+    for (int ci = 0; ci < CONFIG_COUNT; ci++) {
+        const FecConfig *c = &s_configs[ci];
+        printf("%3d %3d  %6.2fx", c->k, c->m, (double)(c->k + c->m) / c->k);
+        for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+            long delivered = 0;
+            for (int g = 0; g < groups; g++) {
+                uint8_t seq = (uint8_t)(g * c->k);
+                int lost[FEC_MAX_K + FEC_MAX_M];
+                for (int i = 0; i < c->k + c->m; i++) {
+                    lost[i] = rand() < losses[l] * RAND_MAX;
+                }
+                make_group(c->k, 12, seq);
+                encode_group(c);
+                int n = deliver_group(c, lost, seq);
+                if (n < 0) {
+                    printf("\nrebuilt frame MISMATCH (k %d, m %d)\n", c->k, c->m);
+                    return 1;
+                }
+                delivered += n;
+            }
+            printf("  %10.2f%%", 100.0 * delivered / ((long)groups * c->k));
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int groups = argc > 1 ? atoi(argv[1]) : 20000;
+    srand(1);
+    bench_cost(FRAME_MEASURE_LEN);
+    bench_cost(FEC_MAX_DATA_LEN);
+    return bench_recovery(groups);
+}
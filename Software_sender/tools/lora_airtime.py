@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+LoRa time-on-air calculator (Semtech SX1276 datasheet, section 4.1.1.7).
+
+Used as a module by the other host tools, or standalone to print a table:
+
+    python3 tools/lora_airtime.py --payload 58 12
+
+With exactly two payload sizes, the time saved by the second is added.
+With --header, each payload is shown with the explicit and the implicit
+PHY header (lora_implicit_header_mode()) and the time saved by the latter:
+
+    python3 tools/lora_airtime.py --header --payload 12
+
+Parameters follow the firmware driver (components/lora): the bandwidth is the
+register index passed to lora_set_bandwidth() (0..9) and the coding rate is
+the 1..4 value passed to lora_set_coding_rate() (4/5 .. 4/8).
+"""
+
+import argparse
+import math
+
+# lora_set_bandwidth() index -> bandwidth in Hz
+BANDWIDTH_HZ = [7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000]
+
+# SX1276 defaults, which the firmware keeps (only the frequency is changed)
+DEFAULT_SF = 7
+DEFAULT_BW = 7        # 125 kHz
+DEFAULT_CR = 1        # 4/5
+DEFAULT_PREAMBLE = 8
+
+
+def symbol_time_ms(sf, bw):
+    """Duration of one LoRa symbol in milliseconds."""
+    return (1 << sf) / BANDWIDTH_HZ[bw] * 1000.0
+
+
+def time_on_air_ms(payload_len, sf=DEFAULT_SF, bw=DEFAULT_BW, cr=DEFAULT_CR,
+                   preamble=DEFAULT_PREAMBLE, implicit=False, crc=False, ldro=None):
+    """
+    Time on air of one packet in milliseconds.
+
+    ldro=None enables the low data rate optimization when a symbol lasts
+    longer than 16 ms, as recommended by the datasheet.
+    """
+    t_sym = symbol_time_ms(sf, bw)
+    if ldro is None:
+        ldro = t_sym > 16.0
+    t_preamble = (preamble + 4.25) * t_sym
+    num = 8 * payload_len - 4 * sf + 28 + 16 * int(crc) - 20 * int(implicit)
+    den = 4 * (sf - 2 * int(ldro))
+    n_payload = 8 + max(math.ceil(num / den) * (cr + 4), 0)
+    return t_preamble + n_payload * t_sym
+
+
+def print_header_saving(args):
+    """Explicit vs implicit header time on air, per payload and spreading factor."""
+    print("BW %.1f kHz, CR 4/%d, preamble %d, CRC %s" % (
+        BANDWIDTH_HZ[args.bw] / 1000.0, args.cr + 4, args.preamble, "on" if args.crc else "off"))
+    for p in args.payload:
+        print("\n%d B payload" % p)
+        print("SF  %10s%10s%10s%8s   [ms]" % ("explicit", "implicit", "saved", "%"))
+        for sf in range(7, 13):
+            exp = time_on_air_ms(p, sf, args.bw, args.cr, args.preamble, False, args.crc)
+            imp = time_on_air_ms(p, sf, args.bw, args.cr, args.preamble, True, args.crc)
+            print("%-4d%10.1f%10.1f%10.1f%7.0f%%" % (sf, exp, imp, exp - imp, (exp - imp) / exp * 100.0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LoRa time-on-air table per spreading factor")
+    parser.add_argument("--payload", type=int, nargs="+", default=[58, 12], help="payload sizes in bytes")
+    parser.add_argument("--bw", type=int, default=DEFAULT_BW, help="bandwidth index (0-9)")
+    parser.add_argument("--cr", type=int, default=DEFAULT_CR, help="coding rate (1-4)")
+    parser.add_argument("--preamble", type=int, default=DEFAULT_PREAMBLE, help="preamble symbols")
+    parser.add_argument("--crc", action="store_true", help="payload CRC enabled")
+    parser.add_argument("--implicit", action="store_true", help="implicit header mode")
+    parser.add_argument("--header", action="store_true", help="compare explicit and implicit header")
+    args = parser.parse_args()
+
+    if args.header:
+        print_header_saving(args)
+        return
+
+    print("BW %.1f kHz, CR 4/%d, preamble %d, CRC %s, %s header" % (
+        BANDWIDTH_HZ[args.bw] / 1000.0, args.cr + 4, args.preamble,
+        "on" if args.crc else "off", "implicit" if args.implicit else "explicit"))
+    compare = len(args.payload) == 2
+    print("SF  " + "".join("%10s" % ("%d B" % p) for p in args.payload)
+          + ("%10s%8s" % ("saved", "%") if compare else "") + "   [ms]")
+    for sf in range(7, 13):
+        row = [time_on_air_ms(p, sf, args.bw, args.cr, args.preamble, args.implicit, args.crc)
+               for p in args.payload]
+        line = "%-4d" % sf + "".join("%10.1f" % t for t in row)
+        if compare:
+            line += "%10.1f%7.0f%%" % (row[0] - row[1], (row[0] - row[1]) / row[0] * 100.0)
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Convert a sender trace dump into a Chrome/Perfetto trace.
+
+The firmware prints its RTC trace ring (components/trace) as:
+
+    TRACE-BEGIN <count>
+    TRACE <cycle> <ts_us> <B|E> <name>
+    ...
+    TRACE-END
+
+Capture the serial output (e.g. `idf.py monitor | tee monitor.log`), then:
+
+    python3 tools/trace2chrome.py monitor.log -o trace.json
+
+Open trace.json in https://ui.perfetto.dev or chrome://tracing. Each wake
+cycle is shown as its own process, with one track per traced phase group.
+A per-phase summary (count, mean and max duration) is printed on stdout.
+"""
+
+import argparse
+import json
+import re
+import sys
+from collections import defaultdict
+
+LINE_RE = re.compile(r"TRACE (\d+) (\d+) ([BE]) (\S+)")
+
+# Track (thread) used for each phase, so concurrent phases do not overlap
+STATE_PHASES = {"INIT", "ACQUISITION", "TRANSMISSION", "SLEEPMODE"}
+
+
+def track_of(name):
+    """Return the track name a phase is drawn on."""
+    if name in STATE_PHASES:
+        return "state"
+    if name.startswith("lora"):
+        return "lora"
+    return name
+
+
+def parse(lines):
+    """Yield (cycle, ts_us, phase, name) records from a serial log."""
+    for line in lines:
+        m = LINE_RE.search(line)
+        if m:
+            yield int(m.group(1)), int(m.group(2)), m.group(3), m.group(4)
+
+
+def convert(records):
+    """Build the Chrome trace event list and per-phase durations."""
+    events = []
+    tracks = {}
+    cycles = set()
+    open_phases = {}
+    durations = defaultdict(list)
+
+    for cycle, ts, phase, name in records:
+        track = track_of(name)
+        tid = tracks.setdefault(track, len(tracks) + 1)
+        cycles.add(cycle)
+        events.append({"name": name, "ph": phase, "ts": ts, "pid": cycle, "tid": tid})
+
+        key = (cycle, name)
+        if phase == "B":
+            open_phases[key] = ts
+        elif key in open_phases:
+            durations[name].append(ts - open_phases.pop(key))
+
+    for cycle in sorted(cycles):
+        events.append({"name": "process_name", "ph": "M", "pid": cycle,
+                       "args": {"name": "cycle %d" % cycle}})
+        for track, tid in tracks.items():
+            events.append({"name": "thread_name", "ph": "M", "pid": cycle, "tid": tid,
+                           "args": {"name": track}})
+    return events, durations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-o", "--output", default="trace.json", help="Chrome trace output file")
+    args = parser.parse_args()
+
+    src = open(args.log, errors="replace") if args.log else sys.stdin
+    with src:
+        events, durations = convert(parse(src))
+
+    with open(args.output, "w") as out:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, out)
+
+    print("%-14s %6s %12s %12s" % ("phase", "count", "mean [ms]", "max [ms]"))
+    for name, values in sorted(durations.items()):
+        print("%-14s %6d %12.2f %12.2f" % (name, len(values),
+                                           sum(values) / len(values) / 1000.0,
+                                           max(values) / 1000.0))
+    print("Wrote %d events to %s" % (len(events), args.output))
+
+
+if __name__ == "__main__":
+    main()
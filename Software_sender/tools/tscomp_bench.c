@@ -0,0 +1,156 @@
+/**
+ * @file tscomp_bench.c
+ * @brief Host round-trip check and compression benchmark of batch frames.
+ *
+ * Build and run from Software_sender/:
+ *
+ *   gcc -O2 -Icomponents/frame/include tools/tscomp_bench.c \
+ *       components/frame/src/frame.c components/frame/src/tscomp.c -lm -o tscomp_bench
+ *   ./tscomp_bench trace.csv
+ *
+ * The trace is a CSV of temp,press,hum,sound per line (one wake cycle each,
+ * an empty field is an invalid channel), for example exported from the
+ * sensors table:
+ *
+ *   \copy (SELECT temperature, pressure, humidity, sound FROM sensors
+ *          ORDER BY created_at) TO 'trace.csv' CSV
+ *
+ * Without a file, a synthetic diurnal trace is used. Every frame is decoded
+ * again and compared with the quantized input; the program exits with 1 on
+ * any mismatch.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame.h"
+
+#define MAX_SAMPLES 100000
+#define JSON_LEN    58   ///< Former {"temp":..,"press":..,"hum":..,"sound":..} message
+
+static FrameSample s_trace[MAX_SAMPLES];
+
+/**
+ * @brief Parse one CSV field, empty or non-numeric means invalid.
+ */
+static int parse_field(char **p, float *v)
+{
+    char *end;
+    *v = strtof(*p, &end);
+    int ok = end != *p;
+    while (*end && *end != ',' && *end != '\n') {
+        end++;
+    }
+    *p = *end == ',' ? end + 1 : end;
+    return ok;
+}
+
+static int load_csv(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    char line[256];
+    int n = 0;
+    while (n < MAX_SAMPLES && fgets(line, sizeof(line), f)) {
+        FrameMeasure m = { 0 };
+        float *fields[FRAME_CHANNELS] = { &m.temp, &m.press, &m.hum, &m.sound };
+        char *p = line;
+        for (int c = 0; c < FRAME_CHANNELS; c++) {
+            if (parse_field(&p, fields[c])) {
+                m.valid |= 1 << c;
+            }
+        }
+        if (m.valid) {   // Skips a header line
+            frame_quantize(&m, &s_trace[n++]);
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief Synthetic trace: 3 days at one sample per 10 min with sensor noise.
+ */
+static int synthetic_trace(void)
+{
+    int n = 3 * 24 * 6;
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        double day = i / 144.0 * 2 * M_PI;
+        double noise = (rand() % 1000) / 1000.0 - 0.5;
+        FrameMeasure m = {
+            .valid = 0x0f,
+            .temp = 18 + 6 * sin(day) + 0.1 * noise,
+            .press = 1013 + 4 * sin(day / 3) + 0.2 * noise,
+            .hum = 55 - 15 * sin(day) + noise,
+            .sound = 45 + 10 * (sin(day) > 0) + 4 * noise,
+        };
+        frame_quantize(&m, &s_trace[i]);
+    }
+    return n;
+}
+
+/**
+ * @brief Pack the whole trace in batch frames of at most @p batch samples.
+ * @return Total bytes, or -1 on a round-trip mismatch.
+ */
+static long run(int n, int batch, int *frames)
+{
+    long total = 0;
+    *frames = 0;
+    for (int i = 0; i < n;) {
+        uint8_t buf[FRAME_MAX_LEN];
+        FrameHeader hdr = { .device_id = 0x1234, .seq = (uint8_t)*frames };
+        int count = n - i < batch ? n - i : batch;
+        int encoded;
+        int len = frame_encode_batch(&hdr, 600, &s_trace[i], count, buf, sizeof(buf), &encoded);
+        if (len < 0) {
+            return -1;
+        }
+
+        FrameSample out[FRAME_BATCH_MAX];
+        FrameHeader h;
+        uint16_t interval;
+        if (frame_decode_batch(buf, len, &h, &interval, out, FRAME_BATCH_MAX) != encoded) {
+            return -1;
+        }
+        for (int k = 0; k < encoded; k++) {
+            if (out[k].valid != s_trace[i + k].valid
+                || memcmp(out[k].q, s_trace[i + k].q, sizeof(out[k].q)) != 0) {
+                fprintf(stderr, "mismatch at sample %d\n", i + k);
+                return -1;
+            }
+        }
+        total += len;
+        i += encoded;
+        (*frames)++;
+    }
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? load_csv(argv[1]) : synthetic_trace();
+    printf("%s: %d samples\n", argc > 1 ? argv[1] : "synthetic trace", n);
+    if (n == 0) {
+        return 2;
+    }
+
+    printf("batch  frames   bytes  B/sample  vs 12 B frame  vs JSON\n");
+    const int batches[] = { 1, 4, 8, 16, 32, FRAME_BATCH_MAX };
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        int frames;
+        long bytes = run(n, batches[b], &frames);
+        if (bytes < 0) {
+            printf("round trip FAILED for batch %d\n", batches[b]);
+            return 1;
+        }
+        printf("%5d  %6d  %6ld  %8.2f  %12.2fx  %6.2fx\n", batches[b], frames, bytes,
+               (double)bytes / n, (double)n * FRAME_MEASURE_LEN / bytes, (double)n * JSON_LEN / bytes);
+    }
+    return 0;
+}